@@ -0,0 +1,47 @@
+// Example shared object resolving a function at load time with a GNU ifunc.
+// The resolver runs before relocations are processed, so it uses the self-contained cpuidx_ifunc.h queries.
+
+#include <cpuidx_ifunc.h>
+#include <immintrin.h>
+
+#include "popcount.h"
+
+static size_t popcount_generic(const uint64_t* data, const size_t size) {
+    size_t count = 0;
+    for (size_t i = 0; i < size; ++i) {
+        for (uint64_t word = data[i]; word; word &= word - 1) ++count;
+    }
+    return count;
+}
+
+__attribute__((target("popcnt")))
+static size_t popcount_popcnt(const uint64_t* data, const size_t size) {
+    size_t count = 0;
+    for (size_t i = 0; i < size; ++i) count += (size_t) __builtin_popcountll(data[i]);
+    return count;
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static size_t popcount_avx512(const uint64_t* data, const size_t size) {
+    __m512i counts = _mm512_setzero_si512();
+    size_t i = 0;
+
+    for (; i + 8 <= size; i += 8) counts = _mm512_add_epi64(counts, _mm512_popcnt_epi64(_mm512_loadu_si512(data + i)));
+    size_t count = (size_t) _mm512_reduce_add_epi64(counts);
+
+    for (; i < size; ++i) count += (size_t) __builtin_popcountll(data[i]);
+    return count;
+}
+
+static size_t (*resolve_popcount(void))(const uint64_t*, size_t) {
+    if (cpuidx_ifunc_supports(CPUIDX_FEATURE_AVX512VPOPCNTDQ)) return popcount_avx512;
+    if (cpuidx_ifunc_supports(CPUIDX_FEATURE_POPCNT)) return popcount_popcnt;
+    return popcount_generic;
+}
+
+size_t example_popcount(const uint64_t* data, size_t size) __attribute__((ifunc("resolve_popcount")));
+
+const char* example_popcount_implementation(void) {
+    size_t (*const resolved)(const uint64_t*, size_t) = resolve_popcount();
+    return resolved == popcount_avx512 ? "avx512" : resolved == popcount_popcnt ? "popcnt" : "generic";
+}
@@ -0,0 +1,24 @@
+#pragma once
+#ifndef EXAMPLE_POPCOUNT_H
+#define EXAMPLE_POPCOUNT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Counts the set bits of an array, with the best implementation for the CPU, selected at load time.
+ *
+ * @param data The array.
+ * @param size The number of elements of the array.
+ * @return The number of set bits.
+ */
+size_t example_popcount(const uint64_t* data, size_t size);
+
+/**
+ * Gets the name of the implementation \p example_popcount resolved to.
+ *
+ * @return "avx512", "popcnt" or "generic".
+ */
+const char* example_popcount_implementation(void);
+
+#endif // EXAMPLE_POPCOUNT_H
@@ -0,0 +1,12 @@
+#include <stdio.h>
+
+#include "popcount.h"
+
+int main(void) {
+    uint64_t data[100];
+    for (size_t i = 0; i < sizeof(data) / sizeof(data[0]); ++i) data[i] = i * 0x9e3779b97f4a7c15;
+
+    printf("example_popcount (%s): %zu\n", example_popcount_implementation(),
+           example_popcount(data, sizeof(data) / sizeof(data[0])));
+    return 0;
+}
@@ -24,9 +24,11 @@ _check_cpuid PROC
 
     pushfq                          ; Push RFLAGS again
     pop     rax                     ; Pop it back into RAX
+    push    rcx                     ; Restore the original RFLAGS
+    popfq
+    xor     rax, rcx                ; Keep the bits that changed
     and     rax, 200000h            ; Mask out everything but the ID flag
-    cmp     rax, 200000h            ; Compare the ID flag
-    sete    al                      ; AL = 1 if ID flag was toggled, else 0
+    setnz   al                      ; AL = 1 if ID flag was toggled, else 0
     movzx   eax, al                 ; Zero-extend AL into EAX
     ret
 ELSE
@@ -53,9 +55,11 @@ _check_cpuid PROC
 
     pushfd                          ; Push EFLAGS again
     pop     eax                     ; Pop it back into EAX
+    push    ecx                     ; Restore the original EFLAGS
+    popfd
+    xor     eax, ecx                ; Keep the bits that changed
     and     eax, 200000h            ; Mask out everything but the ID flag
-    cmp     eax, 200000h            ; Compare the ID flag
-    sete    al                      ; AL = 1 if ID flag was toggled, else 0
+    setnz   al                      ; AL = 1 if ID flag was toggled, else 0
     movzx   eax, al                 ; Zero-extend AL into EAX
     ret
 ENDIF
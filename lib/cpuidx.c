@@ -1,4 +1,5 @@
 #include "cpuidx.h"
+#include "cpuidx_internal.h"
 #include <string.h>
 
 #if defined(__GNUC__) || defined(__clang__)
@@ -84,13 +85,458 @@ void cpuid_extended(uint32_t leaf, uint32_t sub_leaf, uint32_t registers[4]) {
 }
 
 /**
- * Function to get CPU features and basic information.
+ * Function to read an extended control register using the XGETBV instruction.
+ *
+ * The instruction faults unless the OS enabled XSAVE, so check the \p OSXSAVE feature first.
+ *
+ * @param xcr The extended control register to read, e.g. 0 for XCR0.
+ * @return The value of the register.
+ */
+uint64_t xgetbv(uint32_t xcr) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return _xgetbv(xcr);
+#else
+    uint32_t eax, edx;
+    __asm__ volatile ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (xcr));
+    return (uint64_t) edx << 32 | eax;
+#endif
+}
+
+/**
+ * Function to detect the family, model and stepping, and the standard feature flags (leaf 1).
+ */
+static void detect_leaf_1(cpu_features* CPUIDX_RESTRICT features,
+                          cpu_basic_info* CPUIDX_RESTRICT basic_info) {
+    if (basic_info->highest_basic_leaf < 1) return;
+
+    uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+
+    // Check for the CPU family, model, and stepping
+    cpuid(1, registers);
+    basic_info->family = ((registers[0] >> 8) & 0xF) + ((registers[0] >> 20) & 0xFF);
+    basic_info->model = ((registers[0] >> 4) & 0xF) + ((registers[0] >> 12) & 0xF0);
+    basic_info->stepping = registers[0] & 0xF;
+
+    // Standard feature flags (CPUID Leaf 1)
+    // %ecx flags
+    features->SSE3 = registers[2] & b_SSE3;
+    features->PCLMULQDQ = registers[2] & b_PCLMULQDQ;
+    features->DTES64 = registers[2] & b_DTES64;
+    features->MONITOR = registers[2] & b_MONITOR;
+    features->DSCPL = registers[2] & b_DSCPL;
+    features->VMX = registers[2] & b_VMX;
+    features->SMX = registers[2] & b_SMX;
+    features->EIST = registers[2] & b_EIST;
+    features->TM2 = registers[2] & b_TM2;
+    features->SSSE3 = registers[2] & b_SSSE3;
+    features->CNXTID = registers[2] & b_CNXTID;
+    features->SDBG = registers[2] & b_SDBG;
+    features->FMA = registers[2] & b_FMA;
+    features->CMPXCHG16B = registers[2] & b_CMPXCHG16B;
+    features->xTPR = registers[2] & b_xTPR;
+    features->PDCM = registers[2] & b_PDCM;
+    features->PCID = registers[2] & b_PCID;
+    features->DCA = registers[2] & b_DCA;
+    features->SSE41 = registers[2] & b_SSE41;
+    features->SSE42 = registers[2] & b_SSE42;
+    features->x2APIC = registers[2] & b_x2APIC;
+    features->MOVBE = registers[2] & b_MOVBE;
+    features->POPCNT = registers[2] & b_POPCNT;
+    features->TSCDeadline = registers[2] & b_TSCDeadline;
+    features->AESNI = registers[2] & b_AESNI;
+    features->XSAVE = registers[2] & b_XSAVE;
+    features->OSXSAVE = registers[2] & b_OSXSAVE;
+    features->AVX = registers[2] & b_AVX;
+    features->F16C = registers[2] & b_F16C;
+    features->RDRND = registers[2] & b_RDRND;
+    features->HYPRVSR = registers[2] & b_HYPRVSR;
+
+    // %edx flags
+    features->FPU = registers[3] & b_FPU;
+    features->VME = registers[3] & b_VME;
+    features->DE = registers[3] & b_DE;
+    features->PSE = registers[3] & b_PSE;
+    features->TSC = registers[3] & b_TSC;
+    features->MSR = registers[3] & b_MSR;
+    features->PAE = registers[3] & b_PAE;
+    features->MCE = registers[3] & b_MCE;
+    features->CX8 = registers[3] & b_CX8;
+    features->APIC = registers[3] & b_APIC;
+    features->SEP = registers[3] & b_SEP;
+    features->MTRR = registers[3] & b_MTRR;
+    features->PGE = registers[3] & b_PGE;
+    features->MCA = registers[3] & b_MCA;
+    features->CMOV = registers[3] & b_CMOV;
+    features->PAT = registers[3] & b_PAT;
+    features->PSE36 = registers[3] & b_PSE36;
+    features->PSN = registers[3] & b_PSN;
+    features->CLFSH = registers[3] & b_CLFSH;
+    features->DS = registers[3] & b_DS;
+    features->ACPI = registers[3] & b_ACPI;
+    features->MMX = registers[3] & b_MMX;
+    features->FXSR = registers[3] & b_FXSR;
+    features->SSE = registers[3] & b_SSE;
+    features->SSE2 = registers[3] & b_SSE2;
+    features->SS = registers[3] & b_SS;
+    features->HTT = registers[3] & b_HTT;
+    features->TM = registers[3] & b_TM;
+    features->IA64 = registers[3] & b_IA64;
+    features->PBE = registers[3] & b_PBE;
+}
+
+/**
+ * Function to detect the extended feature flags (leaf 7, sub-leaves 0 and 1).
+ */
+static void detect_leaf_7(cpu_features* CPUIDX_RESTRICT features,
+                          cpu_basic_info* CPUIDX_RESTRICT basic_info) {
+    if (basic_info->highest_basic_leaf < 7) return;
+
+    uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+
+    // sub-leaf 0
+    cpuid_extended(7, 0, registers);
+
+    // %ebx flags
+    features->FSGSBASE = registers[1] & b_FSGSBASE;
+    features->SGX = registers[1] & b_SGX;
+    features->BMI = registers[1] & b_BMI;
+    features->HLE = registers[1] & b_HLE;
+    features->FDPXO = registers[1] & b_FDPXO;
+    features->AVX2 = registers[1] & b_AVX2;
+    features->SMEP = registers[1] & b_SMEP;
+    features->BMI2 = registers[1] & b_BMI2;
+    features->ENH_MOVSB = registers[1] & b_ENH_MOVSB;
+    features->INVPCID = registers[1] & b_INVPCID;
+    features->RTM = registers[1] & b_RTM;
+    features->MPX = registers[1] & b_MPX;
+    features->AVX512F = registers[1] & b_AVX512F;
+    features->AVX512DQ = registers[1] & b_AVX512DQ;
+    features->RDSEED = registers[1] & b_RDSEED;
+    features->ADX = registers[1] & b_ADX;
+    features->SMAP = registers[1] & b_SMAP;
+    features->AVX512IFMA = registers[1] & b_AVX512IFMA;
+    features->CLFLUSHOPT = registers[1] & b_CLFLUSHOPT;
+    features->CLWB = registers[1] & b_CLWB;
+    features->PT = registers[1] & b_PT;
+    features->AVX512PF = registers[1] & b_AVX512PF;
+    features->AVX512ER = registers[1] & b_AVX512ER;
+    features->AVX512CD = registers[1] & b_AVX512CD;
+    features->SHA = registers[1] & b_SHA;
+    features->AVX512BW = registers[1] & b_AVX512BW;
+    features->AVX512VL = registers[1] & b_AVX512VL;
+
+    // %ecx flags
+    features->PREFTCHWT1 = registers[2] & b_PREFTCHWT1;
+    features->AVX512VBMI = registers[2] & b_AVX512VBMI;
+    features->UMIP = registers[2] & b_UMIP;
+    features->PKU = registers[2] & b_PKU;
+    features->OSPKE = registers[2] & b_OSPKE;
+    features->WAITPKG = registers[2] & b_WAITPKG;
+    features->AVX512VBMI2 = registers[2] & b_AVX512VBMI2;
+    features->SHSTK = registers[2] & b_SHSTK;
+    features->GFNI = registers[2] & b_GFNI;
+    features->VAES = registers[2] & b_VAES;
+    features->VPCLMULQDQ = registers[2] & b_VPCLMULQDQ;
+    features->AVX512VNNI = registers[2] & b_AVX512VNNI;
+    features->AVX512BITALG = registers[2] & b_AVX512BITALG;
+    features->TMEM = registers[2] & b_TMEM;
+    features->AVX512VPOPCNTDQ = registers[2] & b_AVX512VPOPCNTDQ;
+    features->IA57 = registers[2] & b_IA57;
+    features->RDPID = registers[2] & b_RDPID;
+    features->KL = registers[2] & b_KL;
+    features->BLD = registers[2] & b_BLD;
+    features->CLDEMOTE = registers[2] & b_CLDEMOTE;
+    features->MOVDIRI = registers[2] & b_MOVDIRI;
+    features->MOVDIR64B = registers[2] & b_MOVDIR64B;
+    features->ENQCMD = registers[2] & b_ENQCMD;
+    features->SGXLC = registers[2] & b_SGXLC;
+    features->PKS = registers[2] & b_PKS;
+
+    // %edx flags
+    features->SGXKEYS = registers[3] & b_SGXKEYS;
+    features->AVX5124VNNIW = registers[3] & b_AVX5124VNNIW;
+    features->AVX5124FMAPS = registers[3] & b_AVX5124FMAPS;
+    features->FSRM = registers[3] & b_FSRM;
+    features->UINTR = registers[3] & b_UINTR;
+    features->AVX512VP2INTERSECT = registers[3] & b_AVX512VP2INTERSECT;
+    features->SRBDSCTRL = registers[3] & b_SRBDSCTRL;
+    features->MDCLEAR = registers[3] & b_MDCLEAR;
+    features->RTMAA = registers[3] & b_RTMAA;
+    features->RTMFA = registers[3] & b_RTMFA;
+    features->SERIALIZE = registers[3] & b_SERIALIZE;
+    features->HYBRID = registers[3] & b_HYBRID;
+    features->TSXLDTRK = registers[3] & b_TSXLDTRK;
+    features->PCONFIG = registers[3] & b_PCONFIG;
+    features->LBR = registers[3] & b_LBR;
+    features->IBT = registers[3] & b_IBT;
+    features->AMXBF16 = registers[3] & b_AMXBF16;
+    features->AVX512FP16 = registers[3] & b_AVX512FP16;
+    features->AMXTILE = registers[3] & b_AMXTILE;
+    features->AMXINT8 = registers[3] & b_AMXINT8;
+    features->IBRRS = registers[3] & b_IBRRS;
+    features->STIBP = registers[3] & b_STIBP;
+    features->L1D_FLUSH = registers[3] & b_L1D_FLUSH;
+    features->IA32_ARCH_CAPABILITIES = registers[3] & b_IA32_ARCH_CAPABILITIES;
+    features->IA32_CORE_CAPABILITIES = registers[3] & b_IA32_CORE_CAPABILITIES;
+    features->SSBD = registers[3] & b_SSBD;
+
+    // max ecx value is stored in eax
+    const uint32_t max_ecx = registers[0];
+
+    // sub-leaf 1
+    if (max_ecx) {
+        cpuid_extended(7, 1, registers);
+
+        // %eax flags
+        features->SHA512 = registers[0] & b_SHA512;
+        features->SM3 = registers[0] & b_SM3;
+        features->SM4 = registers[0] & b_SM4;
+        features->RAOINT = registers[0] & b_RAOINT;
+        features->AVXVNNI = registers[0] & b_AVXVNNI;
+        features->AVX512BF16 = registers[0] & b_AVX512BF16;
+        features->CMPCCXADD = registers[0] & b_CMPCCXADD;
+        features->FRED = registers[0] & b_FRED;
+        features->LKGS = registers[0] & b_LKGS;
+        features->WRMSRNS = registers[0] & b_WRMSRNS;
+        features->NMISRC = registers[0] & b_NMISRC;
+        features->AMXFP16 = registers[0] & b_AMXFP16;
+        features->HRESET = registers[0] & b_HRESET;
+        features->AVXIFMA = registers[0] & b_AVXIFMA;
+        features->LAM = registers[0] & b_LAM;
+        features->MSRLIST = registers[0] & b_MSRLIST;
+        features->MOVRS = registers[0] & b_MOVRS;
+
+        // %ebx flags
+        features->PBNDKB = registers[1] & b_PBNDKB;
+
+        // %edx flags
+        features->AVXVNNIINT8 = registers[3] & b_AVXVNNIINT8;
+        features->AVXNECONVERT = registers[3] & b_AVXNECONVERT;
+        features->AMXCOMPLEX = registers[3] & b_AMXCOMPLEX;
+        features->AVXVNNIINT16 = registers[3] & b_AVXVNNIINT16;
+        features->PREFETCHI = registers[3] & b_PREFETCHI;
+        features->USERMSR = registers[3] & b_USERMSR;
+        features->AVX10 = registers[3] & b_AVX10;
+        features->APXF = registers[3] & b_APXF;
+    }
+}
+
+/**
+ * Function to detect the XSAVE instructions (leaf 13, sub-leaf 1).
+ */
+static void detect_leaf_d(cpu_features* CPUIDX_RESTRICT features,
+                          cpu_basic_info* CPUIDX_RESTRICT basic_info) {
+    if (basic_info->highest_basic_leaf < 0xd) return;
+
+    uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+
+    // sub-leaf 1
+    cpuid_extended(13, 1, registers);
+
+    // %eax flags
+    features->XSAVEOPT = registers[0] & b_XSAVEOPT;
+    features->XSAVEC = registers[0] & b_XSAVEC;
+    features->XSAVES = registers[0] & b_XSAVES;
+    features->XSAVEXFD = registers[0] & b_XSAVEXFD;
+}
+
+/**
+ * Function to detect the processor trace features (leaf 20).
+ */
+static void detect_leaf_14(cpu_features* CPUIDX_RESTRICT features,
+                           cpu_basic_info* CPUIDX_RESTRICT basic_info) {
+    if (basic_info->highest_basic_leaf < 0x14) return;
+
+    uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+
+    // sub-leaf 0
+    cpuid_extended(0x14, 0, registers);
+
+    // %ebx flags
+    features->PTWRITE = registers[1] & b_PTWRITE;
+}
+
+/**
+ * Function to detect the Key Locker features (leaf 25).
+ */
+static void detect_leaf_19(cpu_features* CPUIDX_RESTRICT features,
+                           cpu_basic_info* CPUIDX_RESTRICT basic_info) {
+    if (basic_info->highest_basic_leaf < 0x19) return;
+
+    uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+
+    cpuid(0x19, registers);
+
+    // %eax flags
+    features->AESKLE = registers[0] & b_AESKLE;
+    features->WIDEKL = registers[0] & b_WIDEKL;
+}
+
+/**
+ * Function to detect the AMX instructions (leaf 30, sub-leaf 1).
+ */
+static void detect_leaf_1e(cpu_features* CPUIDX_RESTRICT features,
+                           cpu_basic_info* CPUIDX_RESTRICT basic_info) {
+    if (basic_info->highest_basic_leaf < 0x1e) return;
+
+    uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+
+    // sub-leaf 1
+    cpuid_extended(0x1e, 1, registers);
+
+    // %eax flags
+    features->AMXFP8 = registers[0] & b_AMXFP8;
+    features->AMX_TRANSPOSE = registers[0] & b_AMX_TRANSPOSE;
+    features->AMX_TF32 = registers[0] & b_AMX_TF32;
+    features->AMX_AVX512 = registers[0] & b_AMX_AVX512;
+    features->AMX_MOVRS = registers[0] & b_AMX_MOVRS;
+}
+
+/**
+ * Function to detect the AVX10 vector lengths (leaf 0x24).
+ */
+static void detect_leaf_24(cpu_features* CPUIDX_RESTRICT features,
+                           cpu_basic_info* CPUIDX_RESTRICT basic_info) {
+    if (basic_info->highest_basic_leaf < 0x24) return;
+
+    uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+
+    cpuid_extended(0x24, 0, registers);
+
+    // %ebx flags
+    features->AVX10_256 = registers[1] & b_AVX10_256;
+    features->AVX10_512 = registers[1] & b_AVX10_512;
+}
+
+/**
+ * Function to detect the extended feature flags of leaf 0x80000001.
+ */
+static void detect_leaf_80000001(cpu_features* CPUIDX_RESTRICT features,
+                                 cpu_basic_info* CPUIDX_RESTRICT basic_info) {
+    if (basic_info->highest_extended_leaf < 0x80000001) return;
+
+    uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+
+    cpuid(0x80000001, registers);
+
+    // %ecx flags
+    features->LAHF_LM = registers[2] & b_LAHF_LM;
+    features->ABM = registers[2] & b_ABM;
+    features->SSE4a = registers[2] & b_SSE4a;
+    features->PRFCHW = registers[2] & b_PRFCHW;
+    features->XOP = registers[2] & b_XOP;
+    features->LWP = registers[2] & b_LWP;
+    features->FMA4 = registers[2] & b_FMA4;
+    features->TBM = registers[2] & b_TBM;
+    features->MWAITX = registers[2] & b_MWAITX;
+
+    // %edx flags
+    features->MMXEXT = registers[3] & b_MMXEXT;
+    features->RDTSCP = registers[3] & b_RDTSCP;
+    features->LM = registers[3] & b_LM;
+    features->x3DNOWP = registers[3] & b_3DNOWP;
+    features->x3DNOW = registers[3] & b_3DNOW;
+}
+
+/**
+ * Function to detect the extended feature flags of leaf 0x80000008.
+ */
+static void detect_leaf_80000008(cpu_features* CPUIDX_RESTRICT features,
+                                 cpu_basic_info* CPUIDX_RESTRICT basic_info) {
+    if (basic_info->highest_extended_leaf < 0x80000008) return;
+
+    uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+
+    cpuid(0x80000008, registers);
+
+    // %ebx flags
+    features->CLZERO = registers[1] & b_CLZERO;
+    features->RDPRU = registers[1] & b_RDPRU;
+    features->WBNOINVD = registers[1] & b_WBNOINVD;
+}
+
+/**
+ * Function to detect the extended feature flags of leaf 0x80000021.
+ */
+static void detect_leaf_80000021(cpu_features* CPUIDX_RESTRICT features,
+                                 cpu_basic_info* CPUIDX_RESTRICT basic_info) {
+    if (basic_info->highest_extended_leaf < 0x80000021) return;
+
+    uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+
+    cpuid(0x80000021, registers);
+
+    // %eax flags
+    features->UAI = registers[0] & b_UAI;
+}
+
+/**
+ * Function to read the brand string (leaves 0x80000002 to 0x80000004).
+ */
+static void detect_brand(cpu_features* CPUIDX_RESTRICT features,
+                         cpu_basic_info* CPUIDX_RESTRICT basic_info) {
+    (void) features;
+    if (basic_info->highest_extended_leaf < 0x80000004) return;
+
+    uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+
+    cpuid(0x80000002, registers);
+    memcpy(basic_info->brand, registers, 16);
+
+    cpuid(0x80000003, registers);
+    memcpy(basic_info->brand + 16, registers, 16);
+
+    cpuid(0x80000004, registers);
+    memcpy(basic_info->brand + 32, registers, 16);
+}
+
+/**
+ * @brief A CPUID leaf read by \p get_cpu_features_selective, and the feature groups that need it.
+ */
+struct leaf_detector {
+    uint32_t leaf; /**< The leaf, as in the CPUIDX_FEATURES table */
+    uint32_t groups; /**< The feature groups needing the leaf */
+    void (*detect)(cpu_features* CPUIDX_RESTRICT features, cpu_basic_info* CPUIDX_RESTRICT basic_info);
+};
+
+static const struct leaf_detector detectors[] = {
+    {0x1, CPUIDX_GROUP_ALL & ~CPUIDX_GROUP_BRAND, detect_leaf_1},
+    {0x7, CPUIDX_GROUP_SIMD | CPUIDX_GROUP_SECURITY | CPUIDX_GROUP_TOPOLOGY | CPUIDX_GROUP_SYSTEM, detect_leaf_7},
+    {0xd, CPUIDX_GROUP_SYSTEM, detect_leaf_d},
+    {0x14, CPUIDX_GROUP_SYSTEM, detect_leaf_14},
+    {0x19, CPUIDX_GROUP_SECURITY, detect_leaf_19},
+    {0x1e, CPUIDX_GROUP_SIMD, detect_leaf_1e},
+    {0x24, CPUIDX_GROUP_SIMD, detect_leaf_24},
+    {0x80000001, CPUIDX_GROUP_SIMD | CPUIDX_GROUP_SYSTEM, detect_leaf_80000001},
+    {0x80000002, CPUIDX_GROUP_BRAND, detect_brand},
+    {0x80000008, CPUIDX_GROUP_SYSTEM, detect_leaf_80000008},
+    {0x80000021, CPUIDX_GROUP_SYSTEM, detect_leaf_80000021},
+};
+
+#define DETECTOR_COUNT (sizeof(detectors) / sizeof(detectors[0]))
+
+/**
+ * Function to get CPU features and basic information, executing only the CPUID leaves of some feature groups.
  *
+ * Each leaf reports many features, so features outside the groups are also set when they share a leaf with
+ * the groups; the others are cleared. Under a hypervisor, where each CPUID traps, selecting the groups
+ * a caller needs saves most of the cost of \p get_cpu_features.
+ *
+ * \code
+ * // Leaves 0, 1, 7, 0x1E, 0x24, 0x80000000 and 0x80000001 only
+ * get_cpu_features_selective(CPUIDX_GROUP_SIMD, &features, &basic_info);
+ * \endcode
+ *
+ * @param groups A bitmask of \p cpuidx_feature_group values. The vendor and the highest leaves are always read.
  * @param features A pointer to a \p cpu_features structure to store the CPU features.
  * @param basic_info A pointer to a \p cpu_basic_info structure to store the basic CPU information.
  * @return 0 on success, -1 if CPUID instruction is not supported, 1 if highest leaf is 0.
  */
-int get_cpu_features(cpu_features* CPUIDX_RESTRICT features, cpu_basic_info* CPUIDX_RESTRICT basic_info) {
+int get_cpu_features_selective(const uint32_t groups, cpu_features* CPUIDX_RESTRICT features,
+                               cpu_basic_info* CPUIDX_RESTRICT basic_info) {
+    memset(features, 0, sizeof(*features));
+    memset(basic_info, 0, sizeof(*basic_info));
+
     if (!check_cpuid()) return -1;
 
     uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
@@ -98,323 +544,101 @@ int get_cpu_features(cpu_features* CPUIDX_RESTRICT features, cpu_basic_info* CPU
     // Query the highest function parameter and manufacturer ID
     cpuid(0, registers);
 
-    if ((basic_info->highest_basic_leaf = registers[0])) {
-        // The vendor string must be null-terminated
-        memset(basic_info->vendor, '\0', 13);
+    if (!(basic_info->highest_basic_leaf = registers[0])) return 1;
 
-        // Copy the vendor string
-        memcpy(basic_info->vendor, &registers[1], 4);
-        memcpy(basic_info->vendor + 4, &registers[3], 4);
-        memcpy(basic_info->vendor + 8, &registers[2], 4);
+    // Copy the vendor string
+    memcpy(basic_info->vendor, &registers[1], 4);
+    memcpy(basic_info->vendor + 4, &registers[3], 4);
+    memcpy(basic_info->vendor + 8, &registers[2], 4);
 
-        // Highest extended function calling parameter
+    // Highest extended function calling parameter, if an extended leaf is needed
+    bool extended = groups & CPUIDX_GROUP_BASIC;
+    for (size_t i = 0; i < DETECTOR_COUNT; ++i) {
+        if (detectors[i].leaf >= 0x80000000 && detectors[i].groups & groups) extended = true;
+    }
+    if (extended) {
         cpuid(0x80000000, registers);
         basic_info->highest_extended_leaf = registers[0];
+    }
 
-        // Ensure the brand string is null-terminated, whether it is implemented or not
-        memset(basic_info->brand, '\0', 49);
-
-        // Check for the CPU brand string
-        if (basic_info->highest_extended_leaf >= 0x80000004) {
-            // Get the brand string
-            cpuid(0x80000002, registers);
-            memcpy(basic_info->brand, registers, 16);
-
-            cpuid(0x80000003, registers);
-            memcpy(basic_info->brand + 16, registers, 16);
-
-            cpuid(0x80000004, registers);
-            memcpy(basic_info->brand + 32, registers, 16);
-        }
-
-        // Check for the CPU family, model, and stepping
-        cpuid(1, registers);
-        basic_info->family = ((registers[0] >> 8) & 0xF) + ((registers[0] >> 20) & 0xFF);
-        basic_info->model = ((registers[0] >> 4) & 0xF) + ((registers[0] >> 12) & 0xF0);
-        basic_info->stepping = registers[0] & 0xF;
-
-        // Standard feature flags (CPUID Leaf 1)
-        // %ecx flags
-        features->SSE3 = registers[2] & b_SSE3;
-        features->PCLMULQDQ = registers[2] & b_PCLMULQDQ;
-        features->DTES64 = registers[2] & b_DTES64;
-        features->MONITOR = registers[2] & b_MONITOR;
-        features->DSCPL = registers[2] & b_DSCPL;
-        features->VMX = registers[2] & b_VMX;
-        features->SMX = registers[2] & b_SMX;
-        features->EIST = registers[2] & b_EIST;
-        features->TM2 = registers[2] & b_TM2;
-        features->SSSE3 = registers[2] & b_SSSE3;
-        features->CNXTID = registers[2] & b_CNXTID;
-        features->SDBG = registers[2] & b_SDBG;
-        features->FMA = registers[2] & b_FMA;
-        features->CMPXCHG16B = registers[2] & b_CMPXCHG16B;
-        features->xTPR = registers[2] & b_xTPR;
-        features->PDCM = registers[2] & b_PDCM;
-        features->PCID = registers[2] & b_PCID;
-        features->DCA = registers[2] & b_DCA;
-        features->SSE41 = registers[2] & b_SSE41;
-        features->SSE42 = registers[2] & b_SSE42;
-        features->x2APIC = registers[2] & b_x2APIC;
-        features->MOVBE = registers[2] & b_MOVBE;
-        features->POPCNT = registers[2] & b_POPCNT;
-        features->TSCDeadline = registers[2] & b_TSCDeadline;
-        features->AESNI = registers[2] & b_AESNI;
-        features->XSAVE = registers[2] & b_XSAVE;
-        features->OSXSAVE = registers[2] & b_OSXSAVE;
-        features->AVX = registers[2] & b_AVX;
-        features->F16C = registers[2] & b_F16C;
-        features->RDRND = registers[2] & b_RDRND;
-        features->HYPRVSR = registers[2] & b_HYPRVSR;
+    for (size_t i = 0; i < DETECTOR_COUNT; ++i) {
+        if (detectors[i].groups & groups) detectors[i].detect(features, basic_info);
+    }
 
-        // %edx flags
-        features->FPU = registers[3] & b_FPU;
-        features->VME = registers[3] & b_VME;
-        features->DE = registers[3] & b_DE;
-        features->PSE = registers[3] & b_PSE;
-        features->TSC = registers[3] & b_TSC;
-        features->MSR = registers[3] & b_MSR;
-        features->PAE = registers[3] & b_PAE;
-        features->MCE = registers[3] & b_MCE;
-        features->CX8 = registers[3] & b_CX8;
-        features->APIC = registers[3] & b_APIC;
-        features->SEP = registers[3] & b_SEP;
-        features->MTRR = registers[3] & b_MTRR;
-        features->PGE = registers[3] & b_PGE;
-        features->MCA = registers[3] & b_MCA;
-        features->CMOV = registers[3] & b_CMOV;
-        features->PAT = registers[3] & b_PAT;
-        features->PSE36 = registers[3] & b_PSE36;
-        features->PSN = registers[3] & b_PSN;
-        features->CLFSH = registers[3] & b_CLFSH;
-        features->DS = registers[3] & b_DS;
-        features->ACPI = registers[3] & b_ACPI;
-        features->MMX = registers[3] & b_MMX;
-        features->FXSR = registers[3] & b_FXSR;
-        features->SSE = registers[3] & b_SSE;
-        features->SSE2 = registers[3] & b_SSE2;
-        features->SS = registers[3] & b_SS;
-        features->HTT = registers[3] & b_HTT;
-        features->TM = registers[3] & b_TM;
-        features->IA64 = registers[3] & b_IA64;
-        features->PBE = registers[3] & b_PBE;
-
-        // Check for extended feature flags (CPUID Leaf 7)
-        if (basic_info->highest_basic_leaf >= 7) {
-            // sub-leaf 0
-            cpuid_extended(7, 0, registers);
-
-            // %ebx flags
-            features->FSGSBASE = registers[1] & b_FSGSBASE;
-            features->SGX = registers[1] & b_SGX;
-            features->BMI = registers[1] & b_BMI;
-            features->HLE = registers[1] & b_HLE;
-            features->FDPXO = registers[1] & b_FDPXO;
-            features->AVX2 = registers[1] & b_AVX2;
-            features->SMEP = registers[1] & b_SMEP;
-            features->BMI2 = registers[1] & b_BMI2;
-            features->ENH_MOVSB = registers[1] & b_ENH_MOVSB;
-            features->INVPCID = registers[1] & b_INVPCID;
-            features->RTM = registers[1] & b_RTM;
-            features->MPX = registers[1] & b_MPX;
-            features->AVX512F = registers[1] & b_AVX512F;
-            features->AVX512DQ = registers[1] & b_AVX512DQ;
-            features->RDSEED = registers[1] & b_RDSEED;
-            features->ADX = registers[1] & b_ADX;
-            features->SMAP = registers[1] & b_SMAP;
-            features->AVX512IFMA = registers[1] & b_AVX512IFMA;
-            features->CLFLUSHOPT = registers[1] & b_CLFLUSHOPT;
-            features->CLWB = registers[1] & b_CLWB;
-            features->PT = registers[1] & b_PT;
-            features->AVX512PF = registers[1] & b_AVX512PF;
-            features->AVX512ER = registers[1] & b_AVX512ER;
-            features->AVX512CD = registers[1] & b_AVX512CD;
-            features->SHA = registers[1] & b_SHA;
-            features->AVX512BW = registers[1] & b_AVX512BW;
-            features->AVX512VL = registers[1] & b_AVX512VL;
-
-            // %ecx flags
-            features->PREFTCHWT1 = registers[2] & b_PREFTCHWT1;
-            features->AVX512VBMI = registers[2] & b_AVX512VBMI;
-            features->UMIP = registers[2] & b_UMIP;
-            features->PKU = registers[2] & b_PKU;
-            features->OSPKE = registers[2] & b_OSPKE;
-            features->WAITPKG = registers[2] & b_WAITPKG;
-            features->AVX512VBMI2 = registers[2] & b_AVX512VBMI2;
-            features->SHSTK = registers[2] & b_SHSTK;
-            features->GFNI = registers[2] & b_GFNI;
-            features->VAES = registers[2] & b_VAES;
-            features->VPCLMULQDQ = registers[2] & b_VPCLMULQDQ;
-            features->AVX512VNNI = registers[2] & b_AVX512VNNI;
-            features->AVX512BITALG = registers[2] & b_AVX512BITALG;
-            features->TMEM = registers[2] & b_TMEM;
-            features->AVX512VPOPCNTDQ = registers[2] & b_AVX512VPOPCNTDQ;
-            features->IA57 = registers[2] & b_IA57;
-            features->RDPID = registers[2] & b_RDPID;
-            features->KL = registers[2] & b_KL;
-            features->BLD = registers[2] & b_BLD;
-            features->CLDEMOTE = registers[2] & b_CLDEMOTE;
-            features->MOVDIRI = registers[2] & b_MOVDIRI;
-            features->MOVDIR64B = registers[2] & b_MOVDIR64B;
-            features->ENQCMD = registers[2] & b_ENQCMD;
-            features->SGXLC = registers[2] & b_SGXLC;
-            features->PKS = registers[2] & b_PKS;
-
-            // %edx flags
-            features->SGXKEYS = registers[3] & b_SGXKEYS;
-            features->AVX5124VNNIW = registers[3] & b_AVX5124VNNIW;
-            features->AVX5124FMAPS = registers[3] & b_AVX5124FMAPS;
-            features->FSRM = registers[3] & b_FSRM;
-            features->UINTR = registers[3] & b_UINTR;
-            features->AVX512VP2INTERSECT = registers[3] & b_AVX512VP2INTERSECT;
-            features->SRBDSCTRL = registers[3] & b_SRBDSCTRL;
-            features->MDCLEAR = registers[3] & b_MDCLEAR;
-            features->RTMAA = registers[3] & b_RTMAA;
-            features->RTMFA = registers[3] & b_RTMFA;
-            features->SERIALIZE = registers[3] & b_SERIALIZE;
-            features->HYBRID = registers[3] & b_HYBRID;
-            features->TSXLDTRK = registers[3] & b_TSXLDTRK;
-            features->PCONFIG = registers[3] & b_PCONFIG;
-            features->LBR = registers[3] & b_LBR;
-            features->IBT = registers[3] & b_IBT;
-            features->AMXBF16 = registers[3] & b_AMXBF16;
-            features->AVX512FP16 = registers[3] & b_AVX512FP16;
-            features->AMXTILE = registers[3] & b_AMXTILE;
-            features->AMXINT8 = registers[3] & b_AMXINT8;
-            features->IBRRS = registers[3] & b_IBRRS;
-            features->STIBP = registers[3] & b_STIBP;
-            features->L1D_FLUSH = registers[3] & b_L1D_FLUSH;
-            features->IA32_ARCH_CAPABILITIES = registers[3] & b_IA32_ARCH_CAPABILITIES;
-            features->IA32_CORE_CAPABILITIES = registers[3] & b_IA32_CORE_CAPABILITIES;
-            features->SSBD = registers[3] & b_SSBD;
-
-            // max ecx value is stored in eax
-            const uint32_t max_ecx = registers[0];
-
-            // sub-leaf 1
-            if (max_ecx) {
-                cpuid_extended(7, 1, registers);
-
-                // %eax flags
-                features->SHA512 = registers[0] & b_SHA512;
-                features->SM3 = registers[0] & b_SM3;
-                features->SM4 = registers[0] & b_SM4;
-                features->RAOINT = registers[0] & b_RAOINT;
-                features->AVXVNNI = registers[0] & b_AVXVNNI;
-                features->AVX512BF16 = registers[0] & b_AVX512BF16;
-                features->CMPCCXADD = registers[0] & b_CMPCCXADD;
-                features->FRED = registers[0] & b_FRED;
-                features->LKGS = registers[0] & b_LKGS;
-                features->WRMSRNS = registers[0] & b_WRMSRNS;
-                features->NMISRC = registers[0] & b_NMISRC;
-                features->AMXFP16 = registers[0] & b_AMXFP16;
-                features->HRESET = registers[0] & b_HRESET;
-                features->AVXIFMA = registers[0] & b_AVXIFMA;
-                features->MSRLIST = registers[0] & b_MSRLIST;
-                features->MOVRS = registers[0] & b_MOVRS;
-
-                // %ebx flags
-                features->PBNDKB = registers[1] & b_PBNDKB;
-
-                // %edx flags
-                features->AVXVNNIINT8 = registers[3] & b_AVXVNNIINT8;
-                features->AVXNECONVERT = registers[3] & b_AVXNECONVERT;
-                features->AMXCOMPLEX = registers[3] & b_AMXCOMPLEX;
-                features->AVXVNNIINT16 = registers[3] & b_AVXVNNIINT16;
-                features->PREFETCHI = registers[3] & b_PREFETCHI;
-                features->USERMSR = registers[3] & b_USERMSR;
-                features->AVX10 = registers[3] & b_AVX10;
-                features->APXF = registers[3] & b_APXF;
-            }
-        }
-
-        // Leaf 13
-        if (basic_info->highest_basic_leaf >= 0xd) {
-            // sub-leaf 1
-            cpuid_extended(13, 1, registers);
-
-            // %eax flags
-            features->XSAVEOPT = registers[0] & b_XSAVEOPT;
-            features->XSAVEC = registers[0] & b_XSAVEC;
-            features->XSAVES = registers[0] & b_XSAVES;
-            features->XSAVEXFD = registers[0] & b_XSAVEXFD;
-        }
-
-        // Leaf 20
-        if (basic_info->highest_basic_leaf >= 0x14) {
-            // sub-leaf 0
-            cpuid_extended(0x14, 0, registers);
-
-            // %ebx flags
-            features->PTWRITE = registers[1] & b_PTWRITE;
-        }
-
-        // Keylocker leaf (leaf 25)
-        if (basic_info->highest_basic_leaf >= 0x19) {
-            cpuid(0x19, registers);
-
-            // %eax flags
-            features->AESKLE = registers[0] & b_AESKLE;
-            features->WIDEKL = registers[0] & b_WIDEKL;
-        }
-
-        // AMX sub-leaf
-        if (basic_info->highest_basic_leaf >= 0x1e) {
-            // sub-leaf 1
-            cpuid_extended(0x1e, 1, registers);
-
-            // %eax flags
-            features->AMXFP8 = registers[0] & b_AMXFP8;
-            features->AMX_TRANSPOSE = registers[0] & b_AMX_TRANSPOSE;
-            features->AMX_TF32 = registers[0] & b_AMX_TF32;
-            features->AMX_AVX512 = registers[0] & b_AMX_AVX512;
-            features->AMX_MOVRS = registers[0] & b_AMX_MOVRS;
-        }
-
-        // Leaf 0x24
-        if (basic_info->highest_basic_leaf >= 0x24) {
-            cpuid_extended(0x24, 0, registers);
-
-            // %ebx flags
-            features->AVX10_256 = registers[1] & b_AVX10_256;
-            features->AVX10_512 = registers[1] & b_AVX10_512;
-        }
-
-        // Extended feature leaves
-        // Leaf 0x80000001
-        if (basic_info->highest_extended_leaf >= 0x80000001) {
-            cpuid(0x80000001, registers);
-
-            // %ecx flags
-            features->LAHF_LM = registers[2] & b_LAHF_LM;
-            features->ABM = registers[2] & b_ABM;
-            features->SSE4a = registers[2] & b_SSE4a;
-            features->PRFCHW = registers[2] & b_PRFCHW;
-            features->XOP = registers[2] & b_XOP;
-            features->LWP = registers[2] & b_LWP;
-            features->FMA4 = registers[2] & b_FMA4;
-            features->TBM = registers[2] & b_TBM;
-            features->MWAITX = registers[2] & b_MWAITX;
-
-            // %edx flags
-            features->MMXEXT = registers[3] & b_MMXEXT;
-            features->LM = registers[3] & b_LM;
-            features->x3DNOWP = registers[3] & b_3DNOWP;
-            features->x3DNOW = registers[3] & b_3DNOW;
-        }
-
-        // Leaf 0x80000008
-        if (basic_info->highest_extended_leaf >= 0x80000008) {
-            cpuid(0x80000008, registers);
-
-            // %ebx flags
-            features->CLZERO = registers[1] & b_CLZERO;
-            features->RDPRU = registers[1] & b_RDPRU;
-            features->WBNOINVD = registers[1] & b_WBNOINVD;
-        }
-
-        return 0;
+    return 0;
+}
+
+/**
+ * Function to get CPU features and basic information.
+ *
+ * @param features A pointer to a \p cpu_features structure to store the CPU features.
+ * @param basic_info A pointer to a \p cpu_basic_info structure to store the basic CPU information.
+ * @return 0 on success, -1 if CPUID instruction is not supported, 1 if highest leaf is 0.
+ */
+int get_cpu_features(cpu_features* CPUIDX_RESTRICT features, cpu_basic_info* CPUIDX_RESTRICT basic_info) {
+    return get_cpu_features_selective(CPUIDX_GROUP_ALL, features, basic_info);
+}
+
+#define CPUIDX_X_LEAF(field, name, leaf, sub_leaf, reg, mask) leaf,
+
+static const uint32_t feature_leaves[CPUIDX_FEATURE_COUNT] = {CPUIDX_FEATURES(CPUIDX_X_LEAF)};
+
+#undef CPUIDX_X_LEAF
+
+/**
+ * Function to get the feature groups that detect a feature, for \p get_cpu_features_selective.
+ *
+ * @param index The index of the feature, a \p cpuidx_feature value.
+ * @return A bitmask of \p cpuidx_feature_group values, 0 if \p index is out of range.
+ */
+uint32_t cpuidx_feature_groups(const size_t index) {
+    if (index >= CPUIDX_FEATURE_COUNT) return 0;
+
+    for (size_t i = 0; i < DETECTOR_COUNT; ++i) {
+        if (detectors[i].leaf == feature_leaves[index]) return detectors[i].groups;
     }
+    return 0;
+}
+
+static cpu_features cached_features;
+static cpu_basic_info cached_basic_info;
+static long cached_claimed;
+static long cached_ready;
+
+/**
+ * Function to detect the CPU features once, and share the result.
+ *
+ * The first caller reads the snapshot published by \p cpuidzd, or detects the features if there is none;
+ * concurrent callers wait for it to publish the result.
+ */
+static void detect_cached(void) {
+    if (CPUIDX_LOAD_ACQUIRE(&cached_ready)) return;
+
+    if (CPUIDX_EXCHANGE(&cached_claimed, 1) == 0) {
+        if (cpuidx_snapshot_features(&cached_features, &cached_basic_info) != 0)
+            get_cpu_features(&cached_features, &cached_basic_info);
+        CPUIDX_STORE_RELEASE(&cached_ready, 1);
+    } else {
+        while (!CPUIDX_LOAD_ACQUIRE(&cached_ready)) CPUIDX_PAUSE();
+    }
+}
 
-    return 1;
+/**
+ * Function to get the CPU features, detected once per process.
+ *
+ * @return A pointer to the detected features. All features are unset if the CPUID instruction is not supported.
+ */
+const cpu_features* cpuidx_cached_features(void) {
+    detect_cached();
+    return &cached_features;
+}
+
+/**
+ * Function to get the basic CPU information, detected once per process.
+ *
+ * @return A pointer to the detected information. All fields are zero if the CPUID instruction is not supported.
+ */
+const cpu_basic_info* cpuidx_cached_basic_info(void) {
+    detect_cached();
+    return &cached_basic_info;
 }
@@ -35,6 +35,7 @@ extern "C" {
 #endif // defined(__GNUC__)
 #endif // __STDC_VERSION__ >= 202000L
 
+#include <stddef.h>
 #include <stdint.h>
 #ifndef CPUIDX_BOOL_AVAILABLE
 #include <stdbool.h>
@@ -55,6 +56,8 @@ struct cpu_basic_info {
 
 /**
 * @brief Structure to hold CPU features.
+*
+* Callers allocate it, so new fields go at the end, keeping the offsets of the others across library versions.
 */
 struct cpu_features {
     bool SSE3; /**< Prescott New Instructions - PNI */
@@ -251,6 +254,9 @@ struct cpu_features {
     bool CLZERO; /**< CLZERO instruction */
     bool RDPRU; /**< RDPRU instruction */
     bool WBNOINVD; /**< WBNOINVD instruction */
+    bool RDTSCP; /**< RDTSCP instruction and IA32_TSC_AUX MSR */
+    bool UAI; /**< Upper Address Ignore */
+    bool LAM; /**< Linear Address Masking */
 };
 
 #ifdef CPUIDX_CONSTEXPR_AVAILABLE
@@ -418,6 +424,7 @@ constexpr uint32_t b_NMISRC = 0x00100000;
 constexpr uint32_t b_AMXFP16 = 0x00200000;
 constexpr uint32_t b_HRESET = 0x00400000;
 constexpr uint32_t b_AVXIFMA = 0x00800000;
+constexpr uint32_t b_LAM = 0x04000000;
 constexpr uint32_t b_MSRLIST = 0x08000000;
 constexpr uint32_t b_MOVRS = 0x80000000;
 
@@ -471,6 +478,7 @@ constexpr uint32_t b_MWAITX = 0x20000000;
 
 // Features in edx for leaf 0x80000001
 constexpr uint32_t b_MMXEXT = 0x00400000;
+constexpr uint32_t b_RDTSCP = 0x08000000;
 constexpr uint32_t b_LM = 0x20000000;
 constexpr uint32_t b_3DNOWP = 0x40000000;
 constexpr uint32_t b_3DNOW = 0x80000000;
@@ -480,6 +488,9 @@ constexpr uint32_t b_CLZERO = 0x00000001;
 constexpr uint32_t b_RDPRU = 0x00000010;
 constexpr uint32_t b_WBNOINVD = 0x00000200;
 
+// Features in eax for leaf 0x80000021
+constexpr uint32_t b_UAI = 0x00000080;
+
 #else
 
 enum {
@@ -647,6 +658,7 @@ enum {
     b_AMXFP16 = 0x00200000,
     b_HRESET = 0x00400000,
     b_AVXIFMA = 0x00800000,
+    b_LAM = 0x04000000,
     b_MSRLIST = 0x08000000,
     b_MOVRS = 0x80000000,
 
@@ -700,6 +712,7 @@ enum {
 
     // Features in edx for leaf 0x80000001
     b_MMXEXT = 0x00400000,
+    b_RDTSCP = 0x08000000,
     b_LM = 0x20000000,
     b_3DNOWP = 0x40000000,
     b_3DNOW = 0x80000000,
@@ -708,9 +721,642 @@ enum {
     b_CLZERO = 0x00000001,
     b_RDPRU = 0x00000010,
     b_WBNOINVD = 0x00000200,
+
+    // Features in eax for leaf 0x80000021
+    b_UAI = 0x00000080,
 };
 #endif
 
+/**
+* @brief X-macro listing every field of \p cpu_features, in declaration order.
+*
+* Each entry is <tt>X(field, name, leaf, sub_leaf, reg, mask)</tt>, where \p reg indexes the
+* CPUID registers array (0 = EAX, 1 = EBX, 2 = ECX, 3 = EDX) and \p mask is the feature bit.
+*/
+#define CPUIDX_FEATURES(X) \
+    X(SSE3, "SSE3", 0x1, 0, 2, b_SSE3) \
+    X(PCLMULQDQ, "PCLMULQDQ", 0x1, 0, 2, b_PCLMULQDQ) \
+    X(DTES64, "DTES64", 0x1, 0, 2, b_DTES64) \
+    X(MONITOR, "MONITOR", 0x1, 0, 2, b_MONITOR) \
+    X(DSCPL, "DSCPL", 0x1, 0, 2, b_DSCPL) \
+    X(VMX, "VMX", 0x1, 0, 2, b_VMX) \
+    X(SMX, "SMX", 0x1, 0, 2, b_SMX) \
+    X(EIST, "EIST", 0x1, 0, 2, b_EIST) \
+    X(TM2, "TM2", 0x1, 0, 2, b_TM2) \
+    X(SSSE3, "SSSE3", 0x1, 0, 2, b_SSSE3) \
+    X(CNXTID, "CNXTID", 0x1, 0, 2, b_CNXTID) \
+    X(SDBG, "SDBG", 0x1, 0, 2, b_SDBG) \
+    X(FMA, "FMA", 0x1, 0, 2, b_FMA) \
+    X(CMPXCHG16B, "CMPXCHG16B", 0x1, 0, 2, b_CMPXCHG16B) \
+    X(xTPR, "xTPR", 0x1, 0, 2, b_xTPR) \
+    X(PDCM, "PDCM", 0x1, 0, 2, b_PDCM) \
+    X(PCID, "PCID", 0x1, 0, 2, b_PCID) \
+    X(DCA, "DCA", 0x1, 0, 2, b_DCA) \
+    X(SSE41, "SSE41", 0x1, 0, 2, b_SSE41) \
+    X(SSE42, "SSE42", 0x1, 0, 2, b_SSE42) \
+    X(x2APIC, "x2APIC", 0x1, 0, 2, b_x2APIC) \
+    X(MOVBE, "MOVBE", 0x1, 0, 2, b_MOVBE) \
+    X(POPCNT, "POPCNT", 0x1, 0, 2, b_POPCNT) \
+    X(TSCDeadline, "TSCDeadline", 0x1, 0, 2, b_TSCDeadline) \
+    X(AESNI, "AESNI", 0x1, 0, 2, b_AESNI) \
+    X(XSAVE, "XSAVE", 0x1, 0, 2, b_XSAVE) \
+    X(OSXSAVE, "OSXSAVE", 0x1, 0, 2, b_OSXSAVE) \
+    X(AVX, "AVX", 0x1, 0, 2, b_AVX) \
+    X(F16C, "F16C", 0x1, 0, 2, b_F16C) \
+    X(RDRND, "RDRND", 0x1, 0, 2, b_RDRND) \
+    X(HYPRVSR, "HYPRVSR", 0x1, 0, 2, b_HYPRVSR) \
+    X(FPU, "FPU", 0x1, 0, 3, b_FPU) \
+    X(VME, "VME", 0x1, 0, 3, b_VME) \
+    X(DE, "DE", 0x1, 0, 3, b_DE) \
+    X(PSE, "PSE", 0x1, 0, 3, b_PSE) \
+    X(TSC, "TSC", 0x1, 0, 3, b_TSC) \
+    X(MSR, "MSR", 0x1, 0, 3, b_MSR) \
+    X(PAE, "PAE", 0x1, 0, 3, b_PAE) \
+    X(MCE, "MCE", 0x1, 0, 3, b_MCE) \
+    X(CX8, "CX8", 0x1, 0, 3, b_CX8) \
+    X(APIC, "APIC", 0x1, 0, 3, b_APIC) \
+    X(SEP, "SEP", 0x1, 0, 3, b_SEP) \
+    X(MTRR, "MTRR", 0x1, 0, 3, b_MTRR) \
+    X(PGE, "PGE", 0x1, 0, 3, b_PGE) \
+    X(MCA, "MCA", 0x1, 0, 3, b_MCA) \
+    X(CMOV, "CMOV", 0x1, 0, 3, b_CMOV) \
+    X(PAT, "PAT", 0x1, 0, 3, b_PAT) \
+    X(PSE36, "PSE36", 0x1, 0, 3, b_PSE36) \
+    X(PSN, "PSN", 0x1, 0, 3, b_PSN) \
+    X(CLFSH, "CLFSH", 0x1, 0, 3, b_CLFSH) \
+    X(DS, "DS", 0x1, 0, 3, b_DS) \
+    X(ACPI, "ACPI", 0x1, 0, 3, b_ACPI) \
+    X(MMX, "MMX", 0x1, 0, 3, b_MMX) \
+    X(FXSR, "FXSR", 0x1, 0, 3, b_FXSR) \
+    X(SSE, "SSE", 0x1, 0, 3, b_SSE) \
+    X(SSE2, "SSE2", 0x1, 0, 3, b_SSE2) \
+    X(SS, "SS", 0x1, 0, 3, b_SS) \
+    X(HTT, "HTT", 0x1, 0, 3, b_HTT) \
+    X(TM, "TM", 0x1, 0, 3, b_TM) \
+    X(IA64, "IA64", 0x1, 0, 3, b_IA64) \
+    X(PBE, "PBE", 0x1, 0, 3, b_PBE) \
+    X(FSGSBASE, "FSGSBASE", 0x7, 0, 1, b_FSGSBASE) \
+    X(SGX, "SGX", 0x7, 0, 1, b_SGX) \
+    X(BMI, "BMI", 0x7, 0, 1, b_BMI) \
+    X(HLE, "HLE", 0x7, 0, 1, b_HLE) \
+    X(AVX2, "AVX2", 0x7, 0, 1, b_AVX2) \
+    X(FDPXO, "FDPXO", 0x7, 0, 1, b_FDPXO) \
+    X(SMEP, "SMEP", 0x7, 0, 1, b_SMEP) \
+    X(BMI2, "BMI2", 0x7, 0, 1, b_BMI2) \
+    X(ENH_MOVSB, "ENH_MOVSB", 0x7, 0, 1, b_ENH_MOVSB) \
+    X(INVPCID, "INVPCID", 0x7, 0, 1, b_INVPCID) \
+    X(RTM, "RTM", 0x7, 0, 1, b_RTM) \
+    X(MPX, "MPX", 0x7, 0, 1, b_MPX) \
+    X(AVX512F, "AVX512F", 0x7, 0, 1, b_AVX512F) \
+    X(AVX512DQ, "AVX512DQ", 0x7, 0, 1, b_AVX512DQ) \
+    X(RDSEED, "RDSEED", 0x7, 0, 1, b_RDSEED) \
+    X(ADX, "ADX", 0x7, 0, 1, b_ADX) \
+    X(SMAP, "SMAP", 0x7, 0, 1, b_SMAP) \
+    X(AVX512IFMA, "AVX512IFMA", 0x7, 0, 1, b_AVX512IFMA) \
+    X(CLFLUSHOPT, "CLFLUSHOPT", 0x7, 0, 1, b_CLFLUSHOPT) \
+    X(CLWB, "CLWB", 0x7, 0, 1, b_CLWB) \
+    X(PT, "PT", 0x7, 0, 1, b_PT) \
+    X(AVX512PF, "AVX512PF", 0x7, 0, 1, b_AVX512PF) \
+    X(AVX512ER, "AVX512ER", 0x7, 0, 1, b_AVX512ER) \
+    X(AVX512CD, "AVX512CD", 0x7, 0, 1, b_AVX512CD) \
+    X(SHA, "SHA", 0x7, 0, 1, b_SHA) \
+    X(AVX512BW, "AVX512BW", 0x7, 0, 1, b_AVX512BW) \
+    X(AVX512VL, "AVX512VL", 0x7, 0, 1, b_AVX512VL) \
+    X(PREFTCHWT1, "PREFTCHWT1", 0x7, 0, 2, b_PREFTCHWT1) \
+    X(AVX512VBMI, "AVX512VBMI", 0x7, 0, 2, b_AVX512VBMI) \
+    X(UMIP, "UMIP", 0x7, 0, 2, b_UMIP) \
+    X(PKU, "PKU", 0x7, 0, 2, b_PKU) \
+    X(OSPKE, "OSPKE", 0x7, 0, 2, b_OSPKE) \
+    X(WAITPKG, "WAITPKG", 0x7, 0, 2, b_WAITPKG) \
+    X(AVX512VBMI2, "AVX512VBMI2", 0x7, 0, 2, b_AVX512VBMI2) \
+    X(SHSTK, "SHSTK", 0x7, 0, 2, b_SHSTK) \
+    X(GFNI, "GFNI", 0x7, 0, 2, b_GFNI) \
+    X(VAES, "VAES", 0x7, 0, 2, b_VAES) \
+    X(VPCLMULQDQ, "VPCLMULQDQ", 0x7, 0, 2, b_VPCLMULQDQ) \
+    X(AVX512VNNI, "AVX512VNNI", 0x7, 0, 2, b_AVX512VNNI) \
+    X(AVX512BITALG, "AVX512BITALG", 0x7, 0, 2, b_AVX512BITALG) \
+    X(TMEM, "TMEM", 0x7, 0, 2, b_TMEM) \
+    X(AVX512VPOPCNTDQ, "AVX512VPOPCNTDQ", 0x7, 0, 2, b_AVX512VPOPCNTDQ) \
+    X(IA57, "IA57", 0x7, 0, 2, b_IA57) \
+    X(RDPID, "RDPID", 0x7, 0, 2, b_RDPID) \
+    X(KL, "KL", 0x7, 0, 2, b_KL) \
+    X(BLD, "BLD", 0x7, 0, 2, b_BLD) \
+    X(CLDEMOTE, "CLDEMOTE", 0x7, 0, 2, b_CLDEMOTE) \
+    X(MOVDIRI, "MOVDIRI", 0x7, 0, 2, b_MOVDIRI) \
+    X(MOVDIR64B, "MOVDIR64B", 0x7, 0, 2, b_MOVDIR64B) \
+    X(ENQCMD, "ENQCMD", 0x7, 0, 2, b_ENQCMD) \
+    X(SGXLC, "SGXLC", 0x7, 0, 2, b_SGXLC) \
+    X(PKS, "PKS", 0x7, 0, 2, b_PKS) \
+    X(SGXKEYS, "SGXKEYS", 0x7, 0, 3, b_SGXKEYS) \
+    X(AVX5124VNNIW, "AVX5124VNNIW", 0x7, 0, 3, b_AVX5124VNNIW) \
+    X(AVX5124FMAPS, "AVX5124FMAPS", 0x7, 0, 3, b_AVX5124FMAPS) \
+    X(FSRM, "FSRM", 0x7, 0, 3, b_FSRM) \
+    X(UINTR, "UINTR", 0x7, 0, 3, b_UINTR) \
+    X(AVX512VP2INTERSECT, "AVX512VP2INTERSECT", 0x7, 0, 3, b_AVX512VP2INTERSECT) \
+    X(SRBDSCTRL, "SRBDSCTRL", 0x7, 0, 3, b_SRBDSCTRL) \
+    X(MDCLEAR, "MDCLEAR", 0x7, 0, 3, b_MDCLEAR) \
+    X(RTMAA, "RTMAA", 0x7, 0, 3, b_RTMAA) \
+    X(RTMFA, "RTMFA", 0x7, 0, 3, b_RTMFA) \
+    X(SERIALIZE, "SERIALIZE", 0x7, 0, 3, b_SERIALIZE) \
+    X(HYBRID, "HYBRID", 0x7, 0, 3, b_HYBRID) \
+    X(TSXLDTRK, "TSXLDTRK", 0x7, 0, 3, b_TSXLDTRK) \
+    X(PCONFIG, "PCONFIG", 0x7, 0, 3, b_PCONFIG) \
+    X(LBR, "LBR", 0x7, 0, 3, b_LBR) \
+    X(IBT, "IBT", 0x7, 0, 3, b_IBT) \
+    X(AMXBF16, "AMXBF16", 0x7, 0, 3, b_AMXBF16) \
+    X(AVX512FP16, "AVX512FP16", 0x7, 0, 3, b_AVX512FP16) \
+    X(AMXTILE, "AMXTILE", 0x7, 0, 3, b_AMXTILE) \
+    X(AMXINT8, "AMXINT8", 0x7, 0, 3, b_AMXINT8) \
+    X(IBRRS, "IBRRS", 0x7, 0, 3, b_IBRRS) \
+    X(STIBP, "STIBP", 0x7, 0, 3, b_STIBP) \
+    X(L1D_FLUSH, "L1D_FLUSH", 0x7, 0, 3, b_L1D_FLUSH) \
+    X(IA32_ARCH_CAPABILITIES, "IA32_ARCH_CAPABILITIES", 0x7, 0, 3, b_IA32_ARCH_CAPABILITIES) \
+    X(IA32_CORE_CAPABILITIES, "IA32_CORE_CAPABILITIES", 0x7, 0, 3, b_IA32_CORE_CAPABILITIES) \
+    X(SSBD, "SSBD", 0x7, 0, 3, b_SSBD) \
+    X(SHA512, "SHA512", 0x7, 1, 0, b_SHA512) \
+    X(SM3, "SM3", 0x7, 1, 0, b_SM3) \
+    X(SM4, "SM4", 0x7, 1, 0, b_SM4) \
+    X(RAOINT, "RAOINT", 0x7, 1, 0, b_RAOINT) \
+    X(AVXVNNI, "AVXVNNI", 0x7, 1, 0, b_AVXVNNI) \
+    X(AVX512BF16, "AVX512BF16", 0x7, 1, 0, b_AVX512BF16) \
+    X(CMPCCXADD, "CMPCCXADD", 0x7, 1, 0, b_CMPCCXADD) \
+    X(FRED, "FRED", 0x7, 1, 0, b_FRED) \
+    X(LKGS, "LKGS", 0x7, 1, 0, b_LKGS) \
+    X(WRMSRNS, "WRMSRNS", 0x7, 1, 0, b_WRMSRNS) \
+    X(NMISRC, "NMISRC", 0x7, 1, 0, b_NMISRC) \
+    X(AMXFP16, "AMXFP16", 0x7, 1, 0, b_AMXFP16) \
+    X(HRESET, "HRESET", 0x7, 1, 0, b_HRESET) \
+    X(AVXIFMA, "AVXIFMA", 0x7, 1, 0, b_AVXIFMA) \
+    X(MSRLIST, "MSRLIST", 0x7, 1, 0, b_MSRLIST) \
+    X(MOVRS, "MOVRS", 0x7, 1, 0, b_MOVRS) \
+    X(PBNDKB, "PBNDKB", 0x7, 1, 1, b_PBNDKB) \
+    X(AVXVNNIINT8, "AVXVNNIINT8", 0x7, 1, 3, b_AVXVNNIINT8) \
+    X(AVXNECONVERT, "AVXNECONVERT", 0x7, 1, 3, b_AVXNECONVERT) \
+    X(AMXCOMPLEX, "AMXCOMPLEX", 0x7, 1, 3, b_AMXCOMPLEX) \
+    X(AVXVNNIINT16, "AVXVNNIINT16", 0x7, 1, 3, b_AVXVNNIINT16) \
+    X(PREFETCHI, "PREFETCHI", 0x7, 1, 3, b_PREFETCHI) \
+    X(USERMSR, "USERMSR", 0x7, 1, 3, b_USERMSR) \
+    X(AVX10, "AVX10", 0x7, 1, 3, b_AVX10) \
+    X(APXF, "APXF", 0x7, 1, 3, b_APXF) \
+    X(XSAVEOPT, "XSAVEOPT", 0xd, 1, 0, b_XSAVEOPT) \
+    X(XSAVEC, "XSAVEC", 0xd, 1, 0, b_XSAVEC) \
+    X(XSAVES, "XSAVES", 0xd, 1, 0, b_XSAVES) \
+    X(XSAVEXFD, "XSAVEXFD", 0xd, 1, 0, b_XSAVEXFD) \
+    X(PTWRITE, "PTWRITE", 0x14, 0, 1, b_PTWRITE) \
+    X(AESKLE, "AESKLE", 0x19, 0, 0, b_AESKLE) \
+    X(WIDEKL, "WIDEKL", 0x19, 0, 0, b_WIDEKL) \
+    X(AMXFP8, "AMXFP8", 0x1e, 1, 0, b_AMXFP8) \
+    X(AMX_TRANSPOSE, "AMX_TRANSPOSE", 0x1e, 1, 0, b_AMX_TRANSPOSE) \
+    X(AMX_TF32, "AMX_TF32", 0x1e, 1, 0, b_AMX_TF32) \
+    X(AMX_AVX512, "AMX_AVX512", 0x1e, 1, 0, b_AMX_AVX512) \
+    X(AMX_MOVRS, "AMX_MOVRS", 0x1e, 1, 0, b_AMX_MOVRS) \
+    X(AVX10_256, "AVX10_256", 0x24, 0, 1, b_AVX10_256) \
+    X(AVX10_512, "AVX10_512", 0x24, 0, 1, b_AVX10_512) \
+    X(LAHF_LM, "LAHF_LM", 0x80000001, 0, 2, b_LAHF_LM) \
+    X(ABM, "ABM", 0x80000001, 0, 2, b_ABM) \
+    X(SSE4a, "SSE4a", 0x80000001, 0, 2, b_SSE4a) \
+    X(PRFCHW, "PRFCHW", 0x80000001, 0, 2, b_PRFCHW) \
+    X(XOP, "XOP", 0x80000001, 0, 2, b_XOP) \
+    X(LWP, "LWP", 0x80000001, 0, 2, b_LWP) \
+    X(FMA4, "FMA4", 0x80000001, 0, 2, b_FMA4) \
+    X(TBM, "TBM", 0x80000001, 0, 2, b_TBM) \
+    X(MWAITX, "MWAITX", 0x80000001, 0, 2, b_MWAITX) \
+    X(MMXEXT, "MMXEXT", 0x80000001, 0, 3, b_MMXEXT) \
+    X(LM, "LM", 0x80000001, 0, 3, b_LM) \
+    X(x3DNOWP, "3DNOWP", 0x80000001, 0, 3, b_3DNOWP) \
+    X(x3DNOW, "3DNOW", 0x80000001, 0, 3, b_3DNOW) \
+    X(CLZERO, "CLZERO", 0x80000008, 0, 1, b_CLZERO) \
+    X(RDPRU, "RDPRU", 0x80000008, 0, 1, b_RDPRU) \
+    X(WBNOINVD, "WBNOINVD", 0x80000008, 0, 1, b_WBNOINVD) \
+    X(RDTSCP, "RDTSCP", 0x80000001, 0, 3, b_RDTSCP) \
+    X(UAI, "UAI", 0x80000021, 0, 0, b_UAI) \
+    X(LAM, "LAM", 0x7, 1, 0, b_LAM)
+
+#define CPUIDX_X_COUNT(field, name, leaf, sub_leaf, reg, mask) +1
+
+enum { CPUIDX_FEATURE_COUNT = 0 CPUIDX_FEATURES(CPUIDX_X_COUNT) };
+
+#define CPUIDX_X_ENUM(field, name, leaf, sub_leaf, reg, mask) CPUIDX_FEATURE_##field,
+
+/**
+* @brief Feature identifiers, in \p cpu_features declaration order, e.g. \p CPUIDX_FEATURE_AVX2.
+*/
+enum cpuidx_feature { CPUIDX_FEATURES(CPUIDX_X_ENUM) };
+
+#undef CPUIDX_X_ENUM
+
+/**
+* @brief Groups of features for \p get_cpu_features_selective, each read from the CPUID leaves it needs.
+*/
+enum cpuidx_feature_group {
+    CPUIDX_GROUP_BASIC = 0x01, /**< Family, model and stepping, and the standard feature flags (leaf 1) */
+    CPUIDX_GROUP_BRAND = 0x02, /**< The brand string (leaves 0x80000002 to 0x80000004) */
+    CPUIDX_GROUP_SIMD = 0x04, /**< Vector and bit manipulation, x86-64 levels (leaves 1, 7, 0x1E, 0x24, 0x80000001) */
+    CPUIDX_GROUP_SECURITY = 0x08, /**< Security and mitigation features (leaves 1, 7, 0x19) */
+    CPUIDX_GROUP_TOPOLOGY = 0x10, /**< HTT, x2APIC and hybrid topology flags (leaves 1, 7) */
+    CPUIDX_GROUP_SYSTEM = 0x20, /**< XSAVE, trace and system (1, 7, 0xD, 0x14, 0x80000001, 0x80000008, 0x80000021) */
+    CPUIDX_GROUP_ALL = 0x3f /**< All the leaves, as \p get_cpu_features */
+};
+
+/**
+* @brief x86-64 psABI micro-architecture levels and the host, usable as compiler target profiles.
+*/
+enum cpuidx_profile {
+    CPUIDX_PROFILE_HOST = 0, /**< The features of the running CPU */
+    CPUIDX_PROFILE_X86_64_V1 = 1, /**< x86-64 baseline: CMOV, CX8, FPU, FXSR, MMX, SSE, SSE2 */
+    CPUIDX_PROFILE_X86_64_V2 = 2, /**< v1 + CMPXCHG16B, LAHF-SAHF, POPCNT, SSE3, SSE4.1, SSE4.2, SSSE3 */
+    CPUIDX_PROFILE_X86_64_V3 = 3, /**< v2 + AVX, AVX2, BMI1, BMI2, F16C, FMA, LZCNT, MOVBE, OSXSAVE */
+    CPUIDX_PROFILE_X86_64_V4 = 4 /**< v3 + AVX512F, AVX512BW, AVX512CD, AVX512DQ, AVX512VL */
+};
+
+/**
+* @brief The number of XSAVE state components described by CPUID leaf 0xD.
+*/
+enum { CPUIDX_XSAVE_COMPONENTS = 32 };
+
+/**
+* @brief Structure to hold the layout of an XSAVE state component (CPUID leaf 0xD, sub-leaf 2 and above).
+*/
+struct cpuidx_xsave_component {
+    uint32_t size; /**< Size in bytes, 0 if the component is not supported */
+    uint32_t offset; /**< Offset in the standard (non-compacted) format, 0 for supervisor components */
+    bool supervisor; /**< Managed through IA32_XSS, saved only by XSAVES */
+    bool aligned; /**< Aligned to 64 bytes in the compacted format */
+    bool xfd; /**< Supports Extended Feature Disable (XFD) faulting */
+};
+
+/**
+* @brief Structure to hold the XSAVE state information (CPUID leaf 0xD and XCR0).
+*/
+struct cpuidx_xsave_info {
+    uint64_t supported_xcr0; /**< User components the CPU supports in XCR0 */
+    uint64_t supported_xss; /**< Supervisor components the CPU supports in IA32_XSS */
+    uint64_t enabled_xcr0; /**< User components the OS enabled in XCR0 */
+    uint64_t xfd_components; /**< Components supporting XFD faulting, e.g. AMX tile data */
+    uint32_t enabled_size; /**< Standard format size for the components enabled in XCR0 */
+    uint32_t max_size; /**< Standard format size for all supported user components */
+    uint32_t compacted_size; /**< Compacted format size for the components enabled in XCR0 and IA32_XSS */
+    struct cpuidx_xsave_component components[CPUIDX_XSAVE_COMPONENTS]; /**< Per-component layout */
+};
+
+/**
+* @brief Structure to hold the AMX tile palette and TMUL information (CPUID leaves 0x1D and 0x1E).
+*/
+struct cpuidx_amx_info {
+    uint32_t max_palette; /**< Highest supported palette */
+    uint32_t total_tile_bytes; /**< Size of the tile storage of palette 1, in bytes */
+    uint32_t bytes_per_tile; /**< Size of a tile of palette 1, in bytes */
+    uint32_t bytes_per_row; /**< Maximum bytes per row of a tile of palette 1 */
+    uint32_t max_names; /**< Number of tile registers of palette 1 */
+    uint32_t max_rows; /**< Maximum rows of a tile of palette 1 */
+    uint32_t tmul_max_k; /**< Maximum rows or columns of the TMUL unit (K dimension) */
+    uint32_t tmul_max_n; /**< Maximum column bytes of the TMUL unit (N dimension) */
+};
+
+/**
+* @brief Vector widths, indexing the measurements of the probes.
+*/
+enum cpuidx_vector_width {
+    CPUIDX_WIDTH_128 = 0, /**< XMM registers */
+    CPUIDX_WIDTH_256 = 1, /**< YMM registers */
+    CPUIDX_WIDTH_512 = 2, /**< ZMM registers */
+    CPUIDX_WIDTH_COUNT = 3
+};
+
+/**
+* @brief Structure to hold the measured vector throughput, and the execution units it implies.
+*/
+struct cpuidx_port_probe {
+    double fma[CPUIDX_WIDTH_COUNT]; /**< Independent FMA instructions per cycle, 0 if not measured */
+    double shuffle[CPUIDX_WIDTH_COUNT]; /**< Independent shuffle instructions per cycle, 0 if not measured */
+    double load[CPUIDX_WIDTH_COUNT]; /**< L1-resident loads per cycle, 0 if not measured */
+    uint32_t fma_units; /**< Number of FMA units at 256 bits, 0 without FMA */
+    uint32_t fma512_units; /**< Number of FMA units at 512 bits, 0 without AVX-512 */
+    bool double_pumped_512; /**< 512-bit operations are split into two 256-bit halves, e.g. on Zen 4 */
+};
+
+/**
+* @brief Structure to hold the effective core frequency running code of each vector width.
+*/
+struct cpuidx_frequency_license {
+    double scalar_hz; /**< Effective frequency running scalar code, in Hz */
+    double vector_hz[CPUIDX_WIDTH_COUNT]; /**< Effective frequency running FMA code, 0 if not measured */
+    double drop[CPUIDX_WIDTH_COUNT]; /**< Frequency drop relative to scalar code, e.g. 0.15 for 15% */
+    double recovery_us[CPUIDX_WIDTH_COUNT]; /**< Time for the frequency to recover after FMA code, in microseconds */
+    bool aperf_mperf; /**< The frequencies come from the APERF and MPERF registers rather than throughput */
+    bool unreliable; /**< A vector frequency came out above the scalar one, so a measurement was disturbed */
+};
+
+/**
+* @brief Instructions whose speed varies across CPUs with the same features, measured by \p cpuidx_measure_isa.
+*/
+enum cpuidx_isa_benchmark {
+    CPUIDX_ISA_PDEP = 0, /**< PDEP (BMI2) */
+    CPUIDX_ISA_PEXT = 1, /**< PEXT (BMI2) */
+    CPUIDX_ISA_VPGATHERDD = 2, /**< 256-bit VPGATHERDD (AVX2) */
+    CPUIDX_ISA_VPERMB = 3, /**< 512-bit VPERMB (AVX512VBMI) */
+    CPUIDX_ISA_VPCOMPRESSD = 4, /**< 512-bit VPCOMPRESSD to memory (AVX512F) */
+    CPUIDX_ISA_REP_MOVSB = 5, /**< REP MOVSB copying 32 bytes (FSRM) */
+    CPUIDX_ISA_CLFLUSHOPT = 6, /**< A store then CLFLUSHOPT of the line */
+    CPUIDX_ISA_CLWB = 7, /**< A store then CLWB of the line */
+    CPUIDX_ISA_PAUSE = 8, /**< PAUSE */
+    CPUIDX_ISA_BENCHMARK_COUNT = 9
+};
+
+/**
+* @brief Structure to hold the measured speed of instructions, in core cycles.
+*/
+struct cpuidx_isa_timings {
+    uint32_t signature; /**< Family, model and stepping of the measured CPU (CPUID leaf 1 EAX) */
+    char brand[49]; /**< Brand name of the measured CPU */
+    uint32_t microcode; /**< Microcode revision of the measured CPU, 0 if unknown */
+    double latency[CPUIDX_ISA_BENCHMARK_COUNT]; /**< Cycles from input to output, 0 if not measured */
+    double throughput[CPUIDX_ISA_BENCHMARK_COUNT]; /**< Cycles per independent instruction, 0 if not measured */
+    bool slow_pdep_pext; /**< PDEP and PEXT are microcoded (latency over 8 cycles), e.g. before Zen 3 */
+    bool slow_gather; /**< VPGATHERDD takes over 2 cycles per element, e.g. with the GDS mitigation */
+    bool slow_compress_store; /**< VPCOMPRESSD to memory is microcoded (over 16 cycles), e.g. on Zen 4 */
+    bool slow_short_rep_movsb; /**< REP MOVSB takes over 24 cycles for 32 bytes, use a loop for short copies */
+};
+
+/**
+* @brief Whether TSX transactions are usable, or why not, as decided by \p cpuidx_get_tsx_state.
+*/
+enum cpuidx_tsx_state {
+    CPUIDX_TSX_USABLE = 0, /**< Transactions commit */
+    CPUIDX_TSX_UNSUPPORTED = 1, /**< The CPU does not enumerate RTM */
+    CPUIDX_TSX_ALWAYS_ABORT = 2, /**< The microcode aborts every transaction (RTM_ALWAYS_ABORT) */
+    CPUIDX_TSX_DISABLED = 3, /**< The kernel disabled TSX, with tsx=off or as the TAA mitigation */
+    CPUIDX_TSX_ABORTING = 4 /**< No probe transaction committed, e.g. with TSX_FORCE_ABORT set */
+};
+
+/**
+* @brief A spin lock elided with RTM transactions when TSX is usable. Zero-initialize it.
+*/
+struct cpuidx_elided_lock {
+    volatile long locked; /**< Non-zero while the lock is taken for real */
+};
+
+/**
+* @brief Structure to count the outcomes of lock elision, per thread.
+*/
+struct cpuidx_elision_stats {
+    uint64_t attempts; /**< Transactions started */
+    uint64_t commits; /**< Critical sections run in a committed transaction */
+    uint64_t aborts; /**< Aborted transactions */
+    uint64_t conflict_aborts; /**< Aborts on a data conflict with another thread */
+    uint64_t capacity_aborts; /**< Aborts on overflowing the transactional buffers */
+    uint64_t fallbacks; /**< Critical sections run with the lock taken for real */
+};
+
+/**
+* @brief A pool of slots aligned and padded to the destructive interference size, against false sharing.
+*/
+struct cpuidx_padded_pool {
+    void* memory; /**< The slots, zero-initialized */
+    size_t stride; /**< Distance between slots in bytes, a multiple of the destructive interference size */
+    size_t count; /**< Number of slots */
+};
+
+enum { CPUIDX_CACHE_LEVELS = 3 };
+
+/**
+* @brief Structure to hold the geometry of a cache.
+*/
+struct cpuidx_cache_level {
+    uint32_t size; /**< Size in bytes, 0 if the cache is not enumerated */
+    uint32_t line_size; /**< Line size in bytes */
+    uint32_t ways; /**< Associativity */
+    uint32_t sets; /**< Number of sets */
+    uint32_t shared_by; /**< Maximum logical processors sharing the cache, 0 if not enumerated */
+};
+
+/**
+* @brief Structure to hold the data and unified caches, as decoded by \p cpuidx_get_cache_info.
+*/
+struct cpuidx_cache_info {
+    struct cpuidx_cache_level levels[CPUIDX_CACHE_LEVELS]; /**< L1 data, L2 and L3 caches */
+};
+
+/**
+* @brief Element types of \p cpuidx_recommend_gemm_blocking.
+*/
+enum cpuidx_gemm_type {
+    CPUIDX_GEMM_F32 = 0, /**< Single precision */
+    CPUIDX_GEMM_F64 = 1, /**< Double precision */
+    CPUIDX_GEMM_BF16 = 2 /**< BF16 inputs, single precision results */
+};
+
+/**
+* @brief Structure to hold the register tile and cache blocks of a Goto-style GEMM.
+*/
+struct cpuidx_gemm_blocking {
+    uint32_t mr; /**< Rows of the register tile */
+    uint32_t nr; /**< Columns of the register tile */
+    uint32_t kc; /**< Depth of the blocks, sized for a micro-panel of B to stay in L1 */
+    uint32_t mc; /**< Rows of a block of A, sized to stay in L2 */
+    uint32_t nc; /**< Columns of a panel of B, sized to stay in L3 */
+    enum cpuidx_vector_width width; /**< The vector width of the micro-kernel */
+    bool fma; /**< The micro-kernel can use FMA */
+    bool amx; /**< The register tile is made of AMX tiles */
+    bool bf16_dot; /**< BF16 pairs are multiplied by VDPBF16PS (AVX512BF16), rather than widened to FP32 when packed */
+};
+
+/**
+* @brief Structure to hold the topology of a logical CPU, from its x2APIC ID.
+*/
+struct cpuidx_cpu_topology {
+    uint32_t cpu; /**< The logical CPU, as numbered by the OS */
+    uint32_t x2apic_id; /**< x2APIC ID (CPUID leaf 0x1F or 0xB), or initial APIC ID */
+    uint32_t package; /**< Package ID */
+    uint32_t core; /**< Core ID within the package */
+    uint32_t thread; /**< SMT thread ID within the core */
+    uint32_t core_type; /**< Core type on hybrid CPUs (CPUID leaf 0x1A): 0x20 Atom, 0x40 Core, 0 otherwise */
+    uint32_t node; /**< Node ID on AMD (CPUID leaf 0x8000001E), 0 otherwise */
+    uint32_t ccx; /**< Core complex: the CPUs sharing an L3 (the AMD CCX), unique across packages */
+    uint32_t ccd; /**< Core complex die on AMD (CPUID leaf 0x80000026), or the core complex */
+};
+
+/**
+* @brief Structure to hold the package topology of AMD CPUs.
+*/
+struct cpuidx_amd_topology {
+    uint32_t threads_per_package; /**< Logical CPUs per package (CPUID leaf 0x80000008 ECX bits 7:0, plus 1) */
+    uint32_t apic_id_size; /**< x2APIC ID bits of the CPUs of a package (0x80000008 ECX bits 15:12) */
+    uint32_t threads_per_core; /**< Logical CPUs per core or compute unit (0x8000001E EBX bits 15:8, plus 1) */
+    uint32_t nodes_per_package; /**< Nodes per package (0x8000001E ECX bits 10:8, plus 1) */
+    uint32_t threads_per_ccx; /**< Logical CPUs per core complex (0x80000026, or the sharing of the L3) */
+    uint32_t threads_per_ccd; /**< Logical CPUs per core complex die (0x80000026), or per core complex */
+};
+
+/**
+* @brief Enumeration of the core types of hybrid CPUs (CPUID leaf 0x1A EAX bits 31:24).
+*/
+enum cpuidx_core_type {
+    CPUIDX_CORE_TYPE_NONE = 0, /**< Not a hybrid CPU */
+    CPUIDX_CORE_TYPE_ATOM = 0x20, /**< Atom, the efficiency cores */
+    CPUIDX_CORE_TYPE_CORE = 0x40 /**< Core, the performance cores */
+};
+
+/**
+* @brief Structure to hold a raw CPUID query of a batch.
+*/
+struct cpuidx_cpuid_request {
+    uint32_t leaf; /**< The leaf (EAX) */
+    uint32_t sub_leaf; /**< The sub-leaf (ECX), or CPUIDX_ALL_SUB_LEAVES to enumerate the sub-leaves */
+};
+
+/**
+* @brief Structure to hold the result of a raw CPUID query of a batch.
+*/
+struct cpuidx_cpuid_result {
+    uint32_t leaf; /**< The leaf (EAX) */
+    uint32_t sub_leaf; /**< The sub-leaf (ECX) */
+    uint32_t registers[4]; /**< EAX, EBX, ECX, EDX, zero if not valid */
+    bool valid; /**< The leaf is implemented, so the query was executed */
+};
+
+/**
+* @brief Enumeration of the hardware masking of pointer tags.
+*/
+enum cpuidx_address_masking {
+    CPUIDX_MASKING_NONE = 0, /**< Pointers must be untagged before dereferencing */
+    CPUIDX_MASKING_LAM_U57 = 1, /**< Intel LAM ignores bits 62:57 of user pointers */
+    CPUIDX_MASKING_LAM_U48 = 2, /**< Intel LAM ignores bits 62:48 of user pointers */
+    CPUIDX_MASKING_OTHER = 3 /**< The OS reports another mask */
+};
+
+/**
+* @brief Structure to hold the pointer bits available for tags in the process.
+*/
+struct cpuidx_pointer_tagging {
+    uint32_t virtual_address_bits; /**< Linear address size of the CPU (CPUID leaf 0x80000008 EAX bits 15:8) */
+    uint32_t user_address_bits; /**< Significant bits of user pointers: 47, 56 with 5-level paging, 32 in 32-bit */
+    uint32_t tag_bits; /**< High bits free for software tags, cleared before dereferencing */
+    uint32_t ignored_bits; /**< High bits ignored by the CPU when dereferencing, so tags there need no clearing */
+    enum cpuidx_address_masking masking; /**< The hardware masking enabled for the process */
+    bool la57; /**< The OS has enabled 5-level paging */
+};
+
+/**
+* @brief Enumeration of the power settings that hurt latency, as flags.
+*/
+enum cpuidx_power_warning {
+    CPUIDX_POWER_SLOW_GOVERNOR = 0x1, /**< The cpufreq governor keeps the frequency low (powersave, conservative) */
+    CPUIDX_POWER_SAVING_EPP = 0x2, /**< The energy-performance preference favors power (power, balance_power) */
+    CPUIDX_POWER_TURBO_DISABLED = 0x4 /**< The CPU supports turbo, but the OS has disabled it */
+};
+
+/**
+* @brief Structure to hold the power management capabilities of the CPU, and the frequency policy of the OS.
+*/
+struct cpuidx_power_info {
+    bool turbo; /**< Intel Turbo Boost (CPUID leaf 6 EAX bit 1) */
+    bool arat; /**< The APIC timer keeps running in deep C-states (leaf 6 EAX bit 2) */
+    bool hwp; /**< Hardware-controlled performance states (leaf 6 EAX bit 7) */
+    bool hwp_notification; /**< HWP interrupts on performance changes (leaf 6 EAX bit 8) */
+    bool hwp_activity_window; /**< HWP activity window (leaf 6 EAX bit 9) */
+    bool hwp_epp; /**< HWP energy-performance preference (leaf 6 EAX bit 10) */
+    bool hwp_package; /**< HWP package-level requests (leaf 6 EAX bit 11) */
+    bool hwp_fast_request; /**< Fast writes of IA32_HWP_REQUEST (leaf 6 EAX bit 18) */
+    bool hdc; /**< Hardware duty cycling (leaf 6 EAX bit 13) */
+    bool turbo_max_3; /**< Intel Turbo Boost Max 3.0, favored cores (leaf 6 EAX bit 14) */
+    bool hfi; /**< Hardware feedback interface (leaf 6 EAX bit 19) */
+    bool thread_director; /**< Intel Thread Director (leaf 6 EAX bit 23) */
+    bool aperfmperf; /**< APERF and MPERF MSRs, for the effective frequency (leaf 6 ECX bit 0) */
+    bool epb; /**< Energy performance bias, IA32_ENERGY_PERF_BIAS (leaf 6 ECX bit 3) */
+    bool hw_pstate; /**< AMD hardware P-state control (leaf 0x80000007 EDX bit 7) */
+    bool invariant_tsc; /**< The TSC runs at a constant rate in all states (leaf 0x80000007 EDX bit 8) */
+    bool cpb; /**< AMD core performance boost (leaf 0x80000007 EDX bit 9) */
+    bool effective_frequency; /**< AMD read-only effective frequency interface (leaf 0x80000007 EDX bit 10) */
+    char governor[32]; /**< cpufreq governor of the first CPU, empty if unavailable */
+    char driver[32]; /**< cpufreq driver of the first CPU, empty if unavailable */
+    char epp[32]; /**< Energy-performance preference of the first CPU, empty if unavailable */
+    int boost; /**< 1 if the OS allows turbo, 0 if it has disabled it, -1 if unknown */
+    uint32_t warnings; /**< The cpuidx_power_warning flags of the settings hurting latency */
+    uint32_t flagged_cpus; /**< The number of CPUs with a slow governor or a power-saving EPP */
+};
+
+/**
+* @brief Enumeration of the paths taxed by speculative-execution mitigations.
+*/
+enum cpuidx_mitigation_path {
+    CPUIDX_PATH_NONE = 0, /**< No path measured, or not mitigated */
+    CPUIDX_PATH_SYSCALL = 1, /**< System calls and interrupts: PTI, retpolines, RSB stuffing, barriers */
+    CPUIDX_PATH_CONTEXT_SWITCH = 2, /**< Context switches: IBPB */
+    CPUIDX_PATH_KERNEL_EXIT = 3, /**< Returns to user space: VERW clearing the CPU buffers */
+    CPUIDX_PATH_STORE_LOAD = 4, /**< Loads following stores: SSBD */
+    CPUIDX_PATH_VM_ENTRY = 5 /**< VM entries: L1D flushes */
+};
+
+/**
+* @brief Structure to hold a vulnerability reported by the kernel, and the cost of its mitigation.
+*/
+struct cpuidx_vulnerability {
+    char name[32]; /**< The name of the vulnerability, e.g. "mds" */
+    char status[160]; /**< The status reported by the kernel */
+    bool affected; /**< The CPU is affected */
+    bool mitigated; /**< The kernel mitigates it */
+    enum cpuidx_mitigation_path path; /**< The path the mitigation taxes */
+    double tax_ns; /**< The cost of the mitigation per crossing of the path in nanoseconds, -1 if not isolated */
+};
+
+enum { CPUIDX_MAX_VULNERABILITIES = 32 };
+
+/**
+* @brief Structure to hold the speculative-execution mitigations of the kernel, and the cost of the paths they tax.
+*/
+struct cpuidx_mitigation_report {
+    struct cpuidx_vulnerability vulnerabilities[CPUIDX_MAX_VULNERABILITIES]; /**< The vulnerabilities, by name */
+    size_t vulnerability_count; /**< The number of vulnerabilities */
+    uint64_t arch_capabilities; /**< IA32_ARCH_CAPABILITIES, if read */
+    bool arch_capabilities_read; /**< IA32_ARCH_CAPABILITIES was readable */
+    double syscall_ns; /**< A system call round trip, -1 if not measured */
+    double context_switch_ns; /**< A context switch between processes on one CPU, -1 if not measured */
+    double verw_ns; /**< VERW, clearing the CPU buffers with MD_CLEAR, -1 if not measured */
+    double ibpb_ns; /**< The IBPB added to a context switch by disabling indirect branch speculation, -1 if unknown */
+    double ssbd_ns; /**< The cost added to a store and dependent load by SSBD, -1 if unknown */
+};
+
+/**
+* @brief Enumeration of the verdicts of the self-test on a detected feature.
+*/
+enum cpuidx_verdict {
+    CPUIDX_VERDICT_UNTESTED = 0, /**< No snippet ran: the OS did not grant the state of the feature */
+    CPUIDX_VERDICT_USABLE = 1, /**< The instruction ran natively */
+    CPUIDX_VERDICT_FAULTED = 2, /**< The instruction raised a signal, e.g. SIGILL */
+    CPUIDX_VERDICT_SLOW = 3 /**< The instruction ran slower than a native one: trapped or emulated */
+};
+
+/**
+* @brief Structure to hold the verdict of the self-test on a detected feature.
+*/
+struct cpuidx_feature_check {
+    enum cpuidx_feature feature; /**< The feature */
+    enum cpuidx_verdict verdict; /**< The verdict */
+    int signal; /**< The signal the instruction raised, 0 if none */
+    double ns; /**< The time per instruction in nanoseconds, -1 if not timed */
+    double slow_ns; /**< The time per instruction above which the instruction is deemed trapped or emulated */
+};
+
+enum { CPUIDX_MAX_FEATURE_CHECKS = 64 };
+
+/**
+* @brief Structure to hold the self-test of the detected features, and those that execute natively.
+*/
+struct cpuidx_self_test_report {
+    struct cpu_features usable; /**< The detected features, without those that faulted or were slow */
+    struct cpuidx_feature_check checks[CPUIDX_MAX_FEATURE_CHECKS]; /**< The checks of the detected features */
+    size_t check_count; /**< The number of checks */
+    size_t faulted; /**< The number of features that faulted */
+    size_t slow; /**< The number of features that were slow */
+};
+
+// Sub-leaf of a batched CPUID request, to query every sub-leaf of the leaf
+#define CPUIDX_ALL_SUB_LEAVES UINT32_MAX
+
+// The snapshot published by cpuidzd, unless overridden by the CPUIDX_SNAPSHOT environment variable
+#define CPUIDX_SNAPSHOT_PATH "/run/cpuidx/snapshot"
+
 #ifdef CPUIDX_LANG_CPP
 #if __GNUC__ || __clang__ || _MSC_VER
 // Support for '__restrict' in C++ is known on GCC, Clang, and MSVC
@@ -726,6 +1372,28 @@ enum {
 
 typedef struct cpu_basic_info cpu_basic_info;
 typedef struct cpu_features cpu_features;
+typedef struct cpuidx_xsave_component cpuidx_xsave_component;
+typedef struct cpuidx_xsave_info cpuidx_xsave_info;
+typedef struct cpuidx_amx_info cpuidx_amx_info;
+typedef struct cpuidx_port_probe cpuidx_port_probe;
+typedef struct cpuidx_frequency_license cpuidx_frequency_license;
+typedef struct cpuidx_isa_timings cpuidx_isa_timings;
+typedef struct cpuidx_elided_lock cpuidx_elided_lock;
+typedef struct cpuidx_elision_stats cpuidx_elision_stats;
+typedef struct cpuidx_padded_pool cpuidx_padded_pool;
+typedef struct cpuidx_cache_level cpuidx_cache_level;
+typedef struct cpuidx_cache_info cpuidx_cache_info;
+typedef struct cpuidx_gemm_blocking cpuidx_gemm_blocking;
+typedef struct cpuidx_cpu_topology cpuidx_cpu_topology;
+typedef struct cpuidx_amd_topology cpuidx_amd_topology;
+typedef struct cpuidx_cpuid_request cpuidx_cpuid_request;
+typedef struct cpuidx_cpuid_result cpuidx_cpuid_result;
+typedef struct cpuidx_pointer_tagging cpuidx_pointer_tagging;
+typedef struct cpuidx_power_info cpuidx_power_info;
+typedef struct cpuidx_vulnerability cpuidx_vulnerability;
+typedef struct cpuidx_mitigation_report cpuidx_mitigation_report;
+typedef struct cpuidx_feature_check cpuidx_feature_check;
+typedef struct cpuidx_self_test_report cpuidx_self_test_report;
 
 extern int check_cpuid();
 
@@ -733,8 +1401,134 @@ void cpuid(uint32_t leaf, uint32_t registers[4]);
 
 void cpuid_extended(uint32_t leaf, uint32_t sub_leaf, uint32_t registers[4]);
 
+uint64_t xgetbv(uint32_t xcr);
+
 int get_cpu_features(cpu_features* CPUIDX_RESTRICT features, cpu_basic_info* CPUIDX_RESTRICT basic_info);
 
+int get_cpu_features_selective(uint32_t groups, cpu_features* CPUIDX_RESTRICT features,
+                               cpu_basic_info* CPUIDX_RESTRICT basic_info);
+
+uint32_t cpuidx_feature_groups(size_t index);
+
+const cpu_features* cpuidx_cached_features(void);
+
+const cpu_basic_info* cpuidx_cached_basic_info(void);
+
+const char* cpuidx_feature_name(size_t index);
+
+int cpuidx_feature_index(const char* name);
+
+const char* cpuidx_feature_macro(size_t index);
+
+int get_x86_64_level(const cpu_features* features);
+
+int cpuidx_profile_features(enum cpuidx_profile profile, cpu_features* features);
+
+int cpuidx_parse_profile(const char* spec, cpu_features* features);
+
+const char* cpuidx_tune_name(const cpu_basic_info* basic_info, const cpu_features* features);
+
+size_t cpuidx_compiler_flags(const cpu_features* CPUIDX_RESTRICT features,
+                             const cpu_basic_info* CPUIDX_RESTRICT basic_info, char* CPUIDX_RESTRICT buffer,
+                             size_t size);
+
+size_t cpuidx_target_clones(const cpu_features* CPUIDX_RESTRICT features, char* CPUIDX_RESTRICT buffer,
+                            size_t size);
+
+int cpuidx_select_variant(const cpu_features* host, const cpu_features* candidates, size_t count);
+
+int cpuidx_get_xsave_info(cpuidx_xsave_info* info);
+
+const char* cpuidx_xsave_component_name(unsigned component);
+
+size_t cpuidx_xsave_area_size(const cpuidx_xsave_info* info, uint64_t components, size_t* alignment);
+
+void cpuidx_xsave(void* area, uint64_t components);
+
+void cpuidx_xrstor(const void* area, uint64_t components);
+
+int cpuidx_get_amx_info(cpuidx_amx_info* info);
+
+int cpuidx_amx_enable(void);
+
+int cpuidx_probe_ports(cpuidx_port_probe* probe);
+
+int cpuidx_measure_frequency_license(int cpu, cpuidx_frequency_license* license);
+
+int cpuidx_measure_isa(cpuidx_isa_timings* timings);
+
+const char* cpuidx_isa_benchmark_name(unsigned benchmark);
+
+size_t cpuidx_format_isa_timings(const cpuidx_isa_timings* CPUIDX_RESTRICT timings, char* CPUIDX_RESTRICT buffer,
+                                 size_t size);
+
+int cpuidx_parse_isa_timings(const char* CPUIDX_RESTRICT text, cpuidx_isa_timings* CPUIDX_RESTRICT timings);
+
+int cpuidx_load_isa_timings(const char* CPUIDX_RESTRICT path, cpuidx_isa_timings* CPUIDX_RESTRICT timings);
+
+double cpuidx_pause_ns(void);
+
+void cpuidx_spin_wait(uint64_t ns);
+
+int cpuidx_wait_on_address(const volatile void* address, const void* compare, size_t size, uint64_t timeout_ns);
+
+enum cpuidx_tsx_state cpuidx_get_tsx_state(void);
+
+void cpuidx_elided_lock_acquire(cpuidx_elided_lock* CPUIDX_RESTRICT lock,
+                                cpuidx_elision_stats* CPUIDX_RESTRICT stats);
+
+void cpuidx_elided_lock_release(cpuidx_elided_lock* CPUIDX_RESTRICT lock,
+                                cpuidx_elision_stats* CPUIDX_RESTRICT stats);
+
+size_t cpuidx_cache_line_size(void);
+
+size_t cpuidx_destructive_interference_size(void);
+
+int cpuidx_padded_pool_create(cpuidx_padded_pool* pool, size_t object_size, size_t count);
+
+void* cpuidx_padded_pool_slot(const cpuidx_padded_pool* pool, size_t index);
+
+void cpuidx_padded_pool_destroy(cpuidx_padded_pool* pool);
+
+int cpuidx_get_cache_info(cpuidx_cache_info* info);
+
+int cpuidx_recommend_gemm_blocking(enum cpuidx_gemm_type type, const cpu_features* CPUIDX_RESTRICT features,
+                                   const cpuidx_cache_info* CPUIDX_RESTRICT caches,
+                                   cpuidx_gemm_blocking* CPUIDX_RESTRICT blocking);
+
+int cpuidx_sgemm(const cpuidx_gemm_blocking* CPUIDX_RESTRICT blocking, size_t m, size_t n, size_t k, float alpha,
+                 const float* CPUIDX_RESTRICT a, size_t lda, const float* CPUIDX_RESTRICT b, size_t ldb, float beta,
+                 float* CPUIDX_RESTRICT c, size_t ldc);
+
+size_t cpuidx_get_topology(cpuidx_cpu_topology* cpus, size_t count);
+
+int cpuidx_publish_snapshot(const char* path);
+
+size_t cpuidx_cpuid_batch(const cpuidx_cpuid_request* CPUIDX_RESTRICT requests, size_t request_count,
+                          cpuidx_cpuid_result* CPUIDX_RESTRICT results, size_t capacity);
+
+int cpuidx_current_cpu(void);
+
+enum cpuidx_core_type cpuidx_current_core_type(void);
+
+int cpuidx_get_pointer_tagging(cpuidx_pointer_tagging* tagging);
+
+int cpuidx_get_amd_topology(cpuidx_amd_topology* topology);
+
+int cpuidx_get_power_info(cpuidx_power_info* info);
+
+int cpuidx_get_mitigation_report(cpuidx_mitigation_report* report);
+
+int cpuidx_run_self_test(cpuidx_self_test_report* report);
+
+const cpu_features* cpuidx_verified_features(void);
+
+uint64_t cpuidx_tag_pointer(const cpuidx_pointer_tagging* tagging, const void* pointer, uint64_t tag);
+
+void* cpuidx_tagged_pointer(const cpuidx_pointer_tagging* tagging, uint64_t tagged);
+
+uint64_t cpuidx_tagged_tag(const cpuidx_pointer_tagging* tagging, uint64_t tagged);
+
 #ifdef CPUIDX_LANG_CPP
 }
 #endif
@@ -0,0 +1,370 @@
+#pragma once
+#ifndef CPUIDX_HPP
+#define CPUIDX_HPP
+
+#include "cpuidx.h"
+#include "cpuidx_ifunc.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <initializer_list>
+#include <iterator>
+#include <string_view>
+#include <utility>
+
+namespace cpuidx {
+/// The CPU features detected by the library, in \p cpu_features declaration order.
+enum class feature : std::uint16_t {
+#define CPUIDX_X_ENUM(field, name, leaf, sub_leaf, reg, mask) field,
+    CPUIDX_FEATURES(CPUIDX_X_ENUM)
+#undef CPUIDX_X_ENUM
+};
+
+/// The number of features.
+inline constexpr std::size_t feature_count = CPUIDX_FEATURE_COUNT;
+
+namespace detail {
+inline constexpr std::array<std::string_view, feature_count> feature_names = {
+#define CPUIDX_X_NAME(field, name, leaf, sub_leaf, reg, mask) name,
+    CPUIDX_FEATURES(CPUIDX_X_NAME)
+#undef CPUIDX_X_NAME
+};
+} // namespace detail
+
+/// Gets the name of a feature.
+///
+/// \param f The feature.
+/// \return The name of the feature, e.g. "AVX2".
+constexpr std::string_view name(const feature f) noexcept {
+    return detail::feature_names[static_cast<std::size_t>(f)];
+}
+
+/// A set of CPU features.
+///
+/// The set is a fixed-size bitset, usable in constant expressions,
+/// and a forward range over the features it holds, in declaration order.
+class feature_set {
+    static constexpr std::size_t word_bits = 64;
+    std::array<std::uint64_t, (feature_count + word_bits - 1) / word_bits> words_{};
+
+    static constexpr std::size_t index(const feature f) noexcept { return static_cast<std::size_t>(f); }
+
+public:
+    /// Forward iterator over the features of a set.
+    class iterator {
+        const feature_set* set_ = nullptr;
+        std::size_t pos_ = feature_count;
+
+        constexpr void seek(std::size_t pos) noexcept {
+            while (pos < feature_count) {
+                const std::uint64_t word = set_->words_[pos / word_bits] >> (pos % word_bits);
+                if (word) {
+                    pos_ = pos + static_cast<std::size_t>(std::countr_zero(word));
+                    return;
+                }
+                pos = (pos / word_bits + 1) * word_bits;
+            }
+            pos_ = feature_count;
+        }
+
+    public:
+        using value_type = feature;
+        using difference_type = std::ptrdiff_t;
+
+        constexpr iterator() noexcept = default;
+
+        constexpr iterator(const feature_set* set, const std::size_t pos) noexcept : set_{set} { seek(pos); }
+
+        constexpr feature operator*() const noexcept { return static_cast<feature>(pos_); }
+
+        constexpr iterator& operator++() noexcept {
+            seek(pos_ + 1);
+            return *this;
+        }
+
+        constexpr iterator operator++(int) noexcept {
+            const iterator it = *this;
+            ++*this;
+            return it;
+        }
+
+        constexpr bool operator==(const iterator& other) const noexcept { return pos_ == other.pos_; }
+    };
+
+    constexpr feature_set() noexcept = default;
+
+    /// Creates a set holding the given features.
+    constexpr feature_set(const std::initializer_list<feature> features) noexcept {
+        for (const feature f : features) set(f);
+    }
+
+    /// Creates a set from the C \p cpu_features structure.
+    constexpr explicit feature_set(const cpu_features& features) noexcept {
+#define CPUIDX_X_SET(field, name, leaf, sub_leaf, reg, mask) set(feature::field, features.field);
+        CPUIDX_FEATURES(CPUIDX_X_SET)
+#undef CPUIDX_X_SET
+    }
+
+    /// Checks whether the set holds a feature.
+    [[nodiscard]] constexpr bool has(const feature f) const noexcept {
+        return words_[index(f) / word_bits] >> (index(f) % word_bits) & 1;
+    }
+
+    /// Checks whether the set holds all features of another set.
+    [[nodiscard]] constexpr bool all_of(const feature_set& other) const noexcept {
+        for (std::size_t i = 0; i < words_.size(); ++i) {
+            if ((words_[i] & other.words_[i]) != other.words_[i]) return false;
+        }
+        return true;
+    }
+
+    /// Checks whether the set holds all the given features.
+    template <std::same_as<feature>... Features>
+    [[nodiscard]] constexpr bool all_of(const Features... features) const noexcept {
+        return (has(features) && ...);
+    }
+
+    /// Checks whether the set holds any feature of another set.
+    [[nodiscard]] constexpr bool any_of(const feature_set& other) const noexcept {
+        for (std::size_t i = 0; i < words_.size(); ++i) {
+            if (words_[i] & other.words_[i]) return true;
+        }
+        return false;
+    }
+
+    /// Checks whether the set holds any of the given features.
+    template <std::same_as<feature>... Features>
+    [[nodiscard]] constexpr bool any_of(const Features... features) const noexcept {
+        return (has(features) || ...);
+    }
+
+    /// Checks whether the set holds none of the features of another set.
+    [[nodiscard]] constexpr bool none_of(const feature_set& other) const noexcept { return !any_of(other); }
+
+    /// Adds or removes a feature.
+    constexpr feature_set& set(const feature f, const bool value = true) noexcept {
+        const std::uint64_t bit = std::uint64_t{1} << (index(f) % word_bits);
+        if (value) words_[index(f) / word_bits] |= bit;
+        else words_[index(f) / word_bits] &= ~bit;
+        return *this;
+    }
+
+    /// Removes a feature.
+    constexpr feature_set& reset(const feature f) noexcept { return set(f, false); }
+
+    /// The number of features in the set.
+    [[nodiscard]] constexpr std::size_t size() const noexcept {
+        std::size_t count = 0;
+        for (const std::uint64_t word : words_) count += static_cast<std::size_t>(std::popcount(word));
+        return count;
+    }
+
+    /// Checks whether the set is empty.
+    [[nodiscard]] constexpr bool empty() const noexcept {
+        return std::ranges::all_of(words_, [](const std::uint64_t word) { return word == 0; });
+    }
+
+    [[nodiscard]] constexpr iterator begin() const noexcept { return {this, 0}; }
+
+    [[nodiscard]] constexpr iterator end() const noexcept { return {}; }
+
+    constexpr feature_set& operator|=(const feature_set& other) noexcept {
+        for (std::size_t i = 0; i < words_.size(); ++i) words_[i] |= other.words_[i];
+        return *this;
+    }
+
+    constexpr feature_set& operator&=(const feature_set& other) noexcept {
+        for (std::size_t i = 0; i < words_.size(); ++i) words_[i] &= other.words_[i];
+        return *this;
+    }
+
+    /// Removes the features of another set.
+    constexpr feature_set& operator-=(const feature_set& other) noexcept {
+        for (std::size_t i = 0; i < words_.size(); ++i) words_[i] &= ~other.words_[i];
+        return *this;
+    }
+
+    [[nodiscard]] friend constexpr feature_set operator|(feature_set lhs, const feature_set& rhs) noexcept {
+        return lhs |= rhs;
+    }
+
+    [[nodiscard]] friend constexpr feature_set operator&(feature_set lhs, const feature_set& rhs) noexcept {
+        return lhs &= rhs;
+    }
+
+    [[nodiscard]] friend constexpr feature_set operator-(feature_set lhs, const feature_set& rhs) noexcept {
+        return lhs -= rhs;
+    }
+
+    [[nodiscard]] friend constexpr bool operator==(const feature_set&, const feature_set&) noexcept = default;
+};
+
+static_assert(std::forward_iterator<feature_set::iterator>);
+
+/// Detects the features of the running CPU.
+///
+/// \return The detected features, or an empty set if the CPUID instruction is not supported.
+inline feature_set detect() noexcept {
+    cpu_features features{};
+    cpu_basic_info basic_info{};
+
+    if (get_cpu_features(&features, &basic_info) != 0) return {};
+    return feature_set{features};
+}
+
+/// Detects some features of the running CPU, executing only the CPUID leaves of some feature groups.
+///
+/// \param groups A bitmask of \p cpuidx_feature_group values, e.g. \p CPUIDX_GROUP_SIMD.
+/// \return The detected features, including others sharing their leaves, or an empty set if the CPUID
+///         instruction is not supported.
+inline feature_set detect(const std::uint32_t groups) noexcept {
+    cpu_features features{};
+    cpu_basic_info basic_info{};
+
+    if (get_cpu_features_selective(groups, &features, &basic_info) != 0) return {};
+    return feature_set{features};
+}
+
+/// Gets the usable features of the running CPU, detected once per process.
+///
+/// Features whose register state the OS has not enabled in XCR0, e.g. AVX-512 on a kernel
+/// saving only the AVX state, are removed, as executing their instructions would fault.
+/// So is AMX until the process has the permission for the tile data (ARCH_REQ_XCOMP_PERM on Linux):
+/// request it before the first call to dispatch on AMX.
+///
+/// \return The usable features, or an empty set if the CPUID instruction is not supported.
+inline const feature_set& cached() noexcept {
+    static const feature_set features = [] {
+        feature_set usable{*cpuidx_cached_features()};
+        const std::uint64_t xcr0 = cpuidx_ifunc_usable_xcr0();
+
+        for (const feature f : feature_set{usable}) {
+            const std::uint64_t required = cpuidx_ifunc_required_xcr0(static_cast<cpuidx_feature>(f));
+            if ((xcr0 & required) != required) usable.reset(f);
+        }
+        return usable;
+    }();
+    return features;
+}
+
+/// An implementation of a function, and the features it requires.
+///
+/// \tparam Signature The function type, e.g. <tt>int(const int*, std::size_t)</tt>.
+template <class Signature>
+struct implementation {
+    feature_set required; ///< The features the implementation requires
+    std::string_view name; ///< The name of the implementation, used to force it for testing
+    Signature* function; ///< The implementation
+};
+
+/// Function multi-versioning dispatcher.
+///
+/// The dispatcher resolves once, on construction, to the first of its implementations whose required features
+/// are all available, so list them from the most to the least specific, ending with a generic one.
+/// Calls then cost one indirect call.
+///
+/// For testing, an environment variable may name the implementation to use instead.
+/// The forced implementation is used only if its required features are available.
+///
+/// \code
+/// static const cpuidx::dispatcher<int(const int*, std::size_t)> sum{"SUM_IMPL", {
+///     {{cpuidx::feature::AVX512BW, cpuidx::feature::AVX512VL}, "avx512", sum_avx512},
+///     {{cpuidx::feature::AVX2}, "avx2", sum_avx2},
+///     {{cpuidx::feature::SSE42}, "sse4.2", sum_sse42},
+///     {{}, "generic", sum_generic},
+/// }};
+///
+/// const int total = sum(data, size);
+/// \endcode
+///
+/// \tparam Signature The function type, e.g. <tt>int(const int*, std::size_t)</tt>.
+/// \tparam Capacity The maximum number of implementations.
+template <class Signature, std::size_t Capacity = 8>
+class dispatcher;
+
+template <class R, class... Args, std::size_t Capacity>
+class dispatcher<R(Args...), Capacity> {
+public:
+    using implementation_type = implementation<R(Args...)>;
+
+    /// Creates the dispatcher, and resolves it against the cached features.
+    ///
+    /// \param env The name of the environment variable forcing an implementation, or a null pointer.
+    /// \param implementations The implementations, from the most to the least specific.
+    ///        There must be at least one, and at most \p Capacity; the last one is used if none is supported.
+    dispatcher(const char* env, const std::initializer_list<implementation_type> implementations) noexcept
+        : dispatcher{env, implementations, cached()} {}
+
+    /// Creates the dispatcher, and resolves it against the given features.
+    dispatcher(const char* env, const std::initializer_list<implementation_type> implementations,
+               const feature_set& available) noexcept : selected_{resolve(env, implementations, available)},
+                                                        function_{selected_.function} {}
+
+    dispatcher(const dispatcher&) = delete;
+    dispatcher& operator=(const dispatcher&) = delete;
+
+    /// Calls the selected implementation.
+    R operator()(Args... args) const { return function_(std::forward<Args>(args)...); }
+
+    /// The selected implementation.
+    [[nodiscard]] const implementation_type& selected() const noexcept { return selected_; }
+
+private:
+    static implementation_type resolve(const char* env, const std::initializer_list<implementation_type> impls,
+                                       const feature_set& available) noexcept {
+        if (impls.size() == 0 || impls.size() > Capacity) std::abort();
+
+        if (const char* forced = env ? std::getenv(env) : nullptr) {
+            for (const implementation_type& impl : impls) {
+                if (impl.name == forced && available.all_of(impl.required)) return impl;
+            }
+        }
+
+        for (const implementation_type& impl : impls) {
+            if (available.all_of(impl.required)) return impl;
+        }
+        return *(impls.end() - 1);
+    }
+
+    implementation_type selected_;
+    R (*const function_)(Args...);
+};
+} // namespace cpuidx
+
+/// Formats a feature as its name. The standard string format specification applies, e.g. "{:<13}".
+template <>
+struct std::formatter<cpuidx::feature> : std::formatter<std::string_view> {
+    auto format(const cpuidx::feature f, std::format_context& ctx) const {
+        return std::formatter<std::string_view>::format(cpuidx::name(f), ctx);
+    }
+};
+
+/// Formats a feature set as the space-separated names of its features, without allocating.
+template <>
+struct std::formatter<cpuidx::feature_set> {
+    constexpr auto parse(const std::format_parse_context& ctx) {
+        if (ctx.begin() != ctx.end() && *ctx.begin() != '}')
+            throw std::format_error("cpuidx::feature_set does not take a format specification");
+        return ctx.begin();
+    }
+
+    auto format(const cpuidx::feature_set& set, std::format_context& ctx) const {
+        auto out = ctx.out();
+        bool first = true;
+
+        for (const cpuidx::feature f : set) {
+            if (!first) *out++ = ' ';
+            out = std::ranges::copy(cpuidx::name(f), out).out;
+            first = false;
+        }
+        return out;
+    }
+};
+
+#endif // CPUIDX_HPP
@@ -0,0 +1,105 @@
+#if defined(__linux__)
+#define _GNU_SOURCE // For syscall
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "cpuidx_internal.h"
+#include <string.h>
+
+// XCR0 bits of the AMX state components
+#define XFEATURE_XTILECFG 17
+#define XFEATURE_XTILEDATA 18
+#define XFEATURE_MASK_AMX ((uint64_t) 1 << XFEATURE_XTILECFG | (uint64_t) 1 << XFEATURE_XTILEDATA)
+
+// Linux arch_prctl codes for dynamically enabled state components (asm/prctl.h, Linux 5.16+)
+#define ARCH_GET_XCOMP_PERM 0x1022
+#define ARCH_REQ_XCOMP_PERM 0x1023
+
+/**
+ * Function to decode the AMX tile palette and TMUL information.
+ *
+ * @param info A pointer to a \p cpuidx_amx_info structure to store the information.
+ * @return 0 on success, -1 if the CPU does not support AMX.
+ */
+int cpuidx_get_amx_info(cpuidx_amx_info* info) {
+    memset(info, 0, sizeof(*info));
+
+    if (!cpuidx_cached_features()->AMXTILE || cpuidx_cached_basic_info()->highest_basic_leaf < 0x1d) return -1;
+
+    uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+
+    // Leaf 0x1D: tile palettes. Sub-leaf 0 holds the highest palette, palette 1 is the only one defined
+    cpuid_extended(0x1d, 0, registers);
+    info->max_palette = registers[0];
+
+    if (info->max_palette >= 1) {
+        cpuid_extended(0x1d, 1, registers);
+        info->total_tile_bytes = registers[0] & 0xffff;
+        info->bytes_per_tile = registers[0] >> 16;
+        info->bytes_per_row = registers[1] & 0xffff;
+        info->max_names = registers[1] >> 16;
+        info->max_rows = registers[2] & 0xffff;
+    }
+
+    // Leaf 0x1E: the TMUL unit
+    if (cpuidx_cached_basic_info()->highest_basic_leaf >= 0x1e) {
+        cpuid_extended(0x1e, 0, registers);
+        info->tmul_max_k = registers[1] & 0xff;
+        info->tmul_max_n = registers[1] >> 8 & 0xffff;
+    }
+
+    return 0;
+}
+
+/**
+ * Function to check AMX is usable by the calling process, requesting the permission for the tile data if asked.
+ *
+ * @param request Whether to request the permission, rather than only check it was granted.
+ * @return 0 if AMX is usable, -1 if the CPU does not support AMX, -2 if the OS did not enable the AMX state
+ *         in XCR0, or -3 if the process does not have the permission.
+ */
+static int check_amx(const bool request) {
+    const cpu_features* features = cpuidx_cached_features();
+
+    if (!features->AMXTILE) return -1;
+    if (!features->OSXSAVE || (xgetbv(0) & XFEATURE_MASK_AMX) != XFEATURE_MASK_AMX) return -2;
+
+#if defined(__linux__) && defined(__x86_64__)
+    unsigned long permitted = 0;
+
+    if (request && syscall(SYS_arch_prctl, ARCH_REQ_XCOMP_PERM, XFEATURE_XTILEDATA) != 0) return -3;
+    if (syscall(SYS_arch_prctl, ARCH_GET_XCOMP_PERM, &permitted) != 0) return -3;
+    if (!(permitted >> XFEATURE_XTILEDATA & 1)) return -3;
+#else
+    (void) request;
+#endif
+
+    return 0;
+}
+
+/**
+ * Function to make AMX usable by the calling process.
+ *
+ * On Linux, the tile data is disabled through XFD (Extended Feature Disable) until the process requests
+ * permission for it, so the first AMX instruction would otherwise raise SIGILL.
+ * This requests the permission, which then holds for all the threads of the process, and verifies it was granted.
+ * Elsewhere, only the XCR0 bits are verified.
+ *
+ * @return 0 if AMX is usable, -1 if the CPU does not support AMX, -2 if the OS did not enable the AMX state
+ *         in XCR0, or -3 if the OS denied the permission (e.g. a Linux kernel older than 5.16).
+ */
+int cpuidx_amx_enable(void) {
+    return check_amx(true);
+}
+
+/**
+ * Function to check whether AMX is usable by the calling process, without requesting the permission, which
+ * would then hold for the rest of the process and enlarge the signal frames of its threads.
+ *
+ * @return 0 if AMX is usable, -1 if the CPU does not support AMX, -2 if the OS did not enable the AMX state
+ *         in XCR0, or -3 if the process has not been granted the permission.
+ */
+int cpuidx_amx_permitted(void) {
+    return check_amx(false);
+}
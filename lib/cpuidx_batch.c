@@ -0,0 +1,200 @@
+#include "cpuidx_internal.h"
+#include <string.h>
+
+// Bounds the sub-leaves enumerated per leaf
+#define MAX_SUB_LEAVES 64
+
+/**
+ * @brief The highest leaf of each range, read once per batch when the range is first queried.
+ */
+struct leaf_limits {
+    uint32_t basic; /**< Highest basic leaf, from leaf 0 */
+    uint32_t extended; /**< Highest extended leaf, from leaf 0x80000000 */
+    uint32_t hypervisor; /**< Highest hypervisor leaf, from leaf 0x40000000, 0 without a hypervisor */
+    uint32_t centaur; /**< Highest Centaur/Zhaoxin leaf, from leaf 0xC0000000, 0 if not implemented */
+    bool hypervisor_read;
+    bool centaur_read;
+};
+
+/**
+ * @brief The results of a batch, counted past the capacity as \p snprintf.
+ */
+struct result_writer {
+    cpuidx_cpuid_result* results; /**< The results, may be null if capacity is 0 */
+    size_t capacity; /**< The size of results */
+    size_t count; /**< The number of results produced, even if not stored */
+};
+
+static void emit(struct result_writer* out, const uint32_t leaf, const uint32_t sub_leaf, const bool valid,
+                 const uint32_t registers[4]) {
+    if (out->count < out->capacity) {
+        cpuidx_cpuid_result* result = &out->results[out->count];
+
+        result->leaf = leaf;
+        result->sub_leaf = sub_leaf;
+        result->valid = valid;
+        memcpy(result->registers, registers, sizeof(result->registers));
+    }
+    ++out->count;
+}
+
+/**
+ * Function to check a leaf against the highest leaf of its range.
+ */
+static bool leaf_valid(struct leaf_limits* limits, const uint32_t leaf) {
+    uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+
+    if (leaf < 0x40000000) return leaf <= limits->basic;
+
+    if (leaf < 0x80000000) {
+        if (!limits->hypervisor_read) {
+            // Only meaningful with the hypervisor bit set (leaf 1 ECX bit 31)
+            if (cpuidx_cached_features()->HYPRVSR) {
+                cpuid(0x40000000, registers);
+                limits->hypervisor = registers[0] >= 0x40000000 && registers[0] < 0x40010000 ? registers[0] : 0;
+            }
+            limits->hypervisor_read = true;
+        }
+        return leaf <= limits->hypervisor;
+    }
+
+    if (leaf < 0xc0000000) return limits->extended >= 0x80000000 && leaf <= limits->extended;
+
+    if (!limits->centaur_read) {
+        cpuid(0xc0000000, registers);
+        limits->centaur = registers[0] >= 0xc0000000 && registers[0] < 0xc0010000 ? registers[0] : 0;
+        limits->centaur_read = true;
+    }
+    return leaf <= limits->centaur;
+}
+
+/**
+ * Function to query every sub-leaf of a leaf, until the terminating condition of the leaf.
+ *
+ * Sub-leaf 0 is always queried. The terminating sub-leaf of a list, e.g. the null cache of leaf 4, is not emitted.
+ */
+static void enumerate(struct result_writer* out, const uint32_t leaf) {
+    uint32_t first[4] = {0}, registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+    uint64_t mask = 0;
+
+    cpuid_extended(leaf, 0, first);
+    emit(out, leaf, 0, true, first);
+
+    switch (leaf) {
+        case 0x4:
+        case 0x8000001d:
+            // Cache parameters: until the cache type (EAX bits 4:0) is null
+            for (uint32_t sub_leaf = 1; sub_leaf < MAX_SUB_LEAVES && first[0] & 0x1f; ++sub_leaf) {
+                cpuid_extended(leaf, sub_leaf, registers);
+                if (!(registers[0] & 0x1f)) break;
+                emit(out, leaf, sub_leaf, true, registers);
+            }
+            break;
+        case 0xb:
+        case 0x1f:
+            // Topology levels: until the level type (ECX bits 15:8) is invalid
+            for (uint32_t sub_leaf = 1; sub_leaf < MAX_SUB_LEAVES && first[2] >> 8 & 0xff; ++sub_leaf) {
+                cpuid_extended(leaf, sub_leaf, registers);
+                if (!(registers[2] >> 8 & 0xff)) break;
+                emit(out, leaf, sub_leaf, true, registers);
+            }
+            break;
+        case 0x7:
+        case 0x14:
+        case 0x17:
+        case 0x18:
+        case 0x1d:
+        case 0x20:
+        case 0x23:
+        case 0x24:
+            // The highest sub-leaf is in EAX of sub-leaf 0
+            for (uint32_t sub_leaf = 1; sub_leaf <= first[0] && sub_leaf < MAX_SUB_LEAVES; ++sub_leaf) {
+                cpuid_extended(leaf, sub_leaf, registers);
+                emit(out, leaf, sub_leaf, true, registers);
+            }
+            break;
+        case 0xd:
+            // Sub-leaf 1, then the state components supported in XCR0 (EDX:EAX of 0) or IA32_XSS (EDX:ECX of 1)
+            cpuid_extended(leaf, 1, registers);
+            emit(out, leaf, 1, true, registers);
+            mask = ((uint64_t) first[3] << 32 | first[0]) | ((uint64_t) registers[3] << 32 | registers[2]);
+            for (uint32_t sub_leaf = 2; sub_leaf < MAX_SUB_LEAVES; ++sub_leaf) {
+                if (!(mask >> sub_leaf & 1)) continue;
+                cpuid_extended(leaf, sub_leaf, registers);
+                emit(out, leaf, sub_leaf, true, registers);
+            }
+            break;
+        case 0xf:
+        case 0x10:
+        case 0x80000020:
+            // Resource director technology: a bitmap of the resource sub-leaves, in EDX (0xF) or EBX
+            mask = leaf == 0xf ? first[3] : first[1];
+            for (uint32_t sub_leaf = 1; sub_leaf < 32; ++sub_leaf) {
+                if (!(mask >> sub_leaf & 1)) continue;
+                cpuid_extended(leaf, sub_leaf, registers);
+                emit(out, leaf, sub_leaf, true, registers);
+            }
+            break;
+        case 0x12:
+            // SGX: sub-leaf 1, then the EPC sections until an invalid one (EAX bits 3:0)
+            cpuid_extended(leaf, 1, registers);
+            emit(out, leaf, 1, true, registers);
+            for (uint32_t sub_leaf = 2; sub_leaf < MAX_SUB_LEAVES; ++sub_leaf) {
+                cpuid_extended(leaf, sub_leaf, registers);
+                if (!(registers[0] & 0xf)) break;
+                emit(out, leaf, sub_leaf, true, registers);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * Function to execute a batch of CPUID queries in one call.
+ *
+ * Each leaf is checked against the highest leaf of its range: basic, hypervisor (0x40000000), extended
+ * (0x80000000) or Centaur (0xC0000000), read once per batch. A query beyond it is not executed, and gives
+ * a result with \p valid unset and zero registers.
+ * A request with the sub-leaf \p CPUIDX_ALL_SUB_LEAVES gives a result per sub-leaf of the leaf, enumerated
+ * until the terminating condition of the leaf: the null cache of leaf 4, the highest sub-leaf in EAX of leaf 7,
+ * the supported state components of leaf 0xD, etc. Leaves without sub-leaves give sub-leaf 0.
+ *
+ * \code
+ * const cpuidx_cpuid_request requests[] = {{0x1, 0}, {0x4, CPUIDX_ALL_SUB_LEAVES}, {0x80000008, 0}};
+ * cpuidx_cpuid_result results[64];
+ * const size_t count = cpuidx_cpuid_batch(requests, 3, results, 64);
+ * \endcode
+ *
+ * @param requests The queries.
+ * @param request_count The number of queries.
+ * @param results An array to store the results, in request order, may be null if \p capacity is 0.
+ * @param capacity The size of the results array.
+ * @return The number of results, which may exceed \p capacity as \p snprintf; only \p capacity are stored.
+ */
+size_t cpuidx_cpuid_batch(const cpuidx_cpuid_request* CPUIDX_RESTRICT requests, const size_t request_count,
+                          cpuidx_cpuid_result* CPUIDX_RESTRICT results, const size_t capacity) {
+    const cpu_basic_info* basic_info = cpuidx_cached_basic_info();
+    struct leaf_limits limits = {.basic = basic_info->highest_basic_leaf,
+                                 .extended = basic_info->highest_extended_leaf};
+    struct result_writer out = {results, capacity, 0};
+    const uint32_t none[4] = {0};
+
+    for (size_t i = 0; i < request_count; ++i) {
+        const cpuidx_cpuid_request* request = &requests[i];
+
+        // Leaf 0 is 0 without CPUID, so that nothing is executed then
+        if (!basic_info->highest_basic_leaf || !leaf_valid(&limits, request->leaf)) {
+            emit(&out, request->leaf, request->sub_leaf == CPUIDX_ALL_SUB_LEAVES ? 0 : request->sub_leaf, false, none);
+        } else if (request->sub_leaf == CPUIDX_ALL_SUB_LEAVES) {
+            enumerate(&out, request->leaf);
+        } else {
+            uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+
+            cpuid_extended(request->leaf, request->sub_leaf, registers);
+            emit(&out, request->leaf, request->sub_leaf, true, registers);
+        }
+    }
+
+    return out.count;
+}
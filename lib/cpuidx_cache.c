@@ -0,0 +1,256 @@
+#include "cpuidx_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <malloc.h>
+#define ALIGNED_ALLOC(alignment, size) _aligned_malloc((size), (alignment))
+#define ALIGNED_FREE(memory) _aligned_free(memory)
+#else
+#define ALIGNED_ALLOC(alignment, size) aligned_alloc((alignment), (size))
+#define ALIGNED_FREE(memory) free(memory)
+#endif
+
+// Used when CPUID does not enumerate a line size
+#define DEFAULT_LINE_SIZE 64
+
+static long line_size;
+static long interference_size;
+
+/**
+ * Function to get the line size of the level 1 data cache from the cache parameter leaves.
+ *
+ * @return The line size in bytes, or 0 if not enumerated.
+ */
+static uint32_t enumerated_line_size(void) {
+    const cpu_basic_info* basic_info = cpuidx_cached_basic_info();
+    uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+
+    // Deterministic cache parameters (Intel), sub-leaf 0 is the level 1 data cache: EBX bits 11:0 + 1
+    if (basic_info->highest_basic_leaf >= 4) {
+        cpuid_extended(4, 0, registers);
+        if (registers[0] & 0x1f) return (registers[1] & 0xfff) + 1;
+    }
+
+    // The same layout in leaf 0x8000001D (AMD, with TOPOEXT, all zero without)
+    if (basic_info->highest_extended_leaf >= 0x8000001d) {
+        cpuid_extended(0x8000001d, 0, registers);
+        if (registers[0] & 0x1f) return (registers[1] & 0xfff) + 1;
+    }
+
+    // Level 1 data cache line size (AMD): ECX bits 7:0
+    if (basic_info->highest_extended_leaf >= 0x80000005) {
+        cpuid(0x80000005, registers);
+        if (registers[2] & 0xff) return registers[2] & 0xff;
+    }
+
+    // CLFLUSH line size, in 8-byte units: leaf 1 EBX bits 15:8
+    if (cpuidx_cached_features()->CLFSH) {
+        cpuid(1, registers);
+        return (registers[1] >> 8 & 0xff) * 8;
+    }
+
+    return 0;
+}
+
+/**
+ * Function to read the caches of a deterministic cache parameters leaf: 4 (Intel) or 0x8000001D (AMD).
+ *
+ * @return true if the leaf enumerated at least one cache.
+ */
+static bool read_cache_leaf(const uint32_t leaf, cpuidx_cache_info* info) {
+    uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+    bool found = false;
+
+    for (uint32_t sub_leaf = 0; sub_leaf < 16; ++sub_leaf) {
+        cpuid_extended(leaf, sub_leaf, registers);
+
+        const uint32_t type = registers[0] & 0x1f; // 0: no more caches, 1: data, 2: instruction, 3: unified
+        const uint32_t level = registers[0] >> 5 & 0x7;
+
+        if (type == 0) break;
+        if (type == 2 || level < 1 || level > CPUIDX_CACHE_LEVELS) continue;
+
+        cpuidx_cache_level* cache = &info->levels[level - 1];
+        cache->line_size = (registers[1] & 0xfff) + 1;
+        cache->ways = (registers[1] >> 22) + 1;
+        cache->sets = registers[2] + 1;
+        // Ways * partitions * line size * sets
+        cache->size = cache->ways * ((registers[1] >> 12 & 0x3ff) + 1) * cache->line_size * cache->sets;
+        cache->shared_by = (registers[0] >> 14 & 0xfff) + 1;
+        found = true;
+    }
+    return found;
+}
+
+/**
+ * Function to decode the associativity field of leaf 0x80000006.
+ */
+static uint32_t legacy_ways(const uint32_t field, const uint32_t size, const uint32_t line_size) {
+    static const uint32_t ways[16] = {0, 1, 2, 3, 4, 5, 8, 0, 16, 0, 32, 48, 64, 96, 128, 0};
+
+    // 0xF: fully associative
+    return field == 0xf && line_size ? size / line_size : ways[field];
+}
+
+/**
+ * Function to detect the geometry of the data and unified caches with CPUID.
+ *
+ * Uses CPUID leaf 4 on Intel and leaf 0x8000001D on AMD, and otherwise the legacy AMD leaves 0x80000005 and
+ * 0x80000006. Levels that are not enumerated are left zero.
+ *
+ * @param basic_info The basic CPU information giving the highest leaves, which \p cpuidzd detects afresh.
+ * @param info A pointer to a \p cpuidx_cache_info structure to store the caches.
+ * @return 0 on success, -1 if no cache is enumerated.
+ */
+int cpuidx_detect_cache_info(const cpu_basic_info* basic_info, cpuidx_cache_info* info) {
+    uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+
+    memset(info, 0, sizeof(*info));
+
+    if (basic_info->highest_basic_leaf >= 4 && read_cache_leaf(4, info)) return 0;
+    if (basic_info->highest_extended_leaf >= 0x8000001d && read_cache_leaf(0x8000001d, info)) return 0;
+
+    if (basic_info->highest_extended_leaf >= 0x80000005) {
+        cpuidx_cache_level* l1 = &info->levels[0];
+
+        // ECX: size in KiB (31:24), associativity (23:16, 0xFF: fully), line size (7:0)
+        cpuid(0x80000005, registers);
+        l1->size = (registers[2] >> 24) * 1024;
+        l1->line_size = registers[2] & 0xff;
+        l1->ways = (registers[2] >> 16 & 0xff) == 0xff && l1->line_size ? l1->size / l1->line_size
+                                                                           : registers[2] >> 16 & 0xff;
+    }
+
+    if (basic_info->highest_extended_leaf >= 0x80000006) {
+        cpuidx_cache_level* l2 = &info->levels[1];
+        cpuidx_cache_level* l3 = &info->levels[2];
+
+        // ECX: L2 size in KiB (31:16), associativity (15:12), line size (7:0)
+        // EDX: L3 size in 512 KiB units (31:18), associativity (15:12), line size (7:0)
+        cpuid(0x80000006, registers);
+        l2->size = (registers[2] >> 16) * 1024;
+        l2->line_size = registers[2] & 0xff;
+        l2->ways = legacy_ways(registers[2] >> 12 & 0xf, l2->size, l2->line_size);
+        l3->size = (registers[3] >> 18) * 512 * 1024;
+        l3->line_size = registers[3] & 0xff;
+        l3->ways = legacy_ways(registers[3] >> 12 & 0xf, l3->size, l3->line_size);
+    }
+
+    for (int i = 0; i < CPUIDX_CACHE_LEVELS; ++i) {
+        cpuidx_cache_level* cache = &info->levels[i];
+        if (cache->ways && cache->line_size) cache->sets = cache->size / (cache->ways * cache->line_size);
+    }
+
+    return info->levels[0].size || info->levels[1].size ? 0 : -1;
+}
+
+/**
+ * Function to get the geometry of the data and unified caches.
+ *
+ * Reads the snapshot published by \p cpuidzd when there is one, and otherwise detects the caches with CPUID.
+ *
+ * @param info A pointer to a \p cpuidx_cache_info structure to store the caches.
+ * @return 0 on success, -1 if no cache is enumerated.
+ */
+int cpuidx_get_cache_info(cpuidx_cache_info* info) {
+    if (cpuidx_snapshot_caches(info) == 0) return 0;
+    return cpuidx_detect_cache_info(cpuidx_cached_basic_info(), info);
+}
+
+/**
+ * Function to get the cache line size of the CPU, detected once per process.
+ *
+ * Uses the level 1 data cache line size of CPUID leaf 4, or leaves 0x8000001D and 0x80000005 on AMD,
+ * and otherwise the CLFLUSH line size of leaf 1.
+ *
+ * @return The line size in bytes, 64 if not enumerated.
+ */
+size_t cpuidx_cache_line_size(void) {
+    long size = CPUIDX_LOAD_ACQUIRE(&line_size);
+
+    if (!size) {
+        const uint32_t enumerated = enumerated_line_size();
+
+        // A size which is not a power of two is not a line size
+        size = enumerated && !(enumerated & (enumerated - 1)) ? (long) enumerated : DEFAULT_LINE_SIZE;
+        CPUIDX_STORE_RELEASE(&line_size, size);
+    }
+    return (size_t) size;
+}
+
+/**
+ * Function to get the minimum distance between objects written by different threads to avoid false sharing,
+ * detected once per process, unlike \p std::hardware_destructive_interference_size.
+ *
+ * The spatial prefetcher of Intel cores fetches lines in aligned pairs, so that writes to either line of
+ * a pair contend as writes to the same line would. The distance is two lines there, and one line otherwise.
+ *
+ * @return The distance in bytes, a power of two.
+ */
+size_t cpuidx_destructive_interference_size(void) {
+    long size = CPUIDX_LOAD_ACQUIRE(&interference_size);
+
+    if (!size) {
+        const bool paired_lines = strcmp(cpuidx_cached_basic_info()->vendor, "GenuineIntel") == 0;
+
+        size = (long) cpuidx_cache_line_size() * (paired_lines ? 2 : 1);
+        CPUIDX_STORE_RELEASE(&interference_size, size);
+    }
+    return (size_t) size;
+}
+
+/**
+ * Function to allocate a pool of zero-initialized slots, each aligned and padded to the destructive
+ * interference size, e.g. for per-thread counters or the slots of a queue.
+ *
+ * \code
+ * cpuidx_padded_pool counters;
+ *
+ * if (cpuidx_padded_pool_create(&counters, sizeof(uint64_t), threads) != 0) return -1;
+ * ++*(uint64_t*) cpuidx_padded_pool_slot(&counters, thread);
+ * \endcode
+ *
+ * @param pool A pointer to the \p cpuidx_padded_pool structure to initialize.
+ * @param object_size The size of the objects stored in the slots.
+ * @param count The number of slots.
+ * @return 0 on success, -1 if a size is 0 or the allocation failed.
+ */
+int cpuidx_padded_pool_create(cpuidx_padded_pool* pool, const size_t object_size, const size_t count) {
+    const size_t alignment = cpuidx_destructive_interference_size();
+
+    memset(pool, 0, sizeof(*pool));
+    if (!object_size || !count || object_size > SIZE_MAX - alignment) return -1;
+
+    const size_t stride = (object_size + alignment - 1) / alignment * alignment;
+    if (count > SIZE_MAX / stride) return -1;
+
+    pool->memory = ALIGNED_ALLOC(alignment, stride * count);
+    if (!pool->memory) return -1;
+
+    memset(pool->memory, 0, stride * count);
+    pool->stride = stride;
+    pool->count = count;
+    return 0;
+}
+
+/**
+ * Function to get a slot of a pool.
+ *
+ * @param pool A pointer to the pool.
+ * @param index The index of the slot.
+ * @return A pointer to the slot, or a null pointer if \p index is out of range.
+ */
+void* cpuidx_padded_pool_slot(const cpuidx_padded_pool* pool, const size_t index) {
+    return index < pool->count ? (char*) pool->memory + index * pool->stride : NULL;
+}
+
+/**
+ * Function to free the slots of a pool.
+ *
+ * @param pool A pointer to the pool, created by \p cpuidx_padded_pool_create.
+ */
+void cpuidx_padded_pool_destroy(cpuidx_padded_pool* pool) {
+    ALIGNED_FREE(pool->memory);
+    memset(pool, 0, sizeof(*pool));
+}
@@ -0,0 +1,239 @@
+#if defined(__linux__)
+#define _GNU_SOURCE // For sched_getcpu
+#include <sched.h>
+#if defined(__GLIBC__)
+#if __GLIBC_PREREQ(2, 35)
+// glibc registers a restartable sequence area for each thread, whose cpu_id the kernel updates
+#include <sys/rseq.h>
+#define HAVE_RSEQ 1
+#endif
+#endif
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include "cpuidx_internal.h"
+#include <stddef.h>
+#include <stdlib.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <immintrin.h>
+#endif
+
+// CPUs covered by the core type table, as the snapshot
+#define MAX_CPUS 1024
+
+// Linux stores (node << 12) | cpu in IA32_TSC_AUX, as does the getcpu vDSO
+#define TSC_AUX_CPU_MASK 0xfff
+
+// Samples of IA32_TSC_AUX compared with the OS when selecting the method
+#define VALIDATION_SAMPLES 8
+
+/**
+ * @brief The ways to read the current CPU, from the fastest.
+ */
+enum cpu_method {
+    CPU_UNKNOWN, /**< Not selected yet */
+    CPU_RSEQ, /**< A load of the cpu_id of the rseq area of glibc */
+    CPU_RDPID, /**< RDPID, reading IA32_TSC_AUX */
+    CPU_RDTSCP, /**< RDTSCP, reading IA32_TSC_AUX along with the TSC */
+    CPU_OS /**< sched_getcpu, or GetCurrentProcessorNumber */
+};
+
+static long cpu_method;
+static uint8_t core_types[MAX_CPUS];
+static long core_types_claimed;
+static long core_types_ready;
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define RDPID() _rdpid_u32()
+#define RDTSCP_AUX(aux) ((void) __rdtscp(&(aux)))
+#else
+static inline uint32_t rdpid(void) {
+    uintptr_t aux; // The register is 64-bit in 64-bit mode
+    __asm__ volatile ("rdpid %0" : "=r" (aux));
+    return (uint32_t) aux;
+}
+
+#define RDPID() rdpid()
+
+#if HAVE_RSEQ
+static inline uint32_t rseq_cpu_id(void) {
+    uint32_t cpu;
+    // The area is at __rseq_offset from the thread pointer
+#if defined(__x86_64__)
+    __asm__ volatile ("movl %%fs:(%1), %0" : "=r" (cpu) : "r" (__rseq_offset + offsetof(struct rseq, cpu_id)));
+#else
+    __asm__ volatile ("movl %%gs:(%1), %0" : "=r" (cpu) : "r" (__rseq_offset + offsetof(struct rseq, cpu_id)));
+#endif
+    return cpu;
+}
+#endif
+#define RDTSCP_AUX(aux) __asm__ volatile ("rdtscp" : "=c" (aux) : : "eax", "edx")
+#endif
+
+/**
+ * Function to read the current CPU from the OS.
+ */
+static int os_current_cpu(void) {
+#if defined(__linux__)
+    return sched_getcpu();
+#elif defined(_WIN32)
+    return (int) GetCurrentProcessorNumber();
+#else
+    return -1;
+#endif
+}
+
+/**
+ * Function to read the current CPU with a method.
+ */
+static int read_current_cpu(const enum cpu_method method) {
+    uint32_t aux = 0;
+
+    switch (method) {
+#if HAVE_RSEQ
+        case CPU_RSEQ:
+            return (int) rseq_cpu_id();
+#endif
+        case CPU_RDPID:
+            return (int) (RDPID() & TSC_AUX_CPU_MASK);
+        case CPU_RDTSCP:
+            RDTSCP_AUX(aux);
+            return (int) (aux & TSC_AUX_CPU_MASK);
+        default:
+            return os_current_cpu();
+    }
+}
+
+/**
+ * Function to select the method reading the current CPU, once.
+ *
+ * The rseq area is a plain load, faster than RDPID or RDTSCP, if glibc registered it for the threads.
+ * IA32_TSC_AUX holds the CPU number only if the OS programs it so, as Linux does. It is trusted once it matches
+ * the OS on a sample taken without a migration in between.
+ */
+static enum cpu_method select_method(void) {
+    long method = CPUIDX_LOAD_ACQUIRE(&cpu_method);
+    if (method != CPU_UNKNOWN) return (enum cpu_method) method;
+
+    const cpu_features* features = cpuidx_cached_features();
+    method = features->RDPID ? CPU_RDPID : features->RDTSCP ? CPU_RDTSCP : CPU_OS;
+#if HAVE_RSEQ
+    // Unregistered areas read RSEQ_CPU_ID_UNINITIALIZED
+    if (__rseq_size > 0 && (int) rseq_cpu_id() >= 0) method = CPU_RSEQ;
+#endif
+
+    if (method != CPU_OS && method != CPU_RSEQ) {
+        bool matched = false;
+
+        for (int sample = 0; sample < VALIDATION_SAMPLES && !matched; ++sample) {
+            const int before = os_current_cpu();
+            const int aux = read_current_cpu((enum cpu_method) method);
+            matched = before >= 0 && before == aux && os_current_cpu() == before;
+        }
+        if (!matched) method = CPU_OS;
+    }
+
+    CPUIDX_STORE_RELEASE(&cpu_method, method);
+    return (enum cpu_method) method;
+}
+
+/**
+ * Function to get the logical CPU running the caller, as numbered by the OS.
+ *
+ * It loads the cpu_id that the kernel keeps in the rseq area of glibc 2.35 and later when registered, then takes
+ * RDPID when available, then RDTSCP, reading the CPU number that the OS stores in IA32_TSC_AUX,
+ * and otherwise sched_getcpu (the getcpu vDSO) or GetCurrentProcessorNumber. The result may be stale as soon as
+ * it is returned if the thread migrates, which suits per-CPU sharding but not correctness.
+ *
+ * @return The logical CPU, or -1 if it cannot be read.
+ */
+int cpuidx_current_cpu(void) {
+    return read_current_cpu(select_method());
+}
+
+/**
+ * Function to read the core type of the current CPU, from CPUID leaf 0x1A.
+ */
+static enum cpuidx_core_type read_core_type(void) {
+    uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+
+    // Native model ID and core type: leaf 0x1A EAX bits 31:24
+    cpuid_extended(0x1a, 0, registers);
+    return (enum cpuidx_core_type) (registers[0] >> 24);
+}
+
+#if defined(__linux__)
+/**
+ * Function to mark the CPUs of a sysfs CPU list, e.g. "0-7,16", with a core type.
+ *
+ * @param path The path of the list, e.g. /sys/devices/cpu_core/cpus.
+ * @param core_type The core type of the CPUs of the list.
+ */
+static void read_core_type_list(const char* path, const enum cpuidx_core_type core_type) {
+    char text[4096];
+    char* position = text;
+
+    if (cpuidx_read_file(path, text, sizeof(text)) != 0) return;
+
+    while (*position >= '0' && *position <= '9') {
+        const unsigned long first = strtoul(position, &position, 10);
+        const unsigned long last = *position == '-' ? strtoul(position + 1, &position, 10) : first;
+
+        for (unsigned long cpu = first; cpu <= last && cpu < MAX_CPUS; ++cpu) core_types[cpu] = (uint8_t) core_type;
+        if (*position == ',') ++position;
+    }
+}
+#endif
+
+/**
+ * Function to fill the core type table of the logical CPUs, once.
+ *
+ * The types come from the snapshot of cpuidzd if published, and otherwise from the CPU lists of the hybrid PMUs
+ * in sysfs. Running CPUID on each CPU would migrate the caller, so without either, the table stays empty.
+ *
+ * @return true if the table is ready, false while another thread is filling it.
+ */
+static bool fill_core_types(void) {
+    if (CPUIDX_LOAD_ACQUIRE(&core_types_ready)) return true;
+    if (CPUIDX_EXCHANGE(&core_types_claimed, 1)) return false;
+
+    cpuidx_cpu_topology* cpus = malloc(MAX_CPUS * sizeof(*cpus));
+    const size_t found = cpus ? cpuidx_snapshot_topology(cpus, MAX_CPUS) : 0;
+
+    for (size_t i = 0; i < found && i < MAX_CPUS; ++i) {
+        if (cpus[i].cpu < MAX_CPUS) core_types[cpus[i].cpu] = (uint8_t) cpus[i].core_type;
+    }
+    free(cpus);
+
+#if defined(__linux__)
+    if (!found) {
+        read_core_type_list("/sys/devices/cpu_core/cpus", CPUIDX_CORE_TYPE_CORE);
+        read_core_type_list("/sys/devices/cpu_atom/cpus", CPUIDX_CORE_TYPE_ATOM);
+    }
+#endif
+
+    CPUIDX_STORE_RELEASE(&core_types_ready, 1);
+    return true;
+}
+
+/**
+ * Function to get the core type of the logical CPU running the caller, on hybrid CPUs.
+ *
+ * The core types of the CPUs are read once, on the first call, from the snapshot of \p cpuidzd or from sysfs,
+ * without migrating the caller, so that later calls cost \p cpuidx_current_cpu and a table lookup.
+ * Until the table is filled, or for CPUs outside it, leaf 0x1A is executed directly.
+ *
+ * @return \p CPUIDX_CORE_TYPE_ATOM or \p CPUIDX_CORE_TYPE_CORE, or \p CPUIDX_CORE_TYPE_NONE on non-hybrid CPUs.
+ */
+enum cpuidx_core_type cpuidx_current_core_type(void) {
+    const cpu_features* features = cpuidx_cached_features();
+
+    if (!features->HYBRID || cpuidx_cached_basic_info()->highest_basic_leaf < 0x1a) return CPUIDX_CORE_TYPE_NONE;
+
+    const int cpu = cpuidx_current_cpu();
+    if (cpu < 0 || cpu >= MAX_CPUS || !fill_core_types() || !core_types[cpu]) return read_core_type();
+
+    return (enum cpuidx_core_type) core_types[cpu];
+}
@@ -0,0 +1,474 @@
+#include "cpuidx.h"
+#include <string.h>
+
+// The feature table relies on every field of cpu_features being a bool, in declaration order
+_Static_assert(sizeof(cpu_features) == CPUIDX_FEATURE_COUNT * sizeof(bool), "CPUIDX_FEATURES is out of sync");
+
+static const char* const feature_names[] = {
+#define CPUIDX_X_NAME(field, name, leaf, sub_leaf, reg, mask) name,
+    CPUIDX_FEATURES(CPUIDX_X_NAME)
+#undef CPUIDX_X_NAME
+};
+
+/**
+ * @brief A GCC/Clang \p -m option, its predefined macro, and the lowest x86-64 level that already implies it.
+ */
+struct feature_flag {
+    size_t offset; /**< Offset of the feature in \p cpu_features */
+    const char* option; /**< The option, without the leading \p -m */
+    const char* macro; /**< The macro the compiler defines when targeting the feature */
+    int level; /**< The x86-64 level implying the option, 0 if none does */
+};
+
+#define FLAG(field, option, macro, level) {offsetof(cpu_features, field), option, macro, level}
+
+static const struct feature_flag feature_flags[] = {
+    FLAG(MMX, "mmx", "__MMX__", 1),
+    FLAG(SSE, "sse", "__SSE__", 1),
+    FLAG(SSE2, "sse2", "__SSE2__", 1),
+    FLAG(FXSR, "fxsr", "__FXSR__", 1),
+    FLAG(SSE3, "sse3", "__SSE3__", 2),
+    FLAG(SSSE3, "ssse3", "__SSSE3__", 2),
+    FLAG(SSE41, "sse4.1", "__SSE4_1__", 2),
+    FLAG(SSE42, "sse4.2", "__SSE4_2__", 2),
+    FLAG(POPCNT, "popcnt", "__POPCNT__", 2),
+    FLAG(CMPXCHG16B, "cx16", "__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16", 2),
+    FLAG(LAHF_LM, "sahf", "__LAHF_SAHF__", 2),
+    FLAG(AVX, "avx", "__AVX__", 3),
+    FLAG(AVX2, "avx2", "__AVX2__", 3),
+    FLAG(BMI, "bmi", "__BMI__", 3),
+    FLAG(BMI2, "bmi2", "__BMI2__", 3),
+    FLAG(F16C, "f16c", "__F16C__", 3),
+    FLAG(FMA, "fma", "__FMA__", 3),
+    FLAG(ABM, "lzcnt", "__LZCNT__", 3),
+    FLAG(MOVBE, "movbe", "__MOVBE__", 3),
+    FLAG(XSAVE, "xsave", "__XSAVE__", 3),
+    FLAG(AVX512F, "avx512f", "__AVX512F__", 4),
+    FLAG(AVX512BW, "avx512bw", "__AVX512BW__", 4),
+    FLAG(AVX512CD, "avx512cd", "__AVX512CD__", 4),
+    FLAG(AVX512DQ, "avx512dq", "__AVX512DQ__", 4),
+    FLAG(AVX512VL, "avx512vl", "__AVX512VL__", 4),
+    FLAG(PCLMULQDQ, "pclmul", "__PCLMUL__", 0),
+    FLAG(AESNI, "aes", "__AES__", 0),
+    FLAG(RDRND, "rdrnd", "__RDRND__", 0),
+    FLAG(FSGSBASE, "fsgsbase", "__FSGSBASE__", 0),
+    FLAG(SGX, "sgx", "__SGX__", 0),
+    FLAG(HLE, "hle", "__HLE__", 0),
+    FLAG(RTM, "rtm", "__RTM__", 0),
+    FLAG(RDSEED, "rdseed", "__RDSEED__", 0),
+    FLAG(ADX, "adx", "__ADX__", 0),
+    FLAG(AVX512IFMA, "avx512ifma", "__AVX512IFMA__", 0),
+    FLAG(CLFLUSHOPT, "clflushopt", "__CLFLUSHOPT__", 0),
+    FLAG(CLWB, "clwb", "__CLWB__", 0),
+    FLAG(SHA, "sha", "__SHA__", 0),
+    FLAG(PKU, "pku", "__PKU__", 0),
+    FLAG(WAITPKG, "waitpkg", "__WAITPKG__", 0),
+    FLAG(AVX512VBMI, "avx512vbmi", "__AVX512VBMI__", 0),
+    FLAG(AVX512VBMI2, "avx512vbmi2", "__AVX512VBMI2__", 0),
+    FLAG(SHSTK, "shstk", "__SHSTK__", 0),
+    FLAG(GFNI, "gfni", "__GFNI__", 0),
+    FLAG(VAES, "vaes", "__VAES__", 0),
+    FLAG(VPCLMULQDQ, "vpclmulqdq", "__VPCLMULQDQ__", 0),
+    FLAG(AVX512VNNI, "avx512vnni", "__AVX512VNNI__", 0),
+    FLAG(AVX512BITALG, "avx512bitalg", "__AVX512BITALG__", 0),
+    FLAG(AVX512VPOPCNTDQ, "avx512vpopcntdq", "__AVX512VPOPCNTDQ__", 0),
+    FLAG(RDPID, "rdpid", "__RDPID__", 0),
+    FLAG(KL, "kl", "__KL__", 0),
+    FLAG(CLDEMOTE, "cldemote", "__CLDEMOTE__", 0),
+    FLAG(MOVDIRI, "movdiri", "__MOVDIRI__", 0),
+    FLAG(MOVDIR64B, "movdir64b", "__MOVDIR64B__", 0),
+    FLAG(ENQCMD, "enqcmd", "__ENQCMD__", 0),
+    FLAG(UINTR, "uintr", "__UINTR__", 0),
+    FLAG(AVX512VP2INTERSECT, "avx512vp2intersect", "__AVX512VP2INTERSECT__", 0),
+    FLAG(SERIALIZE, "serialize", "__SERIALIZE__", 0),
+    FLAG(TSXLDTRK, "tsxldtrk", "__TSXLDTRK__", 0),
+    FLAG(PCONFIG, "pconfig", "__PCONFIG__", 0),
+    FLAG(AMXBF16, "amx-bf16", "__AMX_BF16__", 0),
+    FLAG(AVX512FP16, "avx512fp16", "__AVX512FP16__", 0),
+    FLAG(AMXTILE, "amx-tile", "__AMX_TILE__", 0),
+    FLAG(AMXINT8, "amx-int8", "__AMX_INT8__", 0),
+    FLAG(SHA512, "sha512", "__SHA512__", 0),
+    FLAG(SM3, "sm3", "__SM3__", 0),
+    FLAG(SM4, "sm4", "__SM4__", 0),
+    FLAG(RAOINT, "raoint", "__RAOINT__", 0),
+    FLAG(AVXVNNI, "avxvnni", "__AVXVNNI__", 0),
+    FLAG(AVX512BF16, "avx512bf16", "__AVX512BF16__", 0),
+    FLAG(CMPCCXADD, "cmpccxadd", "__CMPCCXADD__", 0),
+    FLAG(AMXFP16, "amx-fp16", "__AMX_FP16__", 0),
+    FLAG(HRESET, "hreset", "__HRESET__", 0),
+    FLAG(AVXIFMA, "avxifma", "__AVXIFMA__", 0),
+    FLAG(MOVRS, "movrs", "__MOVRS__", 0),
+    FLAG(AVXVNNIINT8, "avxvnniint8", "__AVXVNNIINT8__", 0),
+    FLAG(AVXNECONVERT, "avxneconvert", "__AVXNECONVERT__", 0),
+    FLAG(AMXCOMPLEX, "amx-complex", "__AMX_COMPLEX__", 0),
+    FLAG(AVXVNNIINT16, "avxvnniint16", "__AVXVNNIINT16__", 0),
+    FLAG(PREFETCHI, "prefetchi", "__PREFETCHI__", 0),
+    FLAG(USERMSR, "usermsr", "__USERMSR__", 0),
+    FLAG(APXF, "apxf", "__APX_F__", 0),
+    FLAG(XSAVEOPT, "xsaveopt", "__XSAVEOPT__", 0),
+    FLAG(XSAVEC, "xsavec", "__XSAVEC__", 0),
+    FLAG(XSAVES, "xsaves", "__XSAVES__", 0),
+    FLAG(PTWRITE, "ptwrite", "__PTWRITE__", 0),
+    FLAG(WIDEKL, "widekl", "__WIDEKL__", 0),
+    FLAG(AMXFP8, "amx-fp8", "__AMX_FP8__", 0),
+    FLAG(AMX_TRANSPOSE, "amx-transpose", "__AMX_TRANSPOSE__", 0),
+    FLAG(AMX_TF32, "amx-tf32", "__AMX_TF32__", 0),
+    FLAG(AMX_AVX512, "amx-avx512", "__AMX_AVX512__", 0),
+    FLAG(AMX_MOVRS, "amx-movrs", "__AMX_MOVRS__", 0),
+    FLAG(SSE4a, "sse4a", "__SSE4A__", 0),
+    FLAG(PRFCHW, "prfchw", "__PRFCHW__", 0),
+    FLAG(XOP, "xop", "__XOP__", 0),
+    FLAG(LWP, "lwp", "__LWP__", 0),
+    FLAG(FMA4, "fma4", "__FMA4__", 0),
+    FLAG(TBM, "tbm", "__TBM__", 0),
+    FLAG(MWAITX, "mwaitx", "__MWAITX__", 0),
+    FLAG(CLZERO, "clzero", "__CLZERO__", 0),
+    FLAG(RDPRU, "rdpru", "__RDPRU__", 0),
+    FLAG(WBNOINVD, "wbnoinvd", "__WBNOINVD__", 0),
+};
+
+#undef FLAG
+
+/**
+ * @brief Intel family 6 model numbers and their GCC/Clang \p -mtune names.
+ */
+static const struct {
+    uint32_t model;
+    const char* name;
+} intel_models[] = {
+    {0x1a, "nehalem"}, {0x1e, "nehalem"}, {0x1f, "nehalem"}, {0x2e, "nehalem"},
+    {0x25, "westmere"}, {0x2c, "westmere"}, {0x2f, "westmere"},
+    {0x2a, "sandybridge"}, {0x2d, "sandybridge"}, {0x3a, "ivybridge"}, {0x3e, "ivybridge"},
+    {0x3c, "haswell"}, {0x3f, "haswell"}, {0x45, "haswell"}, {0x46, "haswell"},
+    {0x3d, "broadwell"}, {0x47, "broadwell"}, {0x4f, "broadwell"}, {0x56, "broadwell"},
+    {0x4e, "skylake"}, {0x5e, "skylake"}, {0x8e, "skylake"}, {0x9e, "skylake"}, {0xa5, "skylake"},
+    {0xa6, "skylake"}, {0x55, "skylake-avx512"}, {0x66, "cannonlake"},
+    {0x6a, "icelake-server"}, {0x6c, "icelake-server"}, {0x7d, "icelake-client"}, {0x7e, "icelake-client"},
+    {0x8c, "tigerlake"}, {0x8d, "tigerlake"}, {0xa7, "rocketlake"},
+    {0x97, "alderlake"}, {0x9a, "alderlake"}, {0xb7, "alderlake"}, {0xba, "alderlake"}, {0xbf, "alderlake"},
+    {0xaa, "meteorlake"}, {0xac, "meteorlake"}, {0xc5, "arrowlake"}, {0xc6, "arrowlake"},
+    {0xbd, "lunarlake"}, {0x8f, "sapphirerapids"}, {0xcf, "emeraldrapids"},
+    {0xad, "graniterapids"}, {0xae, "graniterapids"}, {0xaf, "sierraforest"}, {0xb6, "grandridge"},
+    {0x37, "silvermont"}, {0x4a, "silvermont"}, {0x4d, "silvermont"}, {0x5a, "silvermont"}, {0x5d, "silvermont"},
+    {0x5c, "goldmont"}, {0x5f, "goldmont"}, {0x7a, "goldmont-plus"},
+    {0x86, "tremont"}, {0x96, "tremont"}, {0x9c, "tremont"}, {0x57, "knl"}, {0x85, "knm"},
+};
+
+/**
+ * @brief Appends formatted text to a buffer, \p snprintf style.
+ */
+struct appender {
+    char* buffer; /**< The output buffer, may be null if \p size is 0 */
+    size_t size; /**< The size of the output buffer */
+    size_t length; /**< The length of the full output, even if truncated */
+};
+
+static void append(struct appender* out, const char* separator, const char* prefix, const char* text) {
+    const char* parts[] = {out->length ? separator : "", prefix, text};
+
+    for (size_t i = 0; i < sizeof(parts) / sizeof(parts[0]); ++i) {
+        for (const char* c = parts[i]; *c; ++c, ++out->length) {
+            if (out->length + 1 < out->size) out->buffer[out->length] = *c;
+        }
+    }
+    if (out->size) out->buffer[out->length < out->size ? out->length : out->size - 1] = '\0';
+}
+
+static int lower(const int c) {
+    return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+static bool equals_ignore_case(const char* a, const char* b, const size_t b_length) {
+    size_t i = 0;
+    for (; i < b_length && a[i]; ++i) {
+        if (lower((unsigned char) a[i]) != lower((unsigned char) b[i])) return false;
+    }
+    return i == b_length && a[i] == '\0';
+}
+
+/**
+ * Function to get the name of a feature.
+ *
+ * @param index The index of the feature, in \p cpu_features declaration order.
+ * @return The name of the feature, or a null pointer if \p index is out of range.
+ */
+const char* cpuidx_feature_name(const size_t index) {
+    return index < CPUIDX_FEATURE_COUNT ? feature_names[index] : NULL;
+}
+
+/**
+ * Function to look up a feature by name, ignoring case.
+ *
+ * @param name The name of the feature, e.g. "AVX2".
+ * @return The index of the feature in \p cpu_features declaration order, or -1 if there is no such feature.
+ */
+int cpuidx_feature_index(const char* name) {
+    for (size_t i = 0; i < CPUIDX_FEATURE_COUNT; ++i) {
+        if (equals_ignore_case(feature_names[i], name, strlen(name))) return (int) i;
+    }
+    return -1;
+}
+
+/**
+ * Function to get the macro GCC and Clang predefine when the compilation target has a feature.
+ *
+ * MSVC only predefines \p __AVX__, \p __AVX2__ and the \p __AVX512*__ macros, and only under the matching
+ * \p /arch option; its other features have no macro.
+ *
+ * @param index The index of the feature, in \p cpu_features declaration order.
+ * @return The name of the macro, e.g. "__AVX2__", or a null pointer if the compilers define none for the feature.
+ */
+const char* cpuidx_feature_macro(const size_t index) {
+    for (size_t i = 0; i < sizeof(feature_flags) / sizeof(feature_flags[0]); ++i) {
+        if (feature_flags[i].offset == index * sizeof(bool)) return feature_flags[i].macro;
+    }
+    return NULL;
+}
+
+/**
+ * Function to get the x86-64 psABI micro-architecture level supported by a feature set.
+ *
+ * @param features A pointer to a \p cpu_features structure.
+ * @return The highest level (1 to 4) whose requirements are all met, or 0 if not even the baseline is.
+ */
+int get_x86_64_level(const cpu_features* features) {
+    if (!(features->LM && features->CMOV && features->CX8 && features->FPU && features->FXSR && features->MMX &&
+          features->SSE && features->SSE2))
+        return 0;
+
+    if (!(features->CMPXCHG16B && features->LAHF_LM && features->POPCNT && features->SSE3 && features->SSE41 &&
+          features->SSE42 && features->SSSE3))
+        return 1;
+
+    if (!(features->AVX && features->AVX2 && features->BMI && features->BMI2 && features->F16C && features->FMA &&
+          features->ABM && features->MOVBE && features->OSXSAVE))
+        return 2;
+
+    if (!(features->AVX512F && features->AVX512BW && features->AVX512CD && features->AVX512DQ &&
+          features->AVX512VL))
+        return 3;
+
+    return 4;
+}
+
+/**
+ * Function to get the feature set of a compiler target profile.
+ *
+ * @param profile The profile. \p CPUIDX_PROFILE_HOST detects the features of the running CPU.
+ * @param features A pointer to a \p cpu_features structure to store the features of the profile.
+ * @return 0 on success, or the non-zero result of \p get_cpu_features if detecting the host features failed.
+ */
+int cpuidx_profile_features(const enum cpuidx_profile profile, cpu_features* features) {
+    memset(features, 0, sizeof(*features));
+
+    if (profile == CPUIDX_PROFILE_HOST) {
+        cpu_basic_info basic_info;
+        return get_cpu_features(features, &basic_info);
+    }
+
+    features->LM = features->CMOV = features->CX8 = features->FPU = features->FXSR = features->MMX =
+                   features->SSE = features->SSE2 = true;
+
+    if (profile >= CPUIDX_PROFILE_X86_64_V2)
+        features->CMPXCHG16B = features->LAHF_LM = features->POPCNT = features->SSE3 = features->SSE41 =
+                               features->SSE42 = features->SSSE3 = true;
+
+    if (profile >= CPUIDX_PROFILE_X86_64_V3)
+        features->AVX = features->AVX2 = features->BMI = features->BMI2 = features->F16C = features->FMA =
+                        features->ABM = features->MOVBE = features->OSXSAVE = features->XSAVE = true;
+
+    if (profile >= CPUIDX_PROFILE_X86_64_V4)
+        features->AVX512F = features->AVX512BW = features->AVX512CD = features->AVX512DQ = features->AVX512VL = true;
+
+    return 0;
+}
+
+/**
+ * Function to parse a profile specification into a feature set.
+ *
+ * The specification is a list of tokens separated by commas, plus signs or spaces.
+ * Each token is either "host", an x86-64 level ("x86-64", "x86-64-v2", "x86-64-v3", "x86-64-v4"),
+ * or a feature name, and the resulting feature set is the union of all tokens, e.g. "x86-64-v3,AVX512VNNI".
+ *
+ * @param spec The profile specification.
+ * @param features A pointer to a \p cpu_features structure to store the features of the profile.
+ * @return 0 on success, -1 if a token is not recognized, or the non-zero result of \p get_cpu_features.
+ */
+int cpuidx_parse_profile(const char* spec, cpu_features* features) {
+    static const struct {
+        const char* name;
+        enum cpuidx_profile profile;
+    } profiles[] = {
+        {"host", CPUIDX_PROFILE_HOST}, {"x86-64", CPUIDX_PROFILE_X86_64_V1}, {"x86-64-v1", CPUIDX_PROFILE_X86_64_V1},
+        {"x86-64-v2", CPUIDX_PROFILE_X86_64_V2}, {"x86-64-v3", CPUIDX_PROFILE_X86_64_V3},
+        {"x86-64-v4", CPUIDX_PROFILE_X86_64_V4},
+    };
+
+    memset(features, 0, sizeof(*features));
+    bool* values = (bool*) features;
+
+    while (*spec) {
+        const size_t length = strcspn(spec, ",+ \t");
+        if (length) {
+            bool known = false;
+
+            for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]) && !known; ++i) {
+                if ((known = equals_ignore_case(profiles[i].name, spec, length))) {
+                    cpu_features token;
+                    const int result = cpuidx_profile_features(profiles[i].profile, &token);
+                    if (result) return result;
+
+                    const bool* token_values = (const bool*) &token;
+                    for (size_t j = 0; j < CPUIDX_FEATURE_COUNT; ++j) values[j] |= token_values[j];
+                }
+            }
+
+            for (size_t i = 0; i < CPUIDX_FEATURE_COUNT && !known; ++i) {
+                if ((known = equals_ignore_case(feature_names[i], spec, length))) values[i] = true;
+            }
+
+            if (!known) return -1;
+        }
+        spec += length;
+        if (*spec) ++spec;
+    }
+
+    return 0;
+}
+
+/**
+ * Function to get the GCC/Clang \p -mtune name of a CPU.
+ *
+ * @param basic_info A pointer to a \p cpu_basic_info structure of the CPU.
+ * @param features A pointer to a \p cpu_features structure of the CPU, used to tell apart models sharing a number.
+ * @return The name, or "generic" if the CPU is not recognized.
+ */
+const char* cpuidx_tune_name(const cpu_basic_info* basic_info, const cpu_features* features) {
+    const uint32_t family = basic_info->family;
+    const uint32_t model = basic_info->model;
+
+    if (strcmp(basic_info->vendor, "GenuineIntel") == 0 && family == 6) {
+        if (model == 0x55) {
+            if (features->AVX512BF16) return "cooperlake";
+            if (features->AVX512VNNI) return "cascadelake";
+        }
+        for (size_t i = 0; i < sizeof(intel_models) / sizeof(intel_models[0]); ++i) {
+            if (intel_models[i].model == model) return intel_models[i].name;
+        }
+    } else if (strcmp(basic_info->vendor, "AuthenticAMD") == 0 || strcmp(basic_info->vendor, "HygonGenuine") == 0) {
+        switch (family) {
+            case 0x10:
+                return "amdfam10";
+            case 0x14:
+                return "btver1";
+            case 0x15:
+                return model >= 0x60 ? "bdver4" : model >= 0x30 ? "bdver3" : model >= 0x10 ? "bdver2" : "bdver1";
+            case 0x16:
+                return model >= 0x30 ? "btver2" : "btver1";
+            case 0x17:
+            case 0x18:
+                return model >= 0x30 ? "znver2" : "znver1";
+            case 0x19:
+                return (model >= 0x10 && model <= 0x1f) || (model >= 0x60 && model <= 0xaf) ? "znver4" : "znver3";
+            case 0x1a:
+                return "znver5";
+            default:
+                break;
+        }
+    }
+    return "generic";
+}
+
+/**
+ * Function to format the GCC/Clang compiler flags targeting a feature set.
+ *
+ * The flags are \p -march set to the highest x86-64 level of the feature set, \p -mtune for the CPU if
+ * \p basic_info is provided and recognized, then one \p -m option per feature not implied by the level.
+ *
+ * @param features A pointer to a \p cpu_features structure of the target.
+ * @param basic_info A pointer to a \p cpu_basic_info structure of the target CPU, or a null pointer to omit \p -mtune.
+ * @param buffer The output buffer, always null-terminated if \p size is not 0.
+ * @param size The size of the output buffer.
+ * @return The length of the flags, excluding the null terminator. The output is truncated if it is \p size or more.
+ */
+size_t cpuidx_compiler_flags(const cpu_features* CPUIDX_RESTRICT features,
+                             const cpu_basic_info* CPUIDX_RESTRICT basic_info, char* CPUIDX_RESTRICT buffer,
+                             const size_t size) {
+    struct appender out = {buffer, size, 0};
+    if (size) buffer[0] = '\0';
+
+    static const char* const level_names[] = {"x86-64", "x86-64", "x86-64-v2", "x86-64-v3", "x86-64-v4"};
+    const int level = get_x86_64_level(features);
+    if (level) append(&out, " ", "-march=", level_names[level]);
+
+    if (basic_info) {
+        const char* tune = cpuidx_tune_name(basic_info, features);
+        if (strcmp(tune, "generic") != 0) append(&out, " ", "-mtune=", tune);
+    }
+
+    const char* values = (const char*) features;
+    for (size_t i = 0; i < sizeof(feature_flags) / sizeof(feature_flags[0]); ++i) {
+        const struct feature_flag* flag = &feature_flags[i];
+        if (*(const bool*) (values + flag->offset) && (!flag->level || flag->level > level))
+            append(&out, " ", "-m", flag->option);
+    }
+
+    return out.length;
+}
+
+/**
+ * Function to format a GCC/Clang \p target_clones attribute list for a feature set.
+ *
+ * The list holds one \p arch=x86-64-vN clone per level from the highest level of the feature set down to
+ * x86-64-v2, followed by \p default, e.g. "arch=x86-64-v3,arch=x86-64-v2,default".
+ *
+ * @param features A pointer to a \p cpu_features structure of the target.
+ * @param buffer The output buffer, always null-terminated if \p size is not 0.
+ * @param size The size of the output buffer.
+ * @return The length of the list, excluding the null terminator. The output is truncated if it is \p size or more.
+ */
+size_t cpuidx_target_clones(const cpu_features* CPUIDX_RESTRICT features, char* CPUIDX_RESTRICT buffer,
+                            const size_t size) {
+    static const char* const level_names[] = {"", "", "x86-64-v2", "x86-64-v3", "x86-64-v4"};
+    struct appender out = {buffer, size, 0};
+    if (size) buffer[0] = '\0';
+
+    for (int level = get_x86_64_level(features); level >= 2; --level) append(&out, ",", "arch=", level_names[level]);
+    append(&out, ",", "", "default");
+
+    return out.length;
+}
+
+/**
+ * Function to select the most specialized of several feature sets that a host supports, e.g. builds of a program.
+ *
+ * A candidate is supported if the host has every feature it requires. Among those, the one requiring the most
+ * features is taken, as the build using the most of the host, and the first one on ties.
+ *
+ * @param host A pointer to the features of the host, e.g. from \p cpuidx_verified_features.
+ * @param candidates The features each candidate requires, e.g. from \p cpuidx_parse_profile.
+ * @param count The number of candidates.
+ * @return The index of the selected candidate, or -1 if the host supports none.
+ */
+int cpuidx_select_variant(const cpu_features* host, const cpu_features* candidates, const size_t count) {
+    const bool* host_values = (const bool*) host;
+    size_t best_count = 0;
+    int best = -1;
+
+    for (size_t i = 0; i < count; ++i) {
+        const bool* values = (const bool*) &candidates[i];
+        size_t required = 0;
+        bool supported = true;
+
+        for (size_t j = 0; j < CPUIDX_FEATURE_COUNT && supported; ++j) {
+            supported = !values[j] || host_values[j];
+            required += values[j];
+        }
+        if (supported && (best < 0 || required > best_count)) {
+            best = (int) i;
+            best_count = required;
+        }
+    }
+
+    return best;
+}
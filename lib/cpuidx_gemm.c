@@ -0,0 +1,239 @@
+#include "cpuidx_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <malloc.h>
+#define ALIGNED_ALLOC(alignment, size) _aligned_malloc((size), (alignment))
+#define ALIGNED_FREE(memory) _aligned_free(memory)
+#else
+#define ALIGNED_ALLOC(alignment, size) aligned_alloc((alignment), (size))
+#define ALIGNED_FREE(memory) free(memory)
+#endif
+
+// Caches assumed when CPUID does not enumerate them
+#define DEFAULT_L1_SIZE (32 * 1024)
+#define DEFAULT_L1_WAYS 8
+#define DEFAULT_L1_LINE 64
+#define DEFAULT_L2_SIZE (256 * 1024)
+
+// Wider panels of B do not amortize the packing further, and would take the L3 share of other cores
+#define MAX_NC 8192
+
+// Largest register tile of the recommendations, for the accumulators of the reference micro-kernel
+#define MAX_MR 32
+#define MAX_NR 64
+
+// An AMX tile holds 16 rows of 64 bytes: 16 x 16 FP32 results, or 16 x 32 BF16 inputs
+#define AMX_TILE_ROWS 16
+#define AMX_TILE_BF16_K 32
+
+static size_t round_down(const size_t value, const size_t multiple) {
+    return value / multiple * multiple;
+}
+
+/**
+ * Function to recommend the blocking of a Goto-style GEMM, C += A * B, for an element type and a CPU.
+ *
+ * The register tile (MR x NR) fills the vector registers with accumulators: MR rows broadcast from A,
+ * times NR columns of two vectors loaded from B. With AMX BF16, it is 2 x 2 tiles of 16 x 16.
+ * Without AMX, BF16 pairs are multiplied by VDPBF16PS with AVX512BF16, and are otherwise widened to FP32 when
+ * packed, doubling the size of the packed blocks.
+ * The cache blocks follow the analytical model of Low et al. (2016):
+ * a KC x NR micro-panel of B stays in L1 next to the streamed micro-panels of A, an MC x KC block of A takes
+ * half of L2, and a KC x NC panel of B half of L3, or of L2 without L3, up to 8192 columns.
+ *
+ * @param type The element type of A and B.
+ * @param features A pointer to the target features, e.g. from \p cpuidx_cached_features.
+ * @param caches A pointer to the cache geometry, or a null pointer for the caches of the host.
+ * @param blocking A pointer to a \p cpuidx_gemm_blocking structure to store the recommendation.
+ * @return 0 on success, -1 if \p type is invalid.
+ */
+int cpuidx_recommend_gemm_blocking(const enum cpuidx_gemm_type type, const cpu_features* CPUIDX_RESTRICT features,
+                                   const cpuidx_cache_info* CPUIDX_RESTRICT caches,
+                                   cpuidx_gemm_blocking* CPUIDX_RESTRICT blocking) {
+    static const uint32_t element_sizes[] = {4, 8, 2};
+    cpuidx_cache_info detected;
+
+    if ((unsigned) type >= sizeof(element_sizes) / sizeof(element_sizes[0])) return -1;
+
+    if (!caches) {
+        cpuidx_get_cache_info(&detected);
+        caches = &detected;
+    }
+
+    memset(blocking, 0, sizeof(*blocking));
+
+    uint32_t element_size = element_sizes[type];
+    const cpuidx_cache_level* l1 = &caches->levels[0];
+    const cpuidx_cache_level* l2 = &caches->levels[1];
+    const cpuidx_cache_level* l3 = &caches->levels[2];
+
+    blocking->width = features->AVX512F ? CPUIDX_WIDTH_512 : features->AVX ? CPUIDX_WIDTH_256 : CPUIDX_WIDTH_128;
+    blocking->amx = type == CPUIDX_GEMM_BF16 && features->AMXTILE && features->AMXBF16;
+    blocking->fma = features->FMA || features->AVX512F;
+    blocking->bf16_dot = type == CPUIDX_GEMM_BF16 && !blocking->amx && features->AVX512BF16;
+    if (type == CPUIDX_GEMM_BF16 && !blocking->amx && !blocking->bf16_dot) element_size = 4;
+
+    if (blocking->amx) {
+        blocking->mr = 2 * AMX_TILE_ROWS;
+        blocking->nr = 2 * AMX_TILE_ROWS;
+    } else {
+        // Accumulators are FP32 for BF16, which is multiplied in pairs (VDPBF16PS)
+        const uint32_t lanes = (16u << blocking->width) / (type == CPUIDX_GEMM_F64 ? 8 : 4);
+        const uint32_t registers = features->AVX512F ? 32 : 16;
+
+        // Keep 4 registers for the loads of B and the broadcasts of A
+        blocking->nr = 2 * lanes;
+        blocking->mr = (registers - 4) / 2;
+    }
+
+    // A B micro-panel shares L1 with the A micro-panels: ways for A = (W - 1) / (1 + NR / MR)
+    const uint32_t l1_ways = l1->ways ? l1->ways : DEFAULT_L1_WAYS;
+    const uint32_t l1_line = l1->line_size ? l1->line_size : DEFAULT_L1_LINE;
+    const uint32_t l1_sets = l1->sets ? l1->sets : DEFAULT_L1_SIZE / (DEFAULT_L1_WAYS * DEFAULT_L1_LINE);
+    uint32_t ways_a = (l1_ways - 1) * blocking->mr / (blocking->mr + blocking->nr);
+    if (!ways_a) ways_a = 1;
+
+    const size_t kc_multiple = blocking->amx ? AMX_TILE_BF16_K : 8;
+    size_t kc = round_down((size_t) ways_a * l1_sets * l1_line / ((size_t) blocking->mr * element_size), kc_multiple);
+    if (kc < kc_multiple) kc = kc_multiple;
+
+    const size_t l2_size = l2->size ? l2->size : DEFAULT_L2_SIZE;
+    size_t mc = round_down(l2_size / 2 / (kc * element_size), blocking->mr);
+    if (mc < blocking->mr) mc = blocking->mr;
+
+    const size_t nc_cache = l3->size ? l3->size / 2 : l2_size;
+    size_t nc = round_down(nc_cache / (kc * element_size), blocking->nr);
+    if (nc > MAX_NC) nc = round_down(MAX_NC, blocking->nr);
+    if (nc < blocking->nr) nc = blocking->nr;
+
+    blocking->kc = (uint32_t) kc;
+    blocking->mc = (uint32_t) mc;
+    blocking->nc = (uint32_t) nc;
+    return 0;
+}
+
+/**
+ * Function to pack rows of A into micro-panels of MR rows, column-major within each panel, zero-padded.
+ */
+static void pack_a(const float* a, const size_t lda, const size_t rows, const size_t depth, const size_t mr,
+                   float* packed) {
+    for (size_t panel = 0; panel < rows; panel += mr) {
+        for (size_t p = 0; p < depth; ++p) {
+            for (size_t i = 0; i < mr; ++i) *packed++ = panel + i < rows ? a[(panel + i) * lda + p] : 0;
+        }
+    }
+}
+
+/**
+ * Function to pack columns of B into micro-panels of NR columns, row-major within each panel, zero-padded.
+ */
+static void pack_b(const float* b, const size_t ldb, const size_t depth, const size_t columns, const size_t nr,
+                   float* packed) {
+    for (size_t panel = 0; panel < columns; panel += nr) {
+        for (size_t p = 0; p < depth; ++p) {
+            for (size_t j = 0; j < nr; ++j) *packed++ = panel + j < columns ? b[p * ldb + panel + j] : 0;
+        }
+    }
+}
+
+/**
+ * Function to compute C[rows x columns] += alpha * A * B from packed micro-panels, as an MR x NR register tile.
+ */
+static void micro_kernel(const float* CPUIDX_RESTRICT a, const float* CPUIDX_RESTRICT b, const size_t depth,
+                         const size_t mr, const size_t nr, const float alpha, float* CPUIDX_RESTRICT c,
+                         const size_t ldc, const size_t rows, const size_t columns) {
+    float accumulators[MAX_MR * MAX_NR];
+
+    // Only the MR x NR tile, which is often much smaller than the largest one
+    memset(accumulators, 0, mr * nr * sizeof(float));
+
+    for (size_t p = 0; p < depth; ++p, a += mr, b += nr) {
+        for (size_t i = 0; i < mr; ++i) {
+            const float broadcast = a[i];
+            for (size_t j = 0; j < nr; ++j) accumulators[i * nr + j] += broadcast * b[j];
+        }
+    }
+
+    for (size_t i = 0; i < rows; ++i) {
+        for (size_t j = 0; j < columns; ++j) c[i * ldc + j] += alpha * accumulators[i * nr + j];
+    }
+}
+
+/**
+ * Function to compute C = alpha * A * B + beta * C in single precision, with the loops and packing of a
+ * Goto-style GEMM blocked as recommended by \p cpuidx_recommend_gemm_blocking.
+ *
+ * The micro-kernel is portable C, a reference for the blocking and for optimized kernels rather than
+ * a replacement for a BLAS. The matrices are row-major.
+ *
+ * @param blocking A pointer to the blocking. MR up to 32 and NR up to 64 are supported.
+ * @param m The number of rows of A and C.
+ * @param n The number of columns of B and C.
+ * @param k The number of columns of A and rows of B.
+ * @param alpha The scale of A * B.
+ * @param a A pointer to A.
+ * @param lda The distance between rows of A, in elements.
+ * @param b A pointer to B.
+ * @param ldb The distance between rows of B, in elements.
+ * @param beta The scale of C. If 0, C is not read.
+ * @param c A pointer to C.
+ * @param ldc The distance between rows of C, in elements.
+ * @return 0 on success, -1 if the blocking is invalid or the packing buffers cannot be allocated.
+ */
+int cpuidx_sgemm(const cpuidx_gemm_blocking* CPUIDX_RESTRICT blocking, const size_t m, const size_t n,
+                 const size_t k, const float alpha, const float* CPUIDX_RESTRICT a, const size_t lda,
+                 const float* CPUIDX_RESTRICT b, const size_t ldb, const float beta, float* CPUIDX_RESTRICT c,
+                 const size_t ldc) {
+    const size_t mr = blocking->mr, nr = blocking->nr, kc = blocking->kc, mc = blocking->mc, nc = blocking->nc;
+
+    if (!mr || mr > MAX_MR || !nr || nr > MAX_NR || !kc || mc < mr || nc < nr) return -1;
+
+    for (size_t i = 0; i < m; ++i) {
+        for (size_t j = 0; j < n; ++j) c[i * ldc + j] = beta == 0 ? 0 : beta * c[i * ldc + j];
+    }
+    if (!k || alpha == 0) return 0;
+
+    // Blocks rounded up to whole micro-panels, in bytes multiple of 64 for aligned_alloc
+    const size_t packed_a_size = ((mc + mr - 1) / mr * mr * kc * sizeof(float) + 63) / 64 * 64;
+    const size_t packed_b_size = ((nc + nr - 1) / nr * nr * kc * sizeof(float) + 63) / 64 * 64;
+    float* packed_a = ALIGNED_ALLOC(64, packed_a_size);
+    float* packed_b = ALIGNED_ALLOC(64, packed_b_size);
+
+    if (!packed_a || !packed_b) {
+        ALIGNED_FREE(packed_a);
+        ALIGNED_FREE(packed_b);
+        return -1;
+    }
+
+    for (size_t jc = 0; jc < n; jc += nc) {
+        const size_t columns = n - jc < nc ? n - jc : nc;
+
+        for (size_t pc = 0; pc < k; pc += kc) {
+            const size_t depth = k - pc < kc ? k - pc : kc;
+
+            // The panel of B lives in L3, each of its micro-panels in L1
+            pack_b(b + pc * ldb + jc, ldb, depth, columns, nr, packed_b);
+
+            for (size_t ic = 0; ic < m; ic += mc) {
+                const size_t rows = m - ic < mc ? m - ic : mc;
+
+                // The block of A lives in L2
+                pack_a(a + ic * lda + pc, lda, rows, depth, mr, packed_a);
+
+                for (size_t jr = 0; jr < columns; jr += nr) {
+                    for (size_t ir = 0; ir < rows; ir += mr) {
+                        micro_kernel(packed_a + ir * depth, packed_b + jr * depth, depth, mr, nr, alpha,
+                                     c + (ic + ir) * ldc + jc + jr, ldc, rows - ir < mr ? rows - ir : mr,
+                                     columns - jr < nr ? columns - jr : nr);
+                    }
+                }
+            }
+        }
+    }
+
+    ALIGNED_FREE(packed_a);
+    ALIGNED_FREE(packed_b);
+    return 0;
+}
@@ -0,0 +1,165 @@
+#pragma once
+#ifndef CPUIDX_IFUNC_H
+#define CPUIDX_IFUNC_H
+
+// Self-contained feature queries, safe to use where the library is not: in GNU ifunc resolvers,
+// which run before relocations are processed, and in early constructors.
+// Everything here is inline, and touches no global data and no library functions.
+
+#include "cpuidx.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+#include <cpuid.h>
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+#ifdef CPUIDX_LANG_CPP
+extern "C" {
+#endif
+
+/**
+ * Executes the CPUID instruction.
+ *
+ * @param leaf The CPUID leaf to query.
+ * @param sub_leaf The CPUID sub-leaf to query.
+ * @param registers An array to store the values of the registers EAX, EBX, ECX, and EDX.
+ */
+static inline void cpuidx_ifunc_cpuid(const uint32_t leaf, const uint32_t sub_leaf, uint32_t registers[4]) {
+#if defined(__GNUC__) || defined(__clang__)
+    __cpuid_count(leaf, sub_leaf, registers[0], registers[1], registers[2], registers[3]);
+#elif defined(_MSC_VER)
+    __cpuidex((int*) registers, (int) leaf, (int) sub_leaf);
+#endif
+}
+
+/**
+ * Reads the XCR0 register, the state components enabled by the OS.
+ *
+ * @return The value of XCR0, or 0 if the OS has not enabled the XGETBV instruction.
+ */
+static inline uint64_t cpuidx_ifunc_xcr0(void) {
+    uint32_t registers[4];
+    cpuidx_ifunc_cpuid(1, 0, registers);
+    if (!(registers[2] & b_OSXSAVE)) return 0;
+
+#if defined(__GNUC__) || defined(__clang__)
+    uint32_t eax, edx;
+    __asm__ volatile ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+    return (uint64_t) edx << 32 | eax;
+#elif defined(_MSC_VER)
+    return _xgetbv(0);
+#endif
+}
+
+/**
+ * Gets the state components the process may use: XCR0, less the dynamically enabled ones it has no permission for.
+ *
+ * On Linux, the AMX tile data is disabled through XFD (Extended Feature Disable) until the process requests the
+ * permission with arch_prctl(ARCH_REQ_XCOMP_PERM), and the first AMX instruction would raise SIGILL until then.
+ *
+ * @return The usable XCR0 bits, or 0 if the OS has not enabled the XGETBV instruction.
+ */
+static inline uint64_t cpuidx_ifunc_usable_xcr0(void) {
+    uint64_t xcr0 = cpuidx_ifunc_xcr0();
+
+#if defined(__linux__) && defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    // arch_prctl(ARCH_GET_XCOMP_PERM, &permitted) as a raw system call, libc may not be relocated yet.
+    // Kernels older than 5.16 fail it, and enable no dynamic state either
+    uint64_t permitted = 0;
+    long result;
+    __asm__ volatile ("syscall" : "=a" (result) : "a" (158), "D" (0x1022), "S" (&permitted) : "rcx", "r11", "memory");
+    if (result == 0) xcr0 &= permitted;
+#endif
+
+    return xcr0;
+}
+
+/**
+ * Gets the state components a feature needs the OS to enable in XCR0.
+ *
+ * @param feature The feature.
+ * @return The XCR0 bits the feature needs, 0 if it needs none.
+ */
+static inline uint64_t cpuidx_ifunc_required_xcr0(const enum cpuidx_feature feature) {
+    switch (feature) {
+        case CPUIDX_FEATURE_AVX: case CPUIDX_FEATURE_FMA: case CPUIDX_FEATURE_F16C: case CPUIDX_FEATURE_AVX2:
+        case CPUIDX_FEATURE_VAES: case CPUIDX_FEATURE_VPCLMULQDQ: case CPUIDX_FEATURE_AVXVNNI:
+        case CPUIDX_FEATURE_AVXIFMA: case CPUIDX_FEATURE_AVXVNNIINT8: case CPUIDX_FEATURE_AVXNECONVERT:
+        case CPUIDX_FEATURE_AVXVNNIINT16: case CPUIDX_FEATURE_SHA512: case CPUIDX_FEATURE_SM3:
+        case CPUIDX_FEATURE_SM4: case CPUIDX_FEATURE_XOP: case CPUIDX_FEATURE_FMA4:
+            return 0x6; // SSE, AVX
+
+        case CPUIDX_FEATURE_AVX512F: case CPUIDX_FEATURE_AVX512DQ: case CPUIDX_FEATURE_AVX512IFMA:
+        case CPUIDX_FEATURE_AVX512PF: case CPUIDX_FEATURE_AVX512ER: case CPUIDX_FEATURE_AVX512CD:
+        case CPUIDX_FEATURE_AVX512BW: case CPUIDX_FEATURE_AVX512VL: case CPUIDX_FEATURE_AVX512VBMI:
+        case CPUIDX_FEATURE_AVX512VBMI2: case CPUIDX_FEATURE_AVX512VNNI: case CPUIDX_FEATURE_AVX512BITALG:
+        case CPUIDX_FEATURE_AVX512VPOPCNTDQ: case CPUIDX_FEATURE_AVX5124VNNIW: case CPUIDX_FEATURE_AVX5124FMAPS:
+        case CPUIDX_FEATURE_AVX512VP2INTERSECT: case CPUIDX_FEATURE_AVX512FP16: case CPUIDX_FEATURE_AVX512BF16:
+        case CPUIDX_FEATURE_AVX10: case CPUIDX_FEATURE_AVX10_256: case CPUIDX_FEATURE_AVX10_512:
+            return 0xe6; // SSE, AVX, opmask, ZMM_Hi256, Hi16_ZMM
+
+        case CPUIDX_FEATURE_AMXTILE: case CPUIDX_FEATURE_AMXBF16: case CPUIDX_FEATURE_AMXINT8:
+        case CPUIDX_FEATURE_AMXFP16: case CPUIDX_FEATURE_AMXCOMPLEX: case CPUIDX_FEATURE_AMXFP8:
+        case CPUIDX_FEATURE_AMX_TRANSPOSE: case CPUIDX_FEATURE_AMX_TF32: case CPUIDX_FEATURE_AMX_MOVRS:
+            return 0x60000; // XTILECFG, XTILEDATA
+
+        case CPUIDX_FEATURE_AMX_AVX512:
+            return 0x600e6;
+
+        case CPUIDX_FEATURE_APXF:
+            return 0x80000; // APX extended GPRs
+
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Checks whether the CPU supports a feature, and the OS enabled the state it needs for the process,
+ * like \p __builtin_cpu_supports but covering every feature of \p cpu_features.
+ * AMX is reported once the process has the permission for the tile data, see \p cpuidx_ifunc_usable_xcr0.
+ *
+ * @param feature The feature.
+ * @return true if the feature is usable.
+ */
+static inline bool cpuidx_ifunc_supports(const enum cpuidx_feature feature) {
+    uint32_t leaf, sub_leaf, reg, mask;
+
+    switch (feature) {
+#define CPUIDX_X_CASE(field, name, l, s, r, m) \
+        case CPUIDX_FEATURE_##field: leaf = l; sub_leaf = s; reg = r; mask = m; break;
+        CPUIDX_FEATURES(CPUIDX_X_CASE)
+#undef CPUIDX_X_CASE
+        default:
+            return false;
+    }
+
+    uint32_t registers[4];
+
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(__x86_64__)
+    // 32-bit CPUs may lack the CPUID instruction
+    if (!__get_cpuid_max(0, NULL)) return false;
+#endif
+
+    cpuidx_ifunc_cpuid(leaf & 0x80000000, 0, registers);
+    if (registers[0] < leaf) return false;
+
+    if (leaf == 7 && sub_leaf) {
+        cpuidx_ifunc_cpuid(7, 0, registers);
+        if (registers[0] < sub_leaf) return false;
+    }
+
+    cpuidx_ifunc_cpuid(leaf, sub_leaf, registers);
+    if (!(registers[reg] & mask)) return false;
+
+    const uint64_t xcr0 = cpuidx_ifunc_required_xcr0(feature);
+    return (cpuidx_ifunc_usable_xcr0() & xcr0) == xcr0;
+}
+
+#ifdef CPUIDX_LANG_CPP
+}
+#endif
+
+#endif // CPUIDX_IFUNC_H
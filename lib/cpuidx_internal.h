@@ -0,0 +1,57 @@
+#pragma once
+#ifndef CPUIDX_INTERNAL_H
+#define CPUIDX_INTERNAL_H
+
+// Helpers shared by the library sources. Not installed.
+
+#include "cpuidx.h"
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+
+// MSVC on x86 gives volatile accesses acquire/release semantics
+#define CPUIDX_LOAD_ACQUIRE(ptr) (*(volatile long*) (ptr))
+#define CPUIDX_STORE_RELEASE(ptr, value) (*(volatile long*) (ptr) = (value))
+#define CPUIDX_EXCHANGE(ptr, value) _InterlockedExchange((volatile long*) (ptr), (value))
+#define CPUIDX_PAUSE() _mm_pause()
+#define CPUIDX_RDTSC() __rdtsc()
+#else
+#define CPUIDX_LOAD_ACQUIRE(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define CPUIDX_STORE_RELEASE(ptr, value) __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+#define CPUIDX_EXCHANGE(ptr, value) __atomic_exchange_n((ptr), (value), __ATOMIC_ACQ_REL)
+#define CPUIDX_PAUSE() __builtin_ia32_pause()
+#define CPUIDX_RDTSC() __builtin_ia32_rdtsc()
+#endif
+
+uint64_t cpuidx_monotonic_ns(void);
+
+uint64_t cpuidx_tsc_frequency(void);
+
+int cpuidx_pin_thread(int cpu);
+
+void cpuidx_unpin_thread(void);
+
+int cpuidx_read_msr(int cpu, uint32_t msr, uint64_t* value);
+
+int cpuidx_read_file(const char* CPUIDX_RESTRICT path, char* CPUIDX_RESTRICT buffer, size_t size);
+
+uint32_t cpuidx_microcode_revision(void);
+
+void cpuidx_classify_isa_timings(cpuidx_isa_timings* timings);
+
+int cpuidx_detect_cache_info(const cpu_basic_info* basic_info, cpuidx_cache_info* info);
+
+int cpuidx_snapshot_features(cpu_features* CPUIDX_RESTRICT features, cpu_basic_info* CPUIDX_RESTRICT basic_info);
+
+int cpuidx_snapshot_verified_features(cpu_features* features);
+
+int cpuidx_self_test_features(const cpu_features* CPUIDX_RESTRICT features,
+                              cpuidx_self_test_report* CPUIDX_RESTRICT report);
+
+int cpuidx_snapshot_caches(cpuidx_cache_info* caches);
+
+int cpuidx_amx_permitted(void);
+
+size_t cpuidx_snapshot_topology(cpuidx_cpu_topology* cpus, size_t count);
+
+#endif // CPUIDX_INTERNAL_H
@@ -0,0 +1,179 @@
+#include "cpuidx_internal.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* const benchmark_names[CPUIDX_ISA_BENCHMARK_COUNT] = {
+    "PDEP", "PEXT", "VPGATHERDD", "VPERMB", "VPCOMPRESSD", "REP_MOVSB", "CLFLUSHOPT", "CLWB", "PAUSE",
+};
+
+/**
+ * @brief An output buffer with \p snprintf semantics.
+ */
+struct printer {
+    char* buffer; /**< The output buffer, may be null if \p size is 0 */
+    size_t size; /**< The size of the output buffer */
+    size_t length; /**< The length of the full output, even if truncated */
+};
+
+static void print(struct printer* out, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    const int length = vsnprintf(out->length < out->size ? out->buffer + out->length : NULL,
+                                 out->length < out->size ? out->size - out->length : 0, format, args);
+    va_end(args);
+    if (length > 0) out->length += (size_t) length;
+}
+
+// Cycles are written with two decimals by hand, independently of the locale
+static void print_cycles(struct printer* out, const double cycles) {
+    const unsigned long hundredths = (unsigned long) (cycles * 100 + 0.5);
+    print(out, " %lu.%02lu", hundredths / 100, hundredths % 100);
+}
+
+static const char* parse_cycles(const char* text, double* cycles) {
+    char* end;
+    const unsigned long units = strtoul(text, &end, 10);
+    if (end == text) return NULL;
+
+    *cycles = (double) units;
+    if (*end == '.') {
+        double scale = 0.1;
+        for (++end; *end >= '0' && *end <= '9'; ++end, scale /= 10) *cycles += (*end - '0') * scale;
+    }
+    return end;
+}
+
+/**
+ * Function to set the flags of ISA timings from the measurements.
+ *
+ * @param timings A pointer to the \p cpuidx_isa_timings structure.
+ */
+void cpuidx_classify_isa_timings(cpuidx_isa_timings* timings) {
+    timings->slow_pdep_pext = timings->latency[CPUIDX_ISA_PDEP] > 8 || timings->latency[CPUIDX_ISA_PEXT] > 8;
+    timings->slow_gather = timings->throughput[CPUIDX_ISA_VPGATHERDD] > 16;
+    timings->slow_compress_store = timings->throughput[CPUIDX_ISA_VPCOMPRESSD] > 16;
+    timings->slow_short_rep_movsb = timings->throughput[CPUIDX_ISA_REP_MOVSB] > 24;
+}
+
+/**
+ * Function to get the name of an ISA benchmark.
+ *
+ * @param benchmark The benchmark.
+ * @return The name of the benchmark, e.g. "PEXT", or a null pointer if \p benchmark is out of range.
+ */
+const char* cpuidx_isa_benchmark_name(const unsigned benchmark) {
+    return benchmark < CPUIDX_ISA_BENCHMARK_COUNT ? benchmark_names[benchmark] : NULL;
+}
+
+/**
+ * Function to write ISA timings as text, to cache them.
+ *
+ * The text has a line per benchmark with its name, latency and throughput in cycles, 0 if not measured,
+ * after the signature, the brand name and the microcode revision of the CPU.
+ *
+ * @param timings A pointer to the \p cpuidx_isa_timings structure to write.
+ * @param buffer The buffer to write to, may be null if \p size is 0.
+ * @param size The size of the buffer. The output is truncated to fit, and always null-terminated.
+ * @return The length of the full text, excluding the null terminator, as \p snprintf.
+ */
+size_t cpuidx_format_isa_timings(const cpuidx_isa_timings* CPUIDX_RESTRICT timings, char* CPUIDX_RESTRICT buffer,
+                                 const size_t size) {
+    struct printer out = {buffer, size, 0};
+
+    if (size) buffer[0] = '\0';
+
+    print(&out, "# cpuidx ISA timings, in core cycles\n");
+    print(&out, "signature 0x%08lx\n", (unsigned long) timings->signature);
+    print(&out, "brand %s\n", timings->brand);
+    print(&out, "microcode 0x%08lx\n", (unsigned long) timings->microcode);
+    print(&out, "# benchmark latency throughput\n");
+
+    for (int i = 0; i < CPUIDX_ISA_BENCHMARK_COUNT; ++i) {
+        print(&out, "%s", benchmark_names[i]);
+        print_cycles(&out, timings->latency[i]);
+        print_cycles(&out, timings->throughput[i]);
+        print(&out, "\n");
+    }
+
+    return out.length;
+}
+
+/**
+ * Function to read ISA timings written by \p cpuidx_format_isa_timings.
+ *
+ * Unknown benchmarks are skipped, and missing ones are left unmeasured.
+ *
+ * @param text The text to read.
+ * @param timings A pointer to a \p cpuidx_isa_timings structure to store the timings.
+ * @return 0 on success, -1 if the text is malformed or has no signature.
+ */
+int cpuidx_parse_isa_timings(const char* CPUIDX_RESTRICT text, cpuidx_isa_timings* CPUIDX_RESTRICT timings) {
+    bool signed_text = false;
+
+    memset(timings, 0, sizeof(*timings));
+
+    for (const char* line = text; *line; line += strcspn(line, "\n"), line += *line == '\n') {
+        const size_t length = strcspn(line, "\n");
+
+        if (length == 0 || line[0] == '#') continue;
+
+        if (strncmp(line, "signature ", 10) == 0) {
+            timings->signature = (uint32_t) strtoul(line + 10, NULL, 16);
+            signed_text = true;
+        } else if (strncmp(line, "brand ", 6) == 0) {
+            const size_t brand_length = length - 6 < sizeof(timings->brand) ? length - 6 : sizeof(timings->brand) - 1;
+            memcpy(timings->brand, line + 6, brand_length);
+            timings->brand[brand_length] = '\0';
+        } else if (strncmp(line, "microcode ", 10) == 0) {
+            timings->microcode = (uint32_t) strtoul(line + 10, NULL, 16);
+        } else {
+            const size_t name_length = strcspn(line, " \n");
+            double latency, throughput;
+            const char* values = parse_cycles(line + name_length, &latency);
+
+            if (!values || !parse_cycles(values, &throughput)) return -1;
+
+            for (int i = 0; i < CPUIDX_ISA_BENCHMARK_COUNT; ++i) {
+                if (strlen(benchmark_names[i]) == name_length && strncmp(line, benchmark_names[i], name_length) == 0) {
+                    timings->latency[i] = latency;
+                    timings->throughput[i] = throughput;
+                }
+            }
+        }
+    }
+
+    if (!signed_text) return -1;
+
+    cpuidx_classify_isa_timings(timings);
+    return 0;
+}
+
+/**
+ * Function to load cached ISA timings, if they were measured on the same kind of CPU, with the same microcode:
+ * microcode updates change the speed of instructions, e.g. the gather mitigation.
+ *
+ * \code
+ * if (cpuidx_load_isa_timings(path, &timings) != 0) cpuidx_measure_isa(&timings);
+ * pext = timings.slow_pdep_pext ? pext_table : pext_bmi2;
+ * \endcode
+ *
+ * @param path The path of a file written with \p cpuidx_format_isa_timings, e.g. by \p cpuidz --measure-isa.
+ * @param timings A pointer to a \p cpuidx_isa_timings structure to store the timings.
+ * @return 0 on success, -1 if the file is unreadable or malformed, -2 if it comes from a different CPU
+ *         signature, brand or microcode revision.
+ */
+int cpuidx_load_isa_timings(const char* CPUIDX_RESTRICT path, cpuidx_isa_timings* CPUIDX_RESTRICT timings) {
+    char text[2048];
+
+    if (cpuidx_read_file(path, text, sizeof(text)) != 0 || cpuidx_parse_isa_timings(text, timings) != 0) return -1;
+
+    uint32_t registers[4] = {0};
+    cpuid(1, registers);
+
+    if (timings->signature != registers[0] || strcmp(timings->brand, cpuidx_cached_basic_info()->brand) != 0 ||
+        timings->microcode != cpuidx_microcode_revision())
+        return -2;
+    return 0;
+}
@@ -0,0 +1,302 @@
+#if defined(__linux__)
+#define _GNU_SOURCE // For syscall
+#include <dirent.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "cpuidx_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VULNERABILITIES_DIR "/sys/devices/system/cpu/vulnerabilities"
+#define MSR_IA32_ARCH_CAPABILITIES 0x10a
+
+// Iterations of each benchmark, and the runs of which the fastest is kept
+#define SYSCALL_ITERATIONS 100000
+#define VERW_ITERATIONS 20000
+#define SWITCH_ROUND_TRIPS 20000
+#define STORE_LOAD_ITERATIONS 1000000
+#define RUNS 5
+
+/**
+ * @brief A vulnerability of the sysfs directory, and the path its mitigation taxes.
+ */
+struct vulnerability_path {
+    const char* name; /**< The file name in VULNERABILITIES_DIR */
+    const char* mitigation; /**< A substring of the status naming the taxing mitigation */
+    enum cpuidx_mitigation_path path; /**< The path the mitigation taxes */
+};
+
+// The mitigations with a known path; VERW clears the CPU buffers on each return to user space
+static const struct vulnerability_path paths[] = {
+    {"meltdown", "PTI", CPUIDX_PATH_SYSCALL},
+    {"spectre_v1", "Mitigation", CPUIDX_PATH_SYSCALL},
+    {"spectre_v2", "IBPB", CPUIDX_PATH_CONTEXT_SWITCH},
+    {"spectre_v2", "Mitigation", CPUIDX_PATH_SYSCALL},
+    {"spec_store_bypass", "Mitigation", CPUIDX_PATH_STORE_LOAD},
+    {"mds", "Clear CPU buffers", CPUIDX_PATH_KERNEL_EXIT},
+    {"tsx_async_abort", "Clear CPU buffers", CPUIDX_PATH_KERNEL_EXIT},
+    {"mmio_stale_data", "Clear CPU buffers", CPUIDX_PATH_KERNEL_EXIT},
+    {"reg_file_data_sampling", "Clear Register File", CPUIDX_PATH_KERNEL_EXIT},
+    {"retbleed", "Mitigation", CPUIDX_PATH_SYSCALL},
+    {"spec_rstack_overflow", "Mitigation", CPUIDX_PATH_SYSCALL},
+    {"l1tf", "flush", CPUIDX_PATH_VM_ENTRY},
+    {"gather_data_sampling", "Microcode", CPUIDX_PATH_NONE},
+};
+
+#define PATH_COUNT (sizeof(paths) / sizeof(paths[0]))
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_VERW 1
+
+/**
+ * Function to execute VERW, which clears the CPU buffers with the MD_CLEAR microcode as the kernel does.
+ */
+static inline void verw(void) {
+    uint16_t selector;
+    // SS holds a writable data segment in user mode; DS may be null on x86-64
+    __asm__ volatile ("mov %%ss, %0" : "=r" (selector));
+    __asm__ volatile ("verw %0" : : "m" (selector) : "cc");
+}
+#endif
+
+static int compare_names(const void* first, const void* second) {
+    return strcmp(((const cpuidx_vulnerability*) first)->name, ((const cpuidx_vulnerability*) second)->name);
+}
+
+/**
+ * Function to read the vulnerabilities the kernel reports, and the path each mitigation taxes.
+ */
+static void read_vulnerabilities(cpuidx_mitigation_report* report) {
+#if defined(__linux__)
+    DIR* directory = opendir(VULNERABILITIES_DIR);
+    const struct dirent* entry;
+    char path[sizeof(VULNERABILITIES_DIR) + 256];
+
+    if (!directory) return;
+
+    while ((entry = readdir(directory)) && report->vulnerability_count < CPUIDX_MAX_VULNERABILITIES) {
+        const size_t length = strlen(entry->d_name);
+        if (entry->d_name[0] == '.' || length >= sizeof(report->vulnerabilities[0].name)) continue;
+
+        cpuidx_vulnerability* vulnerability = &report->vulnerabilities[report->vulnerability_count];
+        snprintf(path, sizeof(path), VULNERABILITIES_DIR "/%s", entry->d_name);
+        if (cpuidx_read_file(path, vulnerability->status, sizeof(vulnerability->status)) != 0) continue;
+
+        vulnerability->status[strcspn(vulnerability->status, "\n")] = '\0';
+        memcpy(vulnerability->name, entry->d_name, length + 1);
+        vulnerability->affected = strncmp(vulnerability->status, "Not affected", 12) != 0;
+        vulnerability->mitigated = strncmp(vulnerability->status, "Mitigation", 10) == 0;
+        vulnerability->tax_ns = -1;
+
+        for (size_t i = 0; i < PATH_COUNT; ++i) {
+            if (strcmp(paths[i].name, entry->d_name) == 0 && strstr(vulnerability->status, paths[i].mitigation)) {
+                vulnerability->path = paths[i].path;
+                break;
+            }
+        }
+        ++report->vulnerability_count;
+    }
+    closedir(directory);
+
+    qsort(report->vulnerabilities, report->vulnerability_count, sizeof(report->vulnerabilities[0]), compare_names);
+#else
+    (void) report;
+#endif
+}
+
+#if defined(__linux__)
+/**
+ * Function to measure the round trip of a minimal system call.
+ */
+static double measure_syscall(void) {
+    uint64_t best = UINT64_MAX;
+
+    for (int run = 0; run < RUNS; ++run) {
+        const uint64_t start = cpuidx_monotonic_ns();
+        for (int i = 0; i < SYSCALL_ITERATIONS; ++i) syscall(SYS_getppid);
+        const uint64_t elapsed = cpuidx_monotonic_ns() - start;
+        if (elapsed < best) best = elapsed;
+    }
+    return (double) best / SYSCALL_ITERATIONS;
+}
+
+/**
+ * Function to measure a context switch between two processes on one CPU, in a child process.
+ *
+ * @param ibpb Whether to disable indirect branch speculation for both, which makes the kernel issue an IBPB
+ * on each switch when spectre_v2_user is in prctl mode.
+ * @return The time of a switch in nanoseconds, or -1 if it cannot be measured.
+ */
+static double measure_context_switch(const bool ibpb) {
+    int ping[2], pong[2];
+    char token = 0;
+
+#ifdef PR_SET_SPECULATION_CTRL
+    if (ibpb && prctl(PR_SET_SPECULATION_CTRL, PR_SPEC_INDIRECT_BRANCH, PR_SPEC_DISABLE, 0, 0) != 0) return -1;
+#else
+    if (ibpb) return -1;
+#endif
+
+    // Both processes share the CPU, so that each round trip is two switches
+    if (cpuidx_pin_thread(cpuidx_current_cpu()) != 0 || pipe(ping) != 0 || pipe(pong) != 0) return -1;
+
+    const pid_t partner = fork();
+    if (partner < 0) return -1;
+    if (partner == 0) {
+        close(ping[1]);
+        close(pong[0]);
+        while (read(ping[0], &token, 1) == 1 && write(pong[1], &token, 1) == 1) {}
+        _exit(0);
+    }
+
+    uint64_t best = UINT64_MAX;
+    for (int run = 0; run < RUNS; ++run) {
+        const uint64_t start = cpuidx_monotonic_ns();
+        for (int i = 0; i < SWITCH_ROUND_TRIPS; ++i) {
+            if (write(ping[1], &token, 1) != 1 || read(pong[0], &token, 1) != 1) break;
+        }
+        const uint64_t elapsed = cpuidx_monotonic_ns() - start;
+        if (elapsed < best) best = elapsed;
+    }
+
+    // The partner stops at the end of the ping pipe
+    close(ping[1]);
+    waitpid(partner, NULL, 0);
+    return (double) best / (2.0 * SWITCH_ROUND_TRIPS);
+}
+
+/**
+ * Function to measure stores followed by dependent loads, in a child process.
+ *
+ * @param ssbd Whether to disable speculative store bypass, as the SSBD mitigation does for opted-in tasks.
+ * @return The time of a store and load in nanoseconds, or -1 if it cannot be measured.
+ */
+static double measure_store_load(const bool ssbd) {
+    volatile uint64_t slots[64] = {0};
+    uint64_t best = UINT64_MAX, index = 0;
+
+#ifdef PR_SET_SPECULATION_CTRL
+    if (ssbd && prctl(PR_SET_SPECULATION_CTRL, PR_SPEC_STORE_BYPASS, PR_SPEC_DISABLE, 0, 0) != 0) return -1;
+#else
+    if (ssbd) return -1;
+#endif
+
+    for (int run = 0; run < RUNS; ++run) {
+        const uint64_t start = cpuidx_monotonic_ns();
+        // The address of each store depends on the previous load, so later loads could bypass it
+        for (int i = 0; i < STORE_LOAD_ITERATIONS; ++i) {
+            slots[index & 63] = (uint64_t) i;
+            index += slots[(uint64_t) i & 63] & 1;
+        }
+        const uint64_t elapsed = cpuidx_monotonic_ns() - start;
+        if (elapsed < best) best = elapsed;
+    }
+    return (double) best / STORE_LOAD_ITERATIONS;
+}
+
+/**
+ * Function to run a measurement in a child process, whose speculation controls and affinity do not leak back.
+ *
+ * @return The measurement, or -1 if it failed.
+ */
+static double measure_in_child(double (*measure)(bool), const bool mitigated) {
+    int channel[2];
+    double result = -1;
+
+    if (pipe(channel) != 0) return -1;
+
+    const pid_t child = fork();
+    if (child == 0) {
+        close(channel[0]);
+        result = measure(mitigated);
+        _exit(write(channel[1], &result, sizeof(result)) == sizeof(result) ? 0 : 1);
+    }
+
+    close(channel[1]);
+    if (child > 0) {
+        if (read(channel[0], &result, sizeof(result)) != sizeof(result)) result = -1;
+        waitpid(child, NULL, 0);
+    }
+    close(channel[0]);
+    return result;
+}
+#endif
+
+/**
+ * Function to report the speculative-execution mitigations of the kernel, and measure what they cost.
+ *
+ * The status of each vulnerability comes from sysfs, and IA32_ARCH_CAPABILITIES from the msr driver when
+ * permitted. The benchmarks time the paths the mitigations tax: a system call round trip, a context switch
+ * between processes on one CPU, and VERW, which clears the CPU buffers on each return to user space under the
+ * MDS, TAA, MMIO and RFDS mitigations. Where the kernel lets a process opt in with prctl, the IBPB on context
+ * switches and SSBD are measured both ways in child processes, and their difference is the tax.
+ * The \p tax_ns of each vulnerability is the cost per crossing of its path, or -1 if it cannot be isolated,
+ * e.g. PTI, which cannot be turned off at run time.
+ * The benchmarks take about a second.
+ *
+ * @param report A pointer to a \p cpuidx_mitigation_report structure to store the report.
+ * @return 0 on success, -1 if the vulnerabilities are not reported by the OS.
+ */
+int cpuidx_get_mitigation_report(cpuidx_mitigation_report* report) {
+    const cpu_features* features = cpuidx_cached_features();
+
+    memset(report, 0, sizeof(*report));
+    report->syscall_ns = report->context_switch_ns = report->verw_ns = -1;
+    report->ibpb_ns = report->ssbd_ns = -1;
+
+    read_vulnerabilities(report);
+
+    if (features->IA32_ARCH_CAPABILITIES) {
+        report->arch_capabilities_read =
+            cpuidx_read_msr(0, MSR_IA32_ARCH_CAPABILITIES, &report->arch_capabilities) == 0;
+    }
+
+#if HAVE_VERW
+    uint64_t best = UINT64_MAX;
+    for (int run = 0; run < RUNS; ++run) {
+        const uint64_t start = cpuidx_monotonic_ns();
+        for (int i = 0; i < VERW_ITERATIONS; ++i) verw();
+        const uint64_t elapsed = cpuidx_monotonic_ns() - start;
+        if (elapsed < best) best = elapsed;
+    }
+    report->verw_ns = (double) best / VERW_ITERATIONS;
+#endif
+
+#if defined(__linux__)
+    report->syscall_ns = measure_syscall();
+    report->context_switch_ns = measure_in_child(measure_context_switch, false);
+
+    const double ibpb_switch = measure_in_child(measure_context_switch, true);
+    if (ibpb_switch > 0 && report->context_switch_ns > 0) report->ibpb_ns = ibpb_switch - report->context_switch_ns;
+
+    const double store_load = measure_in_child(measure_store_load, false);
+    const double ssbd_store_load = measure_in_child(measure_store_load, true);
+    if (store_load > 0 && ssbd_store_load > 0) report->ssbd_ns = ssbd_store_load - store_load;
+#endif
+
+    for (size_t i = 0; i < report->vulnerability_count; ++i) {
+        cpuidx_vulnerability* vulnerability = &report->vulnerabilities[i];
+
+        switch (vulnerability->path) {
+            case CPUIDX_PATH_KERNEL_EXIT:
+                vulnerability->tax_ns = report->verw_ns;
+                break;
+            case CPUIDX_PATH_CONTEXT_SWITCH:
+                vulnerability->tax_ns = report->ibpb_ns;
+                break;
+            case CPUIDX_PATH_STORE_LOAD:
+                // Only processes opting in pay for SSBD in prctl and seccomp modes
+                vulnerability->tax_ns = report->ssbd_ns;
+                break;
+            default:
+                break;
+        }
+    }
+
+    return report->vulnerability_count ? 0 : -1;
+}
@@ -0,0 +1,151 @@
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#include "cpuidx_internal.h"
+#include <stdio.h>
+#include <string.h>
+
+// Thermal and power management leaf 6, EAX
+#define LEAF6_TURBO 0x00000002
+#define LEAF6_ARAT 0x00000004
+#define LEAF6_HWP 0x00000080
+#define LEAF6_HWP_NOTIFICATION 0x00000100
+#define LEAF6_HWP_ACTIVITY_WINDOW 0x00000200
+#define LEAF6_HWP_EPP 0x00000400
+#define LEAF6_HWP_PACKAGE 0x00000800
+#define LEAF6_HDC 0x00002000
+#define LEAF6_TURBO_MAX_3 0x00004000
+#define LEAF6_HWP_FAST_REQUEST 0x00040000
+#define LEAF6_HFI 0x00080000
+#define LEAF6_THREAD_DIRECTOR 0x00800000
+
+// Leaf 6, ECX
+#define LEAF6_APERFMPERF 0x00000001
+#define LEAF6_EPB 0x00000008
+
+// Advanced power management leaf 0x80000007, EDX
+#define APM_HW_PSTATE 0x00000080
+#define APM_INVARIANT_TSC 0x00000100
+#define APM_CPB 0x00000200
+#define APM_EFF_FREQ_RO 0x00000400
+
+/**
+ * Function to read a sysfs attribute into a string, without the trailing newline.
+ *
+ * @return 0 on success, -1 if the attribute does not exist.
+ */
+static int read_attribute(const char* CPUIDX_RESTRICT path, char* CPUIDX_RESTRICT value, const size_t size) {
+    if (cpuidx_read_file(path, value, size) != 0) return -1;
+    value[strcspn(value, "\n")] = '\0';
+    return 0;
+}
+
+/**
+ * Function to check whether a frequency policy trades latency for power.
+ */
+static uint32_t policy_warnings(const char* governor, const char* driver, const char* epp) {
+    uint32_t warnings = 0;
+
+    // intel_pstate and amd-pstate-epp in active mode only have "powersave" and "performance",
+    // and tune through the EPP; elsewhere "powersave" pins the lowest frequency
+    const bool active = strcmp(driver, "intel_pstate") == 0 || strcmp(driver, "amd-pstate-epp") == 0;
+    if ((strcmp(governor, "powersave") == 0 && !active) || strcmp(governor, "conservative") == 0)
+        warnings |= CPUIDX_POWER_SLOW_GOVERNOR;
+
+    if (strcmp(epp, "power") == 0 || strcmp(epp, "balance_power") == 0) warnings |= CPUIDX_POWER_SAVING_EPP;
+    return warnings;
+}
+
+/**
+ * Function to read the frequency policies of the OS into a power report, and flag those hurting latency.
+ */
+static void read_policies(cpuidx_power_info* info) {
+#if defined(__linux__)
+    const long configured = sysconf(_SC_NPROCESSORS_CONF);
+    char path[96], governor[32], driver[32], epp[32];
+    bool first = true;
+
+    // Each CPU links to its policy; shared policies are checked once per CPU, which costs a few reads
+    for (long cpu = 0; cpu < configured; ++cpu) {
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%ld/cpufreq/scaling_governor", cpu);
+        if (read_attribute(path, governor, sizeof(governor)) != 0) continue;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%ld/cpufreq/scaling_driver", cpu);
+        read_attribute(path, driver, sizeof(driver));
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%ld/cpufreq/energy_performance_preference", cpu);
+        read_attribute(path, epp, sizeof(epp));
+
+        const uint32_t warnings = policy_warnings(governor, driver, epp);
+        if (warnings) ++info->flagged_cpus;
+        info->warnings |= warnings;
+
+        if (first) {
+            memcpy(info->governor, governor, sizeof(info->governor));
+            memcpy(info->driver, driver, sizeof(info->driver));
+            memcpy(info->epp, epp, sizeof(info->epp));
+            first = false;
+        }
+    }
+
+    // intel_pstate disables turbo with no_turbo, acpi-cpufreq and amd-pstate with boost
+    char value[8];
+    if (read_attribute("/sys/devices/system/cpu/intel_pstate/no_turbo", value, sizeof(value)) == 0)
+        info->boost = value[0] == '0';
+    else if (read_attribute("/sys/devices/system/cpu/cpufreq/boost", value, sizeof(value)) == 0)
+        info->boost = value[0] == '1';
+#else
+    (void) info;
+#endif
+}
+
+/**
+ * Function to get the power management capabilities of the CPU, combined with the frequency policy of the OS.
+ *
+ * The capabilities come from CPUID leaf 6 and, on AMD, 0x80000007. On Linux, the cpufreq governor, driver and
+ * energy-performance preference of every CPU are read from sysfs, and \p warnings flags the settings that
+ * trade latency for power: a governor keeping the frequency low, an EPP of "power" or "balance_power",
+ * or turbo disabled although the CPU supports it.
+ *
+ * @param info A pointer to a \p cpuidx_power_info structure to store the report.
+ * @return 0 on success, -1 if CPUID is not supported.
+ */
+int cpuidx_get_power_info(cpuidx_power_info* info) {
+    const cpu_basic_info* basic_info = cpuidx_cached_basic_info();
+    uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+
+    memset(info, 0, sizeof(*info));
+    info->boost = -1;
+    if (!basic_info->highest_basic_leaf) return -1;
+
+    if (basic_info->highest_basic_leaf >= 6) {
+        cpuid(6, registers);
+        info->turbo = registers[0] & LEAF6_TURBO;
+        info->arat = registers[0] & LEAF6_ARAT;
+        info->hwp = registers[0] & LEAF6_HWP;
+        info->hwp_notification = registers[0] & LEAF6_HWP_NOTIFICATION;
+        info->hwp_activity_window = registers[0] & LEAF6_HWP_ACTIVITY_WINDOW;
+        info->hwp_epp = registers[0] & LEAF6_HWP_EPP;
+        info->hwp_package = registers[0] & LEAF6_HWP_PACKAGE;
+        info->hwp_fast_request = registers[0] & LEAF6_HWP_FAST_REQUEST;
+        info->hdc = registers[0] & LEAF6_HDC;
+        info->turbo_max_3 = registers[0] & LEAF6_TURBO_MAX_3;
+        info->hfi = registers[0] & LEAF6_HFI;
+        info->thread_director = registers[0] & LEAF6_THREAD_DIRECTOR;
+        info->aperfmperf = registers[2] & LEAF6_APERFMPERF;
+        info->epb = registers[2] & LEAF6_EPB;
+    }
+
+    if (basic_info->highest_extended_leaf >= 0x80000007) {
+        cpuid(0x80000007, registers);
+        info->hw_pstate = registers[3] & APM_HW_PSTATE;
+        info->invariant_tsc = registers[3] & APM_INVARIANT_TSC;
+        info->cpb = registers[3] & APM_CPB;
+        info->effective_frequency = registers[3] & APM_EFF_FREQ_RO;
+    }
+
+    read_policies(info);
+
+    if (info->boost == 0 && (info->turbo || info->cpb)) info->warnings |= CPUIDX_POWER_TURBO_DISABLED;
+    return 0;
+}
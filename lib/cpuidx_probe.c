@@ -0,0 +1,419 @@
+#include "cpuidx.h"
+#include "cpuidx_ifunc.h"
+#include "cpuidx_internal.h"
+#include <string.h>
+
+// The kernels are GNU inline assembly, for the exact instructions and register allocation they need
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define CPUIDX_PROBE_AVAILABLE 1
+
+#define ITERATIONS 4096
+#define REPETITIONS 7
+
+// Every kernel runs 48 instructions per iteration: 4 rounds over 12 registers, enough independent
+// chains to cover latency 4 on 3 ports. The timing reference is a chain of 48 dependent adds, 1 cycle each
+#define BODY(insn) ".rept 4\n.irp r,0,1,2,3,4,5,6,7,8,9,10,11\n" insn "\n.endr\n.endr\n"
+
+#define ZERO_REGISTERS ".irp r,0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15\nvxorps %%xmm\\r, %%xmm\\r, %%xmm\\r\n.endr\n"
+
+#define VECTOR_CLOBBERS \
+    "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7", "xmm8", "xmm9", "xmm10", "xmm11", "xmm12", \
+    "xmm13", "xmm14", "xmm15"
+
+#define KERNEL(name, insn) \
+    static void name(uint64_t iterations, const void* data) { \
+        __asm__ volatile ( \
+            ZERO_REGISTERS "1:\n" BODY(insn) "dec %0\njnz 1b\nvzeroupper\n" \
+            : "+r" (iterations) : "r" (data) : "cc", "memory", VECTOR_CLOBBERS); \
+    }
+
+KERNEL(fma_128, "vfmadd231ps %%xmm15, %%xmm14, %%xmm\\r")
+KERNEL(fma_256, "vfmadd231ps %%ymm15, %%ymm14, %%ymm\\r")
+KERNEL(fma_512, "vfmadd231ps %%zmm15, %%zmm14, %%zmm\\r")
+KERNEL(shuffle_128, "vshufps $0x1b, %%xmm14, %%xmm14, %%xmm\\r")
+KERNEL(shuffle_256, "vshufps $0x1b, %%ymm14, %%ymm14, %%ymm\\r")
+KERNEL(shuffle_512, "vshufps $0x1b, %%zmm14, %%zmm14, %%zmm\\r")
+KERNEL(load_128, "vmovups \\r*64(%1), %%xmm\\r")
+KERNEL(load_256, "vmovups \\r*64(%1), %%ymm\\r")
+KERNEL(load_512, "vmovups \\r*64(%1), %%zmm\\r")
+
+// Adds a register rather than an immediate, which recent cores (e.g. Golden Cove) fold at rename
+static void add_chain(uint64_t iterations, const void* data) {
+    (void) data;
+    uint64_t value = 0;
+    __asm__ volatile ("1:\n.rept 48\nadd %2, %1\n.endr\ndec %0\njnz 1b\n"
+        : "+r" (iterations), "+r" (value) : "r" ((uint64_t) 1) : "cc");
+}
+
+// The frequency license kernels: 96 independent FMAs alongside a chain of 48 dependent adds, which keep two
+// FMA units busy, holding the frequency license of their width. The chain sets the pace with two units,
+// the FMAs with one
+#define LICENSE_KERNEL(name, insn) \
+    static void name(uint64_t iterations, const void* data) { \
+        (void) data; \
+        uint64_t value = 0; \
+        __asm__ volatile ( \
+            ZERO_REGISTERS "1:\n.rept 4\n.irp r,0,1,2,3,4,5,6,7,8,9,10,11\n" insn "\nadd %2, %1\n.endr\n" \
+            ".irp r,0,1,2,3,4,5,6,7,8,9,10,11\n" insn "\n.endr\n.endr\ndec %0\njnz 1b\nvzeroupper\n" \
+            : "+r" (iterations), "+r" (value) : "r" ((uint64_t) 1) : "cc", VECTOR_CLOBBERS); \
+    }
+
+LICENSE_KERNEL(license_128, "vfmadd231ps %%xmm15, %%xmm14, %%xmm\\r")
+LICENSE_KERNEL(license_256, "vfmadd231ps %%ymm15, %%ymm14, %%ymm\\r")
+LICENSE_KERNEL(license_512, "vfmadd231ps %%zmm15, %%zmm14, %%zmm\\r")
+
+// The ISA benchmark kernels, 48 instructions per iteration each
+#define PDEP_PEXT_LATENCY(name, insn) \
+    static void name(uint64_t iterations, const void* data) { \
+        (void) data; \
+        uint64_t value = ~(uint64_t) 0; \
+        __asm__ volatile ("1:\n.rept 48\n" insn " %2, %1, %1\n.endr\ndec %0\njnz 1b\n" \
+            : "+r" (iterations), "+r" (value) : "r" ((uint64_t) 0x5555555555555555) : "cc"); \
+    }
+
+#define PDEP_PEXT_THROUGHPUT(name, insn) \
+    static void name(uint64_t iterations, const void* data) { \
+        (void) data; \
+        __asm__ volatile ( \
+            "1:\n.rept 12\n.irp r,8,9,10,11\n" insn " %1, %2, %%r\\r\n.endr\n.endr\ndec %0\njnz 1b\n" \
+            : "+r" (iterations) : "r" ((uint64_t) 0x5555555555555555), "r" (~(uint64_t) 0) \
+            : "cc", "r8", "r9", "r10", "r11"); \
+    }
+
+PDEP_PEXT_LATENCY(pdep_latency, "pdep")
+PDEP_PEXT_LATENCY(pext_latency, "pext")
+PDEP_PEXT_THROUGHPUT(pdep_throughput, "pdep")
+PDEP_PEXT_THROUGHPUT(pext_throughput, "pext")
+
+// Gathers 8 dwords from 8 cache lines, the indices are the first 8 dwords of the data
+static void gather_throughput(uint64_t iterations, const void* data) {
+    __asm__ volatile (
+        ZERO_REGISTERS "vmovdqu (%1), %%ymm14\n"
+        "1:\n" BODY("vpcmpeqd %%ymm13, %%ymm13, %%ymm13\nvpgatherdd %%ymm13, (%1,%%ymm14,4), %%ymm\\r")
+        "dec %0\njnz 1b\nvzeroupper\n"
+        : "+r" (iterations) : "r" (data) : "cc", "memory", VECTOR_CLOBBERS);
+}
+
+static void vpermb_latency(uint64_t iterations, const void* data) {
+    (void) data;
+    __asm__ volatile (
+        ZERO_REGISTERS "1:\n.rept 48\nvpermb %%zmm15, %%zmm0, %%zmm0\n.endr\ndec %0\njnz 1b\nvzeroupper\n"
+        : "+r" (iterations) : : "cc", VECTOR_CLOBBERS);
+}
+
+KERNEL(vpermb_throughput, "vpermb %%zmm15, %%zmm14, %%zmm\\r")
+
+// The compiler only knows the mask registers, to clobber k1, when targeting AVX-512
+__attribute__((target("avx512f"))) static void compress_store_throughput(uint64_t iterations, const void* data) {
+    __asm__ volatile (
+        ZERO_REGISTERS "kxnorw %%k1, %%k1, %%k1\n"
+        "1:\n" BODY("vpcompressd %%zmm14, \\r*64(%1)%{%%k1%}") "dec %0\njnz 1b\nvzeroupper\n"
+        : "+r" (iterations) : "r" (data) : "cc", "memory", "k1", VECTOR_CLOBBERS);
+}
+
+// Copies 32 bytes within the data
+static void rep_movsb_throughput(uint64_t iterations, const void* data) {
+    __asm__ volatile (
+        "1:\n.rept 48\nmov %1, %%rsi\nlea 384(%1), %%rdi\nmov $32, %%ecx\nrep movsb\n.endr\ndec %0\njnz 1b\n"
+        : "+r" (iterations) : "r" (data) : "cc", "memory", "rcx", "rsi", "rdi");
+}
+
+#define FLUSH_THROUGHPUT(name, insn) \
+    static void name(uint64_t iterations, const void* data) { \
+        __asm__ volatile ( \
+            "1:\n" BODY("movl $1, \\r*64(%1)\n" insn " \\r*64(%1)") "sfence\ndec %0\njnz 1b\n" \
+            : "+r" (iterations) : "r" (data) : "cc", "memory"); \
+    }
+
+FLUSH_THROUGHPUT(clflushopt_throughput, "clflushopt")
+FLUSH_THROUGHPUT(clwb_throughput, "clwb")
+
+static void pause_latency(uint64_t iterations, const void* data) {
+    (void) data;
+    __asm__ volatile ("1:\n.rept 48\npause\n.endr\ndec %0\njnz 1b\n" : "+r" (iterations) : : "cc");
+}
+
+typedef void (*kernel)(uint64_t iterations, const void* data);
+
+/**
+ * Function to time the fastest of several runs of a kernel.
+ *
+ * @param run The kernel.
+ * @param data The data the kernel loads from.
+ * @return The TSC ticks of the fastest run.
+ */
+static uint64_t best_ticks(const kernel run, const void* data) {
+    uint64_t best = UINT64_MAX;
+
+    for (int i = 0; i < REPETITIONS; ++i) {
+        const uint64_t start = CPUIDX_RDTSC();
+        run(ITERATIONS, data);
+        const uint64_t ticks = CPUIDX_RDTSC() - start;
+        if (ticks < best) best = ticks;
+    }
+    return best;
+}
+
+/**
+ * Function to measure the throughput of a kernel in instructions per core cycle.
+ *
+ * The reference chain runs right after the kernel, at the same clock frequency, so the result does not depend
+ * on the TSC frequency, turbo, or the frequency license of the kernel.
+ *
+ * @param run The kernel.
+ * @param data The data the kernel loads from.
+ * @return The instructions per cycle.
+ */
+static double measure(const kernel run, const void* data) {
+    const uint64_t kernel_ticks = best_ticks(run, data);
+    const uint64_t chain_ticks = best_ticks(add_chain, NULL);
+
+    // Both run 48 instructions per iteration, and the chain runs 1 per cycle
+    return kernel_ticks ? (double) chain_ticks / (double) kernel_ticks : 0;
+}
+
+// Runs of the reference chain per kernel cycles estimate, an odd count for the median
+#define CYCLE_SAMPLES 5
+
+/**
+ * Function to measure the core cycles per iteration of a kernel, from the median of several runs of \p measure.
+ *
+ * @param run The kernel.
+ * @return The cycles per iteration, 0 if the kernel could not be timed.
+ */
+static double kernel_cycles(const kernel run) {
+    double samples[CYCLE_SAMPLES];
+
+    // Insertion sort, the reference chain runs 48 cycles per iteration
+    for (int i = 0; i < CYCLE_SAMPLES; ++i) {
+        const double ipc = measure(run, NULL);
+        int j = i;
+        for (; j > 0 && samples[j - 1] > ipc; --j) samples[j] = samples[j - 1];
+        samples[j] = ipc;
+    }
+    return samples[CYCLE_SAMPLES / 2] > 0 ? 48 / samples[CYCLE_SAMPLES / 2] : 0;
+}
+
+#define MSR_MPERF 0xe7
+#define MSR_APERF 0xe8
+
+#define WARMUP_MS 10
+#define SUSTAIN_MS 40
+#define RECOVERY_LIMIT_MS 100
+#define RECOVERED 0.98
+
+/**
+ * Function to measure the effective frequency of the core running a kernel for a while.
+ *
+ * @param run The kernel.
+ * @param cycles The core cycles per iteration of the kernel, used when APERF and MPERF are not readable.
+ * @param cpu The CPU the thread is pinned to, to read its APERF and MPERF registers, or -1.
+ * @param aperf_mperf A pointer to a flag, cleared if the APERF and MPERF registers could not be read.
+ * @return The frequency in Hz.
+ */
+static double sustained_frequency(const kernel run, const double cycles, const int cpu, bool* aperf_mperf) {
+    const uint64_t tsc_hz = cpuidx_tsc_frequency();
+    uint64_t aperf[2], mperf[2];
+
+    // Let the frequency settle first
+    const uint64_t warmup_end = CPUIDX_RDTSC() + tsc_hz / 1000 * WARMUP_MS;
+    while (CPUIDX_RDTSC() < warmup_end) run(ITERATIONS, NULL);
+
+    *aperf_mperf = *aperf_mperf && cpu >= 0 && cpuidx_read_msr(cpu, MSR_MPERF, &mperf[0]) == 0 &&
+                   cpuidx_read_msr(cpu, MSR_APERF, &aperf[0]) == 0;
+
+    const uint64_t start = CPUIDX_RDTSC();
+    const uint64_t end = start + tsc_hz / 1000 * SUSTAIN_MS;
+    uint64_t now, iterations = 0;
+
+    do {
+        run(ITERATIONS, NULL);
+        iterations += ITERATIONS;
+    } while ((now = CPUIDX_RDTSC()) < end);
+
+    if (*aperf_mperf && cpuidx_read_msr(cpu, MSR_APERF, &aperf[1]) == 0 &&
+        cpuidx_read_msr(cpu, MSR_MPERF, &mperf[1]) == 0 && mperf[1] > mperf[0])
+        return (double) tsc_hz * (double) (aperf[1] - aperf[0]) / (double) (mperf[1] - mperf[0]);
+
+    *aperf_mperf = false;
+    return cycles * (double) iterations * (double) tsc_hz / (double) (now - start);
+}
+
+/**
+ * Function to measure how long the frequency takes to recover after a kernel, running scalar code.
+ *
+ * @param target The frequency in Hz of scalar code.
+ * @return The time until the frequency is back to 98% of \p target, in microseconds, capped at 100 ms.
+ */
+static double recovery_time(const double target) {
+    const uint64_t tsc_hz = cpuidx_tsc_frequency();
+    const uint64_t start = CPUIDX_RDTSC();
+    const uint64_t limit = start + tsc_hz / 1000 * RECOVERY_LIMIT_MS;
+    uint64_t window_start, now;
+
+    // Short windows of about 10,000 cycles
+    do {
+        window_start = CPUIDX_RDTSC();
+        add_chain(ITERATIONS / 16, NULL);
+        now = CPUIDX_RDTSC();
+    } while (48.0 * (ITERATIONS / 16) * (double) tsc_hz / (double) (now - window_start) < RECOVERED * target &&
+             now < limit);
+
+    return (double) (now - start) * 1e6 / (double) tsc_hz;
+}
+#endif
+
+/**
+ * Function to measure the vector throughput of the running core, and infer its execution units.
+ *
+ * Measures independent FMA, shuffle and load instructions at every vector width the CPU and the OS support.
+ * Parts with the same features may differ in units, e.g. one or two 512-bit FMA units on Xeon Scalable,
+ * or 512-bit operations split into two halves on Zen 4. Pin the thread to a core for stable results.
+ * Takes a few milliseconds.
+ *
+ * @param probe A pointer to a \p cpuidx_port_probe structure to store the measurements.
+ * @return 0 on success, -1 if AVX is not usable or the probe is not available for this compiler or architecture.
+ */
+int cpuidx_probe_ports(cpuidx_port_probe* probe) {
+    memset(probe, 0, sizeof(*probe));
+
+#ifdef CPUIDX_PROBE_AVAILABLE
+    static _Alignas(64) const unsigned char load_data[12 * 64];
+
+    if (!cpuidx_ifunc_supports(CPUIDX_FEATURE_AVX)) return -1;
+
+    const bool fma = cpuidx_ifunc_supports(CPUIDX_FEATURE_FMA);
+    const bool avx512 = cpuidx_ifunc_supports(CPUIDX_FEATURE_AVX512F);
+
+    probe->shuffle[CPUIDX_WIDTH_128] = measure(shuffle_128, NULL);
+    probe->shuffle[CPUIDX_WIDTH_256] = measure(shuffle_256, NULL);
+    probe->load[CPUIDX_WIDTH_128] = measure(load_128, load_data);
+    probe->load[CPUIDX_WIDTH_256] = measure(load_256, load_data);
+
+    if (fma) {
+        probe->fma[CPUIDX_WIDTH_128] = measure(fma_128, NULL);
+        probe->fma[CPUIDX_WIDTH_256] = measure(fma_256, NULL);
+        probe->fma_units = (uint32_t) (probe->fma[CPUIDX_WIDTH_256] + 0.5);
+    }
+
+    if (avx512) {
+        probe->fma[CPUIDX_WIDTH_512] = measure(fma_512, NULL);
+        probe->shuffle[CPUIDX_WIDTH_512] = measure(shuffle_512, NULL);
+        probe->load[CPUIDX_WIDTH_512] = measure(load_512, load_data);
+        probe->fma512_units = (uint32_t) (probe->fma[CPUIDX_WIDTH_512] + 0.5);
+
+        // A single 512-bit FMA unit halves the FMA throughput only; splitting halves the shuffles too
+        probe->double_pumped_512 = fma && probe->fma[CPUIDX_WIDTH_512] < 0.75 * probe->fma[CPUIDX_WIDTH_256] &&
+                                   probe->shuffle[CPUIDX_WIDTH_512] < 0.75 * probe->shuffle[CPUIDX_WIDTH_256];
+    }
+
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/**
+ * Function to measure the frequency drop of the core running FMA code of each vector width, and its recovery.
+ *
+ * Runs scalar code, then sustained 128-bit, 256-bit and 512-bit FMA code, at every width the CPU and the OS
+ * support. The frequencies come from the APERF and MPERF registers when the msr driver makes them readable,
+ * and from the throughput of a dependent chain against the TSC otherwise, whose cycles per iteration are the
+ * median of several timings. Drops are clamped to [0, 1], and \p unreliable is set if a vector frequency came out
+ * above the scalar one. Takes about a second.
+ *
+ * @param cpu The logical CPU to measure, or -1 for the CPU the thread runs on, without pinning it.
+ * @param license A pointer to a \p cpuidx_frequency_license structure to store the measurements.
+ * @return 0 on success, -1 if FMA is not usable or the measurement is not available for this compiler or
+ *         architecture, -2 if the thread could not be pinned to \p cpu.
+ */
+int cpuidx_measure_frequency_license(const int cpu, cpuidx_frequency_license* license) {
+    memset(license, 0, sizeof(*license));
+
+#ifdef CPUIDX_PROBE_AVAILABLE
+    static const kernel kernels[CPUIDX_WIDTH_COUNT] = {license_128, license_256, license_512};
+
+    if (!cpuidx_ifunc_supports(CPUIDX_FEATURE_FMA)) return -1;
+    if (cpu >= 0 && cpuidx_pin_thread(cpu) != 0) return -2;
+
+    const int widths = cpuidx_ifunc_supports(CPUIDX_FEATURE_AVX512F) ? CPUIDX_WIDTH_COUNT : CPUIDX_WIDTH_512;
+
+    // The first run brings the core out of idle
+    license->aperf_mperf = true;
+    sustained_frequency(add_chain, 48, cpu, &license->aperf_mperf);
+    license->scalar_hz = sustained_frequency(add_chain, 48, cpu, &license->aperf_mperf);
+
+    for (int i = 0; i < widths; ++i) {
+        // The chain sets the pace with two FMA units at this width, the FMAs with one: time the kernel itself
+        const double cycles = kernel_cycles(kernels[i]);
+
+        license->vector_hz[i] = sustained_frequency(kernels[i], cycles, cpu, &license->aperf_mperf);
+        license->recovery_us[i] = recovery_time(license->scalar_hz);
+
+        // Above the scalar frequency, another load or the hypervisor disturbed one of the measurements
+        if (license->vector_hz[i] > license->scalar_hz) license->unreliable = true;
+        const double drop = 1 - license->vector_hz[i] / license->scalar_hz;
+        license->drop[i] = drop < 0 ? 0 : drop > 1 ? 1 : drop;
+    }
+
+    if (cpu >= 0) cpuidx_unpin_thread();
+    return 0;
+#else
+    (void) cpu;
+    return -1;
+#endif
+}
+
+/**
+ * Function to measure the speed of instructions that varies across CPUs with the same features.
+ *
+ * Measures each benchmark the CPU and the OS support, in core cycles. The results depend on the micro-architecture
+ * and the microcode only, so they can be cached with \p cpuidx_format_isa_timings, and loaded back with
+ * \p cpuidx_load_isa_timings. Takes a fraction of a second.
+ *
+ * @param timings A pointer to a \p cpuidx_isa_timings structure to store the measurements.
+ * @return 0 on success, -1 if the measurement is not available for this compiler or architecture.
+ */
+int cpuidx_measure_isa(cpuidx_isa_timings* timings) {
+    memset(timings, 0, sizeof(*timings));
+
+#ifdef CPUIDX_PROBE_AVAILABLE
+    static const struct {
+        enum cpuidx_feature feature; /**< The feature the benchmark needs */
+        kernel latency; /**< The dependent kernel, or a null pointer */
+        kernel throughput; /**< The independent kernel, or a null pointer */
+    } benchmarks[CPUIDX_ISA_BENCHMARK_COUNT] = {
+        [CPUIDX_ISA_PDEP] = {CPUIDX_FEATURE_BMI2, pdep_latency, pdep_throughput},
+        [CPUIDX_ISA_PEXT] = {CPUIDX_FEATURE_BMI2, pext_latency, pext_throughput},
+        [CPUIDX_ISA_VPGATHERDD] = {CPUIDX_FEATURE_AVX2, NULL, gather_throughput},
+        [CPUIDX_ISA_VPERMB] = {CPUIDX_FEATURE_AVX512VBMI, vpermb_latency, vpermb_throughput},
+        [CPUIDX_ISA_VPCOMPRESSD] = {CPUIDX_FEATURE_AVX512F, NULL, compress_store_throughput},
+        [CPUIDX_ISA_REP_MOVSB] = {CPUIDX_FEATURE_LM, NULL, rep_movsb_throughput},
+        [CPUIDX_ISA_CLFLUSHOPT] = {CPUIDX_FEATURE_CLFLUSHOPT, NULL, clflushopt_throughput},
+        [CPUIDX_ISA_CLWB] = {CPUIDX_FEATURE_CLWB, NULL, clwb_throughput},
+        [CPUIDX_ISA_PAUSE] = {CPUIDX_FEATURE_SSE2, pause_latency, NULL},
+    };
+    // Gather indices, one dword per cache line, and room for the stores
+    static _Alignas(64) const uint32_t gather_data[12 * 16] = {0, 16, 32, 48, 64, 80, 96, 112};
+    _Alignas(64) unsigned char store_data[12 * 64] = {0};
+
+    uint32_t registers[4] = {0};
+    cpuid(1, registers);
+    timings->signature = registers[0];
+    memcpy(timings->brand, cpuidx_cached_basic_info()->brand, sizeof(timings->brand));
+    timings->microcode = cpuidx_microcode_revision();
+
+    for (int i = 0; i < CPUIDX_ISA_BENCHMARK_COUNT; ++i) {
+        if (!cpuidx_ifunc_supports(benchmarks[i].feature)) continue;
+
+        const void* data = i == CPUIDX_ISA_VPGATHERDD ? (const void*) gather_data : store_data;
+        if (benchmarks[i].latency) timings->latency[i] = 1 / measure(benchmarks[i].latency, data);
+        if (benchmarks[i].throughput) timings->throughput[i] = 1 / measure(benchmarks[i].throughput, data);
+    }
+
+    cpuidx_classify_isa_timings(timings);
+    return 0;
+#else
+    return -1;
+#endif
+}
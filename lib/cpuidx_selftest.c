@@ -0,0 +1,359 @@
+#if defined(__linux__) || defined(__unix__) || defined(__APPLE__)
+#include <setjmp.h>
+#include <signal.h>
+#endif
+
+#include "cpuidx_internal.h"
+#include <string.h>
+
+// The snippets are GNU inline assembly, and the faults are caught with signals
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__) && \
+    (defined(__linux__) || defined(__unix__) || defined(__APPLE__))
+#define CPUIDX_SELF_TEST_AVAILABLE 1
+
+#define ITERATIONS 64
+#define REPETITIONS 5
+
+// A VM exit or a trap to an emulating handler costs a microsecond or more, native instructions a few nanoseconds
+#define SLOW_NS 100.0
+// Serializing, flushing and direct stores take hundreds of nanoseconds natively
+#define SLOW_SERIALIZING_NS 2000.0
+// RDRAND and RDSEED wait for the entropy source, microseconds under the SRBDS mitigation
+#define SLOW_RANDOM_NS 20000.0
+
+// Every snippet runs its instruction 8 times per iteration, on zeroed vectors so that no FP assist slows it
+#define SNIPPET(name, init, insn, exit) \
+    static void name(uint64_t iterations, void* data) { \
+        __asm__ volatile ( \
+            init "1:\n.rept 8\n" insn "\n.endr\ndec %0\njnz 1b\n" exit \
+            : "+r" (iterations) : "r" (data) : "cc", "memory", "rax", "rcx", "rdx", "xmm0", "xmm1", "xmm2"); \
+    }
+
+#define GPR_INIT "mov $1, %%eax\nmov $3, %%edx\nxor %%ecx, %%ecx\n"
+#define SSE_INIT "pxor %%xmm0, %%xmm0\npxor %%xmm1, %%xmm1\npxor %%xmm2, %%xmm2\n"
+// VEX zeroing clears the registers up to the widest vector length
+#define VEX_INIT "vpxor %%xmm0, %%xmm0, %%xmm0\nvpxor %%xmm1, %%xmm1, %%xmm1\nvpxor %%xmm2, %%xmm2, %%xmm2\n"
+
+#define GPR_SNIPPET(name, insn) SNIPPET(name, GPR_INIT, insn, "")
+#define SSE_SNIPPET(name, insn) SNIPPET(name, SSE_INIT, insn, "")
+#define VEX_SNIPPET(name, insn) SNIPPET(name, VEX_INIT, insn, "vzeroupper\n")
+
+GPR_SNIPPET(lahf, "lahf")
+GPR_SNIPPET(popcnt, "popcnt %%rax, %%rdx")
+GPR_SNIPPET(movbe, "movbe (%1), %%rax")
+GPR_SNIPPET(andn, "andn %%rax, %%rdx, %%rdx")
+GPR_SNIPPET(pdep, "pdep %%rax, %%rdx, %%rdx")
+GPR_SNIPPET(lzcnt, "lzcnt %%rax, %%rdx")
+GPR_SNIPPET(adcx, "adcx %%rax, %%rdx")
+GPR_SNIPPET(blcfill, "blcfill %%rax, %%rdx")
+GPR_SNIPPET(rdrand, "rdrand %%rax")
+GPR_SNIPPET(rdseed, "rdseed %%rax")
+GPR_SNIPPET(rdpid, "rdpid %%rax")
+GPR_SNIPPET(rdtscp, "rdtscp")
+// Faults unless the OS set CR4.FSGSBASE, which Linux does since 5.9 only
+GPR_SNIPPET(rdfsbase, "rdfsbase %%rax")
+GPR_SNIPPET(rdpkru, "xor %%ecx, %%ecx\nrdpkru")
+GPR_SNIPPET(serialize, "serialize")
+GPR_SNIPPET(prefetchw, "prefetchw (%1)")
+GPR_SNIPPET(clflushopt, "clflushopt (%1)")
+GPR_SNIPPET(clwb, "clwb (%1)")
+GPR_SNIPPET(cldemote, "cldemote (%1)")
+GPR_SNIPPET(movdiri, "movdiri %%eax, (%1)")
+// The destination is the second cache line of the data, which must be 64-byte aligned
+SNIPPET(movdir64b, "lea 64(%1), %%rax\n", "movdir64b (%1), %%rax", "")
+// A deadline of 0 has passed already, so that TPAUSE returns at once
+SNIPPET(tpause, "xor %%eax, %%eax\nxor %%edx, %%edx\nxor %%ecx, %%ecx\n", "tpause %%ecx", "")
+GPR_SNIPPET(xbegin, "xbegin 2f\nxend\n2:")
+GPR_SNIPPET(tilerelease, "tilerelease")
+
+SSE_SNIPPET(addsubps, "addsubps %%xmm1, %%xmm0")
+SSE_SNIPPET(pshufb, "pshufb %%xmm1, %%xmm0")
+SSE_SNIPPET(pmulld, "pmulld %%xmm1, %%xmm0")
+SSE_SNIPPET(pcmpgtq, "pcmpgtq %%xmm1, %%xmm0")
+SSE_SNIPPET(extrq, "extrq $8, $0, %%xmm0")
+SSE_SNIPPET(pclmulqdq, "pclmulqdq $0, %%xmm1, %%xmm0")
+SSE_SNIPPET(aesenc, "aesenc %%xmm1, %%xmm0")
+SSE_SNIPPET(sha256msg1, "sha256msg1 %%xmm1, %%xmm0")
+SSE_SNIPPET(gf2p8mulb, "gf2p8mulb %%xmm1, %%xmm0")
+
+VEX_SNIPPET(vaddps, "vaddps %%ymm1, %%ymm0, %%ymm0")
+VEX_SNIPPET(vcvtph2ps, "vcvtph2ps %%xmm1, %%ymm0")
+VEX_SNIPPET(vfmadd231ps, "vfmadd231ps %%ymm2, %%ymm1, %%ymm0")
+VEX_SNIPPET(vpaddd, "vpaddd %%ymm1, %%ymm0, %%ymm0")
+VEX_SNIPPET(vaesenc, "vaesenc %%ymm1, %%ymm0, %%ymm0")
+VEX_SNIPPET(vpclmulqdq, "vpclmulqdq $0, %%ymm1, %%ymm0, %%ymm0")
+VEX_SNIPPET(vex_vpdpbusd, "%{vex%} vpdpbusd %%ymm2, %%ymm1, %%ymm0")
+VEX_SNIPPET(vex_vpmadd52luq, "%{vex%} vpmadd52luq %%ymm2, %%ymm1, %%ymm0")
+VEX_SNIPPET(vpdpbssd, "vpdpbssd %%ymm2, %%ymm1, %%ymm0")
+VEX_SNIPPET(vbcstnesh2ps, "vbcstnesh2ps (%1), %%ymm0")
+VEX_SNIPPET(vfmaddps, "vfmaddps %%ymm2, %%ymm1, %%ymm0, %%ymm0")
+VEX_SNIPPET(vprotd, "vprotd %%xmm2, %%xmm1, %%xmm0")
+VEX_SNIPPET(zmm_vpaddd, "vpaddd %%zmm1, %%zmm0, %%zmm0")
+VEX_SNIPPET(vpmullq, "vpmullq %%zmm1, %%zmm0, %%zmm0")
+VEX_SNIPPET(vpaddw, "vpaddw %%zmm1, %%zmm0, %%zmm0")
+VEX_SNIPPET(vplzcntd, "vplzcntd %%zmm1, %%zmm0")
+VEX_SNIPPET(vpabsq, "vpabsq %%ymm1, %%ymm0")
+VEX_SNIPPET(vpmadd52luq, "vpmadd52luq %%zmm2, %%zmm1, %%zmm0")
+VEX_SNIPPET(vpermb, "vpermb %%zmm1, %%zmm2, %%zmm0")
+VEX_SNIPPET(vpshldw, "vpshldw $1, %%zmm1, %%zmm2, %%zmm0")
+VEX_SNIPPET(vpdpbusd, "vpdpbusd %%zmm2, %%zmm1, %%zmm0")
+VEX_SNIPPET(vpopcntb, "vpopcntb %%zmm1, %%zmm0")
+VEX_SNIPPET(vpopcntd, "vpopcntd %%zmm1, %%zmm0")
+VEX_SNIPPET(vdpbf16ps, "vdpbf16ps %%zmm2, %%zmm1, %%zmm0")
+VEX_SNIPPET(vaddph, "vaddph %%zmm1, %%zmm0, %%zmm0")
+
+typedef void (*snippet)(uint64_t iterations, void* data);
+
+/**
+ * @brief An instruction executed to verify a feature.
+ */
+struct feature_snippet {
+    enum cpuidx_feature feature; /**< The feature the instruction needs */
+    snippet run; /**< The snippet */
+    double slow_ns; /**< The time per instruction above which it is deemed trapped or emulated */
+    int (*prepare)(void); /**< A function checking the OS granted the feature to the process, or a null pointer */
+};
+
+static const struct feature_snippet snippets[] = {
+    {CPUIDX_FEATURE_LAHF_LM, lahf, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_POPCNT, popcnt, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_MOVBE, movbe, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_BMI, andn, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_BMI2, pdep, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_ABM, lzcnt, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_ADX, adcx, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_TBM, blcfill, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_RDRND, rdrand, SLOW_RANDOM_NS, NULL},
+    {CPUIDX_FEATURE_RDSEED, rdseed, SLOW_RANDOM_NS, NULL},
+    {CPUIDX_FEATURE_RDPID, rdpid, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_RDTSCP, rdtscp, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_FSGSBASE, rdfsbase, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_OSPKE, rdpkru, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_SERIALIZE, serialize, SLOW_SERIALIZING_NS, NULL},
+    {CPUIDX_FEATURE_PRFCHW, prefetchw, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_CLFLUSHOPT, clflushopt, SLOW_SERIALIZING_NS, NULL},
+    {CPUIDX_FEATURE_CLWB, clwb, SLOW_SERIALIZING_NS, NULL},
+    {CPUIDX_FEATURE_CLDEMOTE, cldemote, SLOW_SERIALIZING_NS, NULL},
+    {CPUIDX_FEATURE_MOVDIRI, movdiri, SLOW_SERIALIZING_NS, NULL},
+    {CPUIDX_FEATURE_MOVDIR64B, movdir64b, SLOW_SERIALIZING_NS, NULL},
+    {CPUIDX_FEATURE_WAITPKG, tpause, SLOW_SERIALIZING_NS, NULL},
+    {CPUIDX_FEATURE_RTM, xbegin, SLOW_SERIALIZING_NS, NULL},
+    {CPUIDX_FEATURE_AMXTILE, tilerelease, SLOW_NS, cpuidx_amx_permitted},
+    {CPUIDX_FEATURE_SSE3, addsubps, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_SSSE3, pshufb, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_SSE41, pmulld, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_SSE42, pcmpgtq, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_SSE4a, extrq, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_PCLMULQDQ, pclmulqdq, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_AESNI, aesenc, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_SHA, sha256msg1, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_GFNI, gf2p8mulb, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_AVX, vaddps, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_F16C, vcvtph2ps, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_FMA, vfmadd231ps, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_AVX2, vpaddd, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_VAES, vaesenc, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_VPCLMULQDQ, vpclmulqdq, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_AVXVNNI, vex_vpdpbusd, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_AVXIFMA, vex_vpmadd52luq, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_AVXVNNIINT8, vpdpbssd, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_AVXNECONVERT, vbcstnesh2ps, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_FMA4, vfmaddps, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_XOP, vprotd, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_AVX512F, zmm_vpaddd, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_AVX512DQ, vpmullq, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_AVX512BW, vpaddw, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_AVX512CD, vplzcntd, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_AVX512VL, vpabsq, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_AVX512IFMA, vpmadd52luq, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_AVX512VBMI, vpermb, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_AVX512VBMI2, vpshldw, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_AVX512VNNI, vpdpbusd, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_AVX512BITALG, vpopcntb, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_AVX512VPOPCNTDQ, vpopcntd, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_AVX512BF16, vdpbf16ps, SLOW_NS, NULL},
+    {CPUIDX_FEATURE_AVX512FP16, vaddph, SLOW_NS, NULL},
+};
+
+#define SNIPPET_COUNT (sizeof(snippets) / sizeof(snippets[0]))
+
+_Static_assert(SNIPPET_COUNT <= CPUIDX_MAX_FEATURE_CHECKS, "CPUIDX_MAX_FEATURE_CHECKS is too small");
+
+static const int fault_signals[] = {SIGILL, SIGSEGV, SIGBUS, SIGFPE};
+
+#define FAULT_SIGNAL_COUNT (sizeof(fault_signals) / sizeof(fault_signals[0]))
+
+static struct sigaction previous_actions[FAULT_SIGNAL_COUNT];
+static _Thread_local sigjmp_buf fault_jump;
+static _Thread_local volatile sig_atomic_t guarded;
+// Held while the handlers are replaced, so that a concurrent self-test does not save them as the previous ones
+static long self_test_lock;
+
+/**
+ * Function to handle a fault: back to the guarded snippet if the faulting thread runs one, and otherwise
+ * to the previous handler, called in place so that the snippets of the self-test stay guarded.
+ * Without a previous handler, the default action is restored, and the faulting instruction raises the signal
+ * again on return.
+ */
+static void on_fault(const int signal, siginfo_t* info, void* context) {
+    if (guarded) {
+        guarded = 0;
+        siglongjmp(fault_jump, signal);
+    }
+
+    for (size_t i = 0; i < FAULT_SIGNAL_COUNT; ++i) {
+        if (fault_signals[i] != signal) continue;
+
+        const struct sigaction* previous = &previous_actions[i];
+        if (previous->sa_flags & SA_SIGINFO) previous->sa_sigaction(signal, info, context);
+        else if (previous->sa_handler != SIG_DFL && previous->sa_handler != SIG_IGN) previous->sa_handler(signal);
+        else sigaction(signal, previous, NULL);
+    }
+}
+
+/**
+ * Function to run a snippet, catching the signal it may raise.
+ *
+ * @return 0 if the snippet ran to completion, or the signal it raised.
+ */
+static int run_guarded(const snippet run, const uint64_t iterations, void* data) {
+    const int signal = sigsetjmp(fault_jump, 1);
+    if (signal) return signal;
+
+    guarded = 1;
+    run(iterations, data);
+    guarded = 0;
+    return 0;
+}
+
+/**
+ * Function to time the fastest of several runs of a snippet.
+ *
+ * @return The time per instruction in nanoseconds.
+ */
+static double best_ns(const snippet run, void* data) {
+    uint64_t best = UINT64_MAX;
+
+    for (int i = 0; i < REPETITIONS; ++i) {
+        const uint64_t start = cpuidx_monotonic_ns();
+        run(ITERATIONS, data);
+        const uint64_t elapsed = cpuidx_monotonic_ns() - start;
+        if (elapsed < best) best = elapsed;
+    }
+    return (double) best / (ITERATIONS * 8);
+}
+#endif
+
+/**
+ * Function to verify that the detected features execute, natively.
+ *
+ * Hypervisors may advertise features that then fault, e.g. a CPUID bit passed through for a state component
+ * the guest cannot enable, or that they trap and emulate at a hundred times the cost. For each detected feature
+ * with a snippet, one instruction of the feature runs under a SIGILL, SIGSEGV, SIGBUS and SIGFPE guard, then is
+ * timed; taking longer than the \p slow_ns of the check means a VM exit or a trap on each execution.
+ * Features that faulted or were slow are cleared from \p usable. Features without a snippet, or whose state the
+ * OS does not grant (AMX without the permission), are kept as detected, with the verdict
+ * \p CPUIDX_VERDICT_UNTESTED. The AMX permission is not requested: call \p cpuidx_amx_enable first to test AMX.
+ * The signal handlers are replaced while the snippets run, and faults of other threads in that window are passed
+ * to the previous handlers. Concurrent calls run one after the other. Takes a few milliseconds.
+ *
+ * @param report A pointer to a \p cpuidx_self_test_report structure to store the verdicts.
+ * @return 0 on success, -1 if the self-test is not available for this compiler, architecture or OS.
+ */
+int cpuidx_run_self_test(cpuidx_self_test_report* report) {
+    return cpuidx_self_test_features(cpuidx_cached_features(), report);
+}
+
+/**
+ * Function to run the self-test of \p cpuidx_run_self_test on the given features, rather than the cached ones,
+ * which come from the snapshot that \p cpuidzd is about to replace.
+ *
+ * @param features The detected features to verify.
+ * @param report A pointer to a \p cpuidx_self_test_report structure to store the verdicts.
+ * @return 0 on success, -1 if the self-test is not available for this compiler, architecture or OS.
+ */
+int cpuidx_self_test_features(const cpu_features* CPUIDX_RESTRICT features,
+                              cpuidx_self_test_report* CPUIDX_RESTRICT report) {
+    memset(report, 0, sizeof(*report));
+    memcpy(&report->usable, features, sizeof(report->usable));
+
+#ifdef CPUIDX_SELF_TEST_AVAILABLE
+    const bool* detected = (const bool*) features;
+    bool* usable = (bool*) &report->usable;
+    // Room for the direct stores of MOVDIR64B, and the loads of the other snippets
+    _Alignas(64) unsigned char data[128] = {0};
+    struct sigaction action;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = on_fault;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+
+    while (CPUIDX_EXCHANGE(&self_test_lock, 1)) CPUIDX_PAUSE();
+    for (size_t i = 0; i < FAULT_SIGNAL_COUNT; ++i) sigaction(fault_signals[i], &action, &previous_actions[i]);
+
+    for (size_t i = 0; i < SNIPPET_COUNT; ++i) {
+        const struct feature_snippet* test = &snippets[i];
+        if (!detected[test->feature]) continue;
+
+        cpuidx_feature_check* check = &report->checks[report->check_count++];
+        check->feature = test->feature;
+        check->slow_ns = test->slow_ns;
+        check->ns = -1;
+
+        if (test->prepare && test->prepare() != 0) continue;
+
+        // A single iteration first, so that a faulting instruction is not timed
+        check->signal = run_guarded(test->run, 1, data);
+
+        if (check->signal) {
+            check->verdict = CPUIDX_VERDICT_FAULTED;
+            usable[test->feature] = false;
+            ++report->faulted;
+        } else if ((check->ns = best_ns(test->run, data)) > test->slow_ns) {
+            check->verdict = CPUIDX_VERDICT_SLOW;
+            usable[test->feature] = false;
+            ++report->slow;
+        } else {
+            check->verdict = CPUIDX_VERDICT_USABLE;
+        }
+    }
+
+    for (size_t i = 0; i < FAULT_SIGNAL_COUNT; ++i) sigaction(fault_signals[i], &previous_actions[i], NULL);
+    CPUIDX_STORE_RELEASE(&self_test_lock, 0);
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+static cpu_features verified_features;
+static long verified_claimed;
+static long verified_ready;
+
+/**
+ * Function to get the detected features that execute natively, verified once per process.
+ *
+ * The first caller loads them from the snapshot of \p cpuidzd, which runs \p cpuidx_run_self_test once per boot,
+ * or else runs it, and concurrent callers wait for the result. Dispatching on
+ * these rather than \p cpuidx_cached_features turns a CPUID bit the hypervisor cannot honor into the fallback
+ * path, instead of a crash loop or a silent slowdown.
+ *
+ * @return A pointer to the verified features, the detected ones where the self-test is not available.
+ */
+const cpu_features* cpuidx_verified_features(void) {
+    if (CPUIDX_LOAD_ACQUIRE(&verified_ready)) return &verified_features;
+
+    if (CPUIDX_EXCHANGE(&verified_claimed, 1) == 0) {
+        if (cpuidx_snapshot_verified_features(&verified_features) != 0) {
+            cpuidx_self_test_report report;
+
+            cpuidx_run_self_test(&report);
+            verified_features = report.usable;
+        }
+        CPUIDX_STORE_RELEASE(&verified_ready, 1);
+    } else {
+        while (!CPUIDX_LOAD_ACQUIRE(&verified_ready)) CPUIDX_PAUSE();
+    }
+    return &verified_features;
+}
@@ -0,0 +1,587 @@
+#if defined(__linux__)
+#define _GNU_SOURCE // For secure_getenv
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "cpuidx_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SNAPSHOT_MAGIC 0x53584443u // "CDXS"
+// Bump on every change of the layout, including reordered fields of the same size, which the sizes miss
+#define SNAPSHOT_VERSION 5u
+
+// Bounds the snapshot to the CPUs a cpu_set_t can pin
+#define MAX_CPUS 1024
+
+// Reads retried while the snapshot is being rewritten
+#define SEQLOCK_RETRIES 1000
+
+// AMD topology extensions, leaves 0x8000001D and 0x8000001E (0x80000001 ECX bit 22)
+#define TOPOEXT 0x00400000
+
+/**
+ * @brief The layout of a snapshot file.
+ *
+ * The sizes of the structures version the layout together with \p version, so that a snapshot written by
+ * a build with different structures is ignored rather than misread. Sizes alone miss reordered fields.
+ * Readers copy the data between two reads of \p sequence, which the writer makes odd while it rewrites the file.
+ */
+struct snapshot {
+    uint32_t magic; /**< SNAPSHOT_MAGIC */
+    uint32_t version; /**< SNAPSHOT_VERSION */
+    uint32_t sequence; /**< Seqlock sequence, odd while the data is being written */
+    uint32_t basic_info_size; /**< sizeof(cpu_basic_info) */
+    uint32_t features_size; /**< sizeof(cpu_features) */
+    uint32_t caches_size; /**< sizeof(cpuidx_cache_info) */
+    uint32_t topology_size; /**< sizeof(cpuidx_cpu_topology) */
+    uint32_t cpu_count; /**< Number of entries of cpus */
+    char boot_id[40]; /**< The boot of the kernel the snapshot was captured on */
+    cpu_basic_info basic_info;
+    cpu_features features;
+    cpu_features verified; /**< The features that cpuidx_run_self_test saw execute natively */
+    cpuidx_cache_info caches;
+    cpuidx_cpu_topology cpus[]; /**< The logical CPUs online at capture, by CPU number */
+};
+
+/**
+ * Function to get the ID of the current boot of the kernel, to reject snapshots of a previous boot.
+ *
+ * @return 0 on success, -1 if unavailable.
+ */
+static int read_boot_id(char boot_id[40]) {
+    if (cpuidx_read_file("/proc/sys/kernel/random/boot_id", boot_id, 40) != 0) return -1;
+    boot_id[strcspn(boot_id, "\n")] = '\0';
+    return boot_id[0] ? 0 : -1;
+}
+
+static uint32_t ceil_log2(const uint32_t count) {
+    uint32_t shift = 0;
+    while (shift < 32 && (1u << shift) < count) ++shift;
+    return shift;
+}
+
+static bool amd_vendor(const cpu_basic_info* basic_info) {
+    return strcmp(basic_info->vendor, "AuthenticAMD") == 0 || strcmp(basic_info->vendor, "HygonGenuine") == 0;
+}
+
+/**
+ * Function to find the L3 in the cache parameters leaf (4, or 0x8000001D on AMD).
+ *
+ * @return The number of logical CPUs sharing the L3 (EAX bits 25:14, plus 1), or 0 without an L3.
+ */
+static uint32_t l3_sharing(const cpu_basic_info* basic_info, const bool amd) {
+    uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+    const uint32_t leaf = amd ? 0x8000001d : 0x4;
+
+    if ((amd ? basic_info->highest_extended_leaf : basic_info->highest_basic_leaf) < leaf) return 0;
+
+    for (uint32_t sub_leaf = 0; sub_leaf < 8; ++sub_leaf) {
+        cpuid_extended(leaf, sub_leaf, registers);
+        if (!(registers[0] & 0x1f)) break;
+        if ((registers[0] >> 5 & 0x7) == 3) return (registers[0] >> 14 & 0xfff) + 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief The levels of the AMD extended CPU topology leaf 0x80000026, as x2APIC ID shifts and CPU counts.
+ */
+struct amd_levels {
+    uint32_t x2apic_id; /**< Extended APIC ID (EDX) */
+    uint32_t ccx_shift; /**< Shift to the ID of the core complex (level type 2) */
+    uint32_t ccd_shift; /**< Shift to the ID of the die (level type 3) */
+    uint32_t ccx_threads; /**< Logical CPUs of the core complex */
+    uint32_t ccd_threads; /**< Logical CPUs of the die */
+};
+
+/**
+ * Function to read the levels of leaf 0x80000026, on Zen 4 and later.
+ *
+ * @return true if the leaf enumerates a core complex level.
+ */
+static bool read_amd_levels(const cpu_basic_info* basic_info, struct amd_levels* levels) {
+    uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+
+    memset(levels, 0, sizeof(*levels));
+    if (basic_info->highest_extended_leaf < 0x80000026) return false;
+
+    // Each sub-leaf is a level: ECX bits 15:8 is its type (1: core, 2: complex, 3: die, 4: socket),
+    // EAX bits 4:0 the shift to the ID of the unit at that level, EBX bits 15:0 its logical CPUs
+    for (uint32_t sub_leaf = 0; sub_leaf < 8; ++sub_leaf) {
+        cpuid_extended(0x80000026, sub_leaf, registers);
+        const uint32_t type = registers[2] >> 8 & 0xff;
+        if (!type) break;
+
+        levels->x2apic_id = registers[3];
+        if (type == 2) {
+            levels->ccx_shift = registers[0] & 0x1f;
+            levels->ccx_threads = registers[1] & 0xffff;
+        } else if (type == 3) {
+            levels->ccd_shift = registers[0] & 0x1f;
+            levels->ccd_threads = registers[1] & 0xffff;
+        }
+    }
+    return levels->ccx_threads != 0;
+}
+
+/**
+ * Function to read the topology of the logical CPU the calling thread runs on.
+ */
+static void read_topology(const cpu_basic_info* basic_info, const cpu_features* features, const int cpu,
+                          cpuidx_cpu_topology* topology) {
+    uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+    uint32_t leaf = 0xb;
+    const bool amd = amd_vendor(basic_info);
+    uint32_t smt_shift = 0, package_shift = 0;
+    bool amd_core = false;
+
+    memset(topology, 0, sizeof(*topology));
+    topology->cpu = (uint32_t) cpu;
+
+    // Leaf 0x1F when it enumerates levels: some hypervisors report it with no logical CPU (EBX 0 in sub-leaf 0)
+    if (basic_info->highest_basic_leaf >= 0x1f) {
+        cpuid_extended(0x1f, 0, registers);
+        if (registers[1] & 0xffff) leaf = 0x1f;
+    }
+
+    if (basic_info->highest_basic_leaf >= leaf) {
+        // Each sub-leaf is a level: ECX bits 15:8 is its type (1: SMT), EAX bits 4:0 the shift to the next level
+        for (uint32_t sub_leaf = 0; sub_leaf < 8; ++sub_leaf) {
+            cpuid_extended(leaf, sub_leaf, registers);
+            if (!(registers[2] >> 8 & 0xff)) break;
+
+            if ((registers[2] >> 8 & 0xff) == 1) smt_shift = registers[0] & 0x1f;
+            package_shift = registers[0] & 0x1f;
+            topology->x2apic_id = registers[3];
+        }
+    }
+
+    const bool x2apic_levels = package_shift != 0;
+    if (!x2apic_levels) {
+        // Initial APIC ID: leaf 1 EBX bits 31:24
+        cpuid(1, registers);
+        topology->x2apic_id = registers[1] >> 24;
+
+        // AMD before leaf 0xB: the APIC ID size (0x80000008 ECX bits 15:12), or the thread count (bits 7:0)
+        if (amd && basic_info->highest_extended_leaf >= 0x80000008) {
+            cpuid(0x80000008, registers);
+            package_shift = registers[2] >> 12 & 0xf;
+            if (!package_shift) package_shift = ceil_log2((registers[2] & 0xff) + 1);
+        }
+    }
+
+    // AMD compute unit: 0x8000001E EBX bits 7:0 is the core ID and bits 15:8 the threads per core minus 1,
+    // ECX bits 7:0 the node ID. The leaf is defined with TOPOEXT (0x80000001 ECX bit 22).
+    if (amd && basic_info->highest_extended_leaf >= 0x8000001e) {
+        cpuid(0x80000001, registers);
+        if (registers[2] & TOPOEXT) {
+            cpuid(0x8000001e, registers);
+            topology->node = registers[2] & 0xff;
+
+            // Without leaf 0xB, the x2APIC ID gives neither the threads of a compute unit nor its ID
+            if (!x2apic_levels) {
+                smt_shift = ceil_log2((registers[1] >> 8 & 0xff) + 1);
+                topology->core = registers[1] & 0xff;
+                amd_core = true;
+            }
+        }
+    }
+
+    topology->thread = topology->x2apic_id & ((1u << smt_shift) - 1);
+    if (!amd_core) {
+        topology->core = package_shift ? (topology->x2apic_id & ((1u << package_shift) - 1)) >> smt_shift
+                                       : topology->x2apic_id;
+    }
+    topology->package = package_shift ? topology->x2apic_id >> package_shift : 0;
+
+    // Core complexes: the levels of 0x80000026, or else the CPUs sharing the L3, and dies only from 0x80000026
+    struct amd_levels levels;
+    if (amd && read_amd_levels(basic_info, &levels)) {
+        topology->ccx = levels.x2apic_id >> levels.ccx_shift;
+        topology->ccd = levels.ccd_threads ? levels.x2apic_id >> levels.ccd_shift : topology->ccx;
+    } else {
+        const uint32_t sharing = l3_sharing(basic_info, amd);
+        topology->ccx = sharing ? topology->x2apic_id >> ceil_log2(sharing) : topology->package;
+        topology->ccd = topology->ccx;
+    }
+
+    // Native model ID and core type: leaf 0x1A EAX bits 31:24
+    if (features->HYBRID && basic_info->highest_basic_leaf >= 0x1a) {
+        cpuid_extended(0x1a, 0, registers);
+        topology->core_type = registers[0] >> 24;
+    }
+}
+
+/**
+ * Function to read the topology of each online logical CPU, by running on each of them.
+ *
+ * @return The number of CPUs read, up to \p count.
+ */
+static size_t capture_topology(const cpu_basic_info* basic_info, const cpu_features* features,
+                               cpuidx_cpu_topology* cpus, const size_t count) {
+    size_t found = 0;
+
+#if defined(__linux__)
+    const long configured = sysconf(_SC_NPROCESSORS_CONF);
+
+    for (int cpu = 0; cpu < configured && cpu < MAX_CPUS && found < count; ++cpu) {
+        // Offline CPUs, and those outside the affinity of the process, cannot be pinned
+        if (cpuidx_pin_thread(cpu) != 0) continue;
+        read_topology(basic_info, features, cpu, &cpus[found++]);
+        cpuidx_unpin_thread();
+    }
+#endif
+
+    // Without pinning, the CPU running the caller stands for all
+    if (!found && count) read_topology(basic_info, features, 0, &cpus[found++]);
+    return found;
+}
+
+#if defined(__linux__)
+static const struct snapshot* mapped;
+static size_t mapped_size;
+static long map_claimed;
+static long map_ready;
+
+/**
+ * Function to get the path of the snapshot: \p CPUIDX_SNAPSHOT if set, and \p CPUIDX_SNAPSHOT_PATH otherwise.
+ *
+ * @return The path, or a null pointer if \p CPUIDX_SNAPSHOT is empty, which disables the snapshot.
+ */
+static const char* snapshot_path(void) {
+    const char* path = secure_getenv("CPUIDX_SNAPSHOT");
+
+    if (!path) return CPUIDX_SNAPSHOT_PATH;
+    return path[0] ? path : NULL;
+}
+
+/**
+ * Function to check that a snapshot has the layout of this build.
+ */
+static bool valid_layout(const struct snapshot* snapshot, const size_t size) {
+    return size >= sizeof(*snapshot) && snapshot->magic == SNAPSHOT_MAGIC && snapshot->version == SNAPSHOT_VERSION &&
+           snapshot->basic_info_size == sizeof(cpu_basic_info) && snapshot->features_size == sizeof(cpu_features) &&
+           snapshot->caches_size == sizeof(cpuidx_cache_info) &&
+           snapshot->topology_size == sizeof(cpuidx_cpu_topology) && snapshot->cpu_count <= MAX_CPUS &&
+           size >= sizeof(*snapshot) + snapshot->cpu_count * sizeof(cpuidx_cpu_topology);
+}
+
+/**
+ * Function to check that a mapped snapshot was captured since the last boot, by a build with the same layout.
+ */
+static bool valid_snapshot(const struct snapshot* snapshot, const size_t size) {
+    char boot_id[40];
+
+    return valid_layout(snapshot, size) && read_boot_id(boot_id) == 0 &&
+           strncmp(boot_id, snapshot->boot_id, sizeof(boot_id)) == 0;
+}
+
+/**
+ * Function to map the snapshot once per process.
+ *
+ * @return A pointer to the mapped snapshot, or a null pointer if there is no valid snapshot.
+ */
+static const struct snapshot* map_snapshot(void) {
+    if (CPUIDX_LOAD_ACQUIRE(&map_ready)) return mapped;
+
+    if (CPUIDX_EXCHANGE(&map_claimed, 1) == 0) {
+        const char* path = snapshot_path();
+        const int fd = path ? open(path, O_RDONLY | O_CLOEXEC) : -1;
+        struct stat status;
+
+        if (fd >= 0 && fstat(fd, &status) == 0 && status.st_size > 0) {
+            void* memory = mmap(NULL, (size_t) status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+            if (memory != MAP_FAILED && valid_snapshot(memory, (size_t) status.st_size)) {
+                mapped = memory;
+                mapped_size = (size_t) status.st_size;
+            } else if (memory != MAP_FAILED) {
+                munmap(memory, (size_t) status.st_size);
+            }
+        }
+        if (fd >= 0) close(fd);
+        CPUIDX_STORE_RELEASE(&map_ready, 1);
+    } else {
+        while (!CPUIDX_LOAD_ACQUIRE(&map_ready)) CPUIDX_PAUSE();
+    }
+    return mapped;
+}
+
+/**
+ * Function to copy the start of the mapped snapshot, consistently with a concurrent rewrite.
+ *
+ * @param destination The buffer to copy to.
+ * @param size The number of bytes to copy, at least the header, at most the mapping.
+ * @return 0 on success, -1 if the snapshot kept changing.
+ */
+static int read_consistent(struct snapshot* destination, const size_t size) {
+    for (int attempt = 0; attempt < SEQLOCK_RETRIES; ++attempt) {
+        const uint32_t begin = __atomic_load_n(&mapped->sequence, __ATOMIC_ACQUIRE);
+
+        if (begin & 1) {
+            CPUIDX_PAUSE();
+            continue;
+        }
+        memcpy(destination, mapped, size);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        // A rewrite in place keeps the size of the file, but may come from another build
+        if (__atomic_load_n(&mapped->sequence, __ATOMIC_RELAXED) == begin)
+            return valid_layout(destination, mapped_size) ? 0 : -1;
+    }
+    return -1;
+}
+#endif
+
+/**
+ * Function to load the features from the snapshot published by \p cpuidzd, rather than by CPUID.
+ *
+ * @param features A pointer to a \p cpu_features structure to store the features.
+ * @param basic_info A pointer to a \p cpu_basic_info structure to store the basic CPU information.
+ * @return 0 on success, -1 if there is no valid snapshot.
+ */
+int cpuidx_snapshot_features(cpu_features* CPUIDX_RESTRICT features, cpu_basic_info* CPUIDX_RESTRICT basic_info) {
+#if defined(__linux__)
+    struct snapshot header;
+
+    if (!map_snapshot() || read_consistent(&header, sizeof(header)) != 0) return -1;
+
+    *features = header.features;
+    *basic_info = header.basic_info;
+    return 0;
+#else
+    (void) features;
+    (void) basic_info;
+    return -1;
+#endif
+}
+
+/**
+ * Function to load the features verified by the self-test from the snapshot published by \p cpuidzd,
+ * so that the self-test runs once per boot rather than once per process.
+ *
+ * @param features A pointer to a \p cpu_features structure to store the verified features.
+ * @return 0 on success, -1 if there is no valid snapshot.
+ */
+int cpuidx_snapshot_verified_features(cpu_features* features) {
+#if defined(__linux__)
+    struct snapshot header;
+
+    if (!map_snapshot() || read_consistent(&header, sizeof(header)) != 0) return -1;
+
+    *features = header.verified;
+    return 0;
+#else
+    (void) features;
+    return -1;
+#endif
+}
+
+/**
+ * Function to load the caches from the snapshot published by \p cpuidzd.
+ *
+ * @param caches A pointer to a \p cpuidx_cache_info structure to store the caches.
+ * @return 0 on success, -1 if there is no valid snapshot.
+ */
+int cpuidx_snapshot_caches(cpuidx_cache_info* caches) {
+#if defined(__linux__)
+    struct snapshot header;
+
+    if (!map_snapshot() || read_consistent(&header, sizeof(header)) != 0) return -1;
+
+    *caches = header.caches;
+    return 0;
+#else
+    (void) caches;
+    return -1;
+#endif
+}
+
+/**
+ * Function to load the topology from the snapshot published by \p cpuidzd, without running on any CPU.
+ *
+ * @param cpus An array to store the topology of up to \p count CPUs, may be null if \p count is 0.
+ * @param count The size of the array.
+ * @return The number of CPUs of the snapshot, which may exceed \p count, or 0 if there is no valid snapshot.
+ */
+size_t cpuidx_snapshot_topology(cpuidx_cpu_topology* cpus, const size_t count) {
+#if defined(__linux__)
+    const size_t copy_size = sizeof(struct snapshot) + MAX_CPUS * sizeof(*cpus);
+    struct snapshot* copy;
+    size_t found = 0;
+
+    if (!map_snapshot() || !(copy = malloc(copy_size))) return 0;
+
+    if (read_consistent(copy, mapped_size < copy_size ? mapped_size : copy_size) == 0) {
+        found = copy->cpu_count;
+        if (count) memcpy(cpus, copy->cpus, (found < count ? found : count) * sizeof(*cpus));
+    }
+    free(copy);
+    return found;
+#else
+    (void) cpus;
+    (void) count;
+    return 0;
+#endif
+}
+
+/**
+ * Function to get the topology of the online logical CPUs.
+ *
+ * Reads the snapshot published by \p cpuidzd when there is one, and otherwise runs CPUID leaf 0x1F or 0xB
+ * on each CPU, which takes a migration per CPU.
+ *
+ * @param cpus An array to store the topology of up to \p count CPUs, may be null if \p count is 0.
+ * @param count The size of the array.
+ * @return The number of online CPUs, which may exceed \p count.
+ */
+size_t cpuidx_get_topology(cpuidx_cpu_topology* cpus, const size_t count) {
+    size_t found = cpuidx_snapshot_topology(cpus, count);
+    if (found) return found;
+
+    cpuidx_cpu_topology* captured = malloc(MAX_CPUS * sizeof(*captured));
+    if (!captured) return 0;
+
+    found = capture_topology(cpuidx_cached_basic_info(), cpuidx_cached_features(), captured, MAX_CPUS);
+    if (count) memcpy(cpus, captured, (found < count ? found : count) * sizeof(*cpus));
+    free(captured);
+    return found;
+}
+
+/**
+ * Function to get the package topology of AMD CPUs, from the leaves of the running CPU.
+ *
+ * The core complexes (CCX) share an L3, which on EPYC and Ryzen is split between them: threads exchanging data
+ * run best within a CCX. The \p ccx and \p ccd fields of \p cpuidx_get_topology group the CPUs accordingly.
+ *
+ * @param topology A pointer to a \p cpuidx_amd_topology structure to store the topology.
+ * @return 0 on success, -1 if the CPU is not an AMD or Hygon CPU with leaf 0x80000008.
+ */
+int cpuidx_get_amd_topology(cpuidx_amd_topology* topology) {
+    const cpu_basic_info* basic_info = cpuidx_cached_basic_info();
+    uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+    struct amd_levels levels;
+
+    memset(topology, 0, sizeof(*topology));
+    if (!amd_vendor(basic_info) || basic_info->highest_extended_leaf < 0x80000008) return -1;
+
+    // NC: ECX bits 7:0, ApicIdSize: ECX bits 15:12
+    cpuid(0x80000008, registers);
+    topology->threads_per_package = (registers[2] & 0xff) + 1;
+    topology->apic_id_size = registers[2] >> 12 & 0xf;
+    topology->threads_per_core = 1;
+    topology->nodes_per_package = 1;
+
+    if (basic_info->highest_extended_leaf >= 0x8000001e) {
+        cpuid(0x80000001, registers);
+        if (registers[2] & TOPOEXT) {
+            cpuid(0x8000001e, registers);
+            topology->threads_per_core = (registers[1] >> 8 & 0xff) + 1;
+            topology->nodes_per_package = (registers[2] >> 8 & 0x7) + 1;
+        }
+    }
+
+    if (read_amd_levels(basic_info, &levels)) {
+        topology->threads_per_ccx = levels.ccx_threads;
+        topology->threads_per_ccd = levels.ccd_threads ? levels.ccd_threads : levels.ccx_threads;
+    } else {
+        topology->threads_per_ccx = l3_sharing(basic_info, true);
+        topology->threads_per_ccd = topology->threads_per_ccx;
+    }
+    return 0;
+}
+
+/**
+ * Function to capture the features, caches and topology of the host, and publish them as a snapshot file
+ * that the library maps in other processes instead of running CPUID.
+ * The snapshot also holds the features that \p cpuidx_run_self_test saw execute natively.
+ * Everything is detected afresh, never read from the snapshot being replaced, which may predate a microcode update.
+ *
+ * A file of the same size is rewritten in place under its seqlock, so that processes which mapped it read
+ * either version. Otherwise, a new file replaces it atomically.
+ *
+ * @param path The path of the snapshot, or a null pointer for \p CPUIDX_SNAPSHOT_PATH. Its directory must exist.
+ * @return The number of CPUs in the snapshot on success, -1 if the host cannot be captured or the file
+ *         cannot be written, -2 if snapshots are not supported on this system.
+ */
+int cpuidx_publish_snapshot(const char* path) {
+#if defined(__linux__)
+    if (!path) path = CPUIDX_SNAPSHOT_PATH;
+
+    cpuidx_cpu_topology* cpus = malloc(MAX_CPUS * sizeof(*cpus));
+    if (!cpus) return -1;
+
+    struct snapshot header = {
+        .magic = SNAPSHOT_MAGIC,
+        .version = SNAPSHOT_VERSION,
+        .basic_info_size = sizeof(cpu_basic_info),
+        .features_size = sizeof(cpu_features),
+        .caches_size = sizeof(cpuidx_cache_info),
+        .topology_size = sizeof(cpuidx_cpu_topology),
+    };
+
+    if (read_boot_id(header.boot_id) != 0 || get_cpu_features(&header.features, &header.basic_info) != 0) {
+        free(cpus);
+        return -1;
+    }
+    cpuidx_self_test_report report;
+    cpuidx_self_test_features(&header.features, &report);
+    header.verified = report.usable;
+
+    cpuidx_detect_cache_info(&header.basic_info, &header.caches);
+    header.cpu_count = (uint32_t) capture_topology(&header.basic_info, &header.features, cpus, MAX_CPUS);
+
+    const size_t topology_size = header.cpu_count * sizeof(*cpus);
+    const size_t size = sizeof(header) + topology_size;
+    int result = -1;
+    struct stat status;
+
+    // In place: make the sequence odd, rewrite everything after it, and make it even again
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd >= 0 && fstat(fd, &status) == 0 && (size_t) status.st_size == size) {
+        void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+        if (memory != MAP_FAILED) {
+            struct snapshot* snapshot = memory;
+            const uint32_t sequence = (__atomic_load_n(&snapshot->sequence, __ATOMIC_RELAXED) | 1) + 2;
+
+            __atomic_store_n(&snapshot->sequence, sequence, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+            memcpy(memory, &header, offsetof(struct snapshot, sequence));
+            memcpy(&snapshot->basic_info_size, &header.basic_info_size,
+                   sizeof(header) - offsetof(struct snapshot, basic_info_size));
+            memcpy(snapshot->cpus, cpus, topology_size);
+            __atomic_store_n(&snapshot->sequence, sequence + 1, __ATOMIC_RELEASE);
+
+            result = msync(memory, size, MS_SYNC) == 0 ? (int) header.cpu_count : -1;
+            munmap(memory, size);
+        }
+    }
+    if (fd >= 0) close(fd);
+
+    // Otherwise: write a new file, and rename it over the old one
+    if (result < 0) {
+        char temporary[4096];
+
+        if (snprintf(temporary, sizeof(temporary), "%s.XXXXXX", path) < (int) sizeof(temporary) &&
+            (fd = mkstemp(temporary)) >= 0) {
+            const bool written = write(fd, &header, sizeof(header)) == (ssize_t) sizeof(header) &&
+                                 write(fd, cpus, topology_size) == (ssize_t) topology_size &&
+                                 fchmod(fd, 0644) == 0 && fsync(fd) == 0;
+
+            if (close(fd) == 0 && written && rename(temporary, path) == 0) result = (int) header.cpu_count;
+            else unlink(temporary);
+        }
+    }
+
+    free(cpus);
+    return result;
+#else
+    (void) path;
+    return -2;
+#endif
+}
@@ -0,0 +1,199 @@
+#if defined(__linux__)
+#define _GNU_SOURCE // For sched_setaffinity and pread
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include "cpuidx_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
+/**
+ * Function to read a monotonic clock.
+ *
+ * @return The time in nanoseconds since an unspecified starting point.
+ */
+uint64_t cpuidx_monotonic_ns(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    if (!frequency.QuadPart) QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t) counter.QuadPart / (uint64_t) frequency.QuadPart * 1000000000u +
+           (uint64_t) counter.QuadPart % (uint64_t) frequency.QuadPart * 1000000000u / (uint64_t) frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+#endif
+}
+
+// Cached in kHz, to fit the atomic helpers
+static long tsc_khz;
+
+/**
+ * Function to get the frequency of the time-stamp counter.
+ *
+ * Uses the TSC and crystal clock ratio of CPUID leaf 0x15 when fully enumerated, and otherwise calibrates
+ * the TSC against the monotonic clock for 20 ms. The result is cached.
+ *
+ * @return The frequency in Hz, to the kHz.
+ */
+uint64_t cpuidx_tsc_frequency(void) {
+    const long khz = CPUIDX_LOAD_ACQUIRE(&tsc_khz);
+    if (khz) return (uint64_t) khz * 1000u;
+
+    uint64_t frequency = 0;
+
+    if (cpuidx_cached_basic_info()->highest_basic_leaf >= 0x15) {
+        uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+
+        // TSC frequency = crystal frequency (ECX) * EBX / EAX
+        cpuid(0x15, registers);
+        if (registers[0] && registers[1] && registers[2])
+            frequency = (uint64_t) registers[2] * registers[1] / registers[0];
+    }
+
+    if (!frequency) {
+        const uint64_t start_ns = cpuidx_monotonic_ns();
+        const uint64_t start = CPUIDX_RDTSC();
+        uint64_t elapsed_ns;
+
+        while ((elapsed_ns = cpuidx_monotonic_ns() - start_ns) < 20000000u) CPUIDX_PAUSE();
+        frequency = (CPUIDX_RDTSC() - start) * 1000000000u / elapsed_ns;
+    }
+
+    CPUIDX_STORE_RELEASE(&tsc_khz, (long) (frequency / 1000u));
+    return frequency / 1000u * 1000u;
+}
+
+#if defined(__linux__)
+static THREAD_LOCAL cpu_set_t saved_affinity;
+#elif defined(_WIN32)
+static THREAD_LOCAL DWORD_PTR saved_affinity;
+#endif
+static THREAD_LOCAL bool pinned;
+
+/**
+ * Function to pin the calling thread to a CPU, saving its affinity for \p cpuidx_unpin_thread.
+ *
+ * @param cpu The logical CPU, as numbered by the OS.
+ * @return 0 on success, -1 if the CPU does not exist, is not allowed, or pinning is not supported.
+ */
+int cpuidx_pin_thread(const int cpu) {
+    if (cpu < 0 || pinned) return -1;
+
+#if defined(__linux__)
+    cpu_set_t set;
+
+    if (cpu >= CPU_SETSIZE || sched_getaffinity(0, sizeof(saved_affinity), &saved_affinity) != 0) return -1;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) return -1;
+#elif defined(_WIN32)
+    if (cpu >= (int) (sizeof(DWORD_PTR) * 8)) return -1;
+    if (!(saved_affinity = SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) 1 << cpu))) return -1;
+#else
+    return -1;
+#endif
+
+    pinned = true;
+    return 0;
+}
+
+/**
+ * Function to restore the affinity of the calling thread saved by \p cpuidx_pin_thread.
+ */
+void cpuidx_unpin_thread(void) {
+    if (!pinned) return;
+
+#if defined(__linux__)
+    sched_setaffinity(0, sizeof(saved_affinity), &saved_affinity);
+#elif defined(_WIN32)
+    SetThreadAffinityMask(GetCurrentThread(), saved_affinity);
+#endif
+    pinned = false;
+}
+
+/**
+ * Function to read a model-specific register through the Linux msr driver.
+ *
+ * Needs the msr module, and the CAP_SYS_RAWIO capability.
+ *
+ * @param cpu The logical CPU to read the register of.
+ * @param msr The address of the register.
+ * @param value A pointer to store the value of the register.
+ * @return 0 on success, -1 if the register is not readable.
+ */
+int cpuidx_read_msr(const int cpu, const uint32_t msr, uint64_t* value) {
+#if defined(__linux__)
+    char path[32];
+    snprintf(path, sizeof(path), "/dev/cpu/%d/msr", cpu);
+
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    const ssize_t size = pread(fd, value, sizeof(*value), msr);
+    close(fd);
+    return size == (ssize_t) sizeof(*value) ? 0 : -1;
+#else
+    (void) cpu;
+    (void) msr;
+    (void) value;
+    return -1;
+#endif
+}
+
+/**
+ * Function to read a small text file, e.g. from sysfs or procfs.
+ *
+ * @param path The path of the file.
+ * @param buffer The buffer to read into. The text is truncated to fit, and always null-terminated.
+ * @param size The size of the buffer, at least 1.
+ * @return 0 on success, -1 if the file is unreadable.
+ */
+int cpuidx_read_file(const char* CPUIDX_RESTRICT path, char* CPUIDX_RESTRICT buffer, const size_t size) {
+    FILE* file = fopen(path, "r");
+
+    buffer[0] = '\0';
+    if (!file) return -1;
+
+    const size_t length = fread(buffer, 1, size - 1, file);
+    fclose(file);
+    buffer[length] = '\0';
+    return 0;
+}
+
+/**
+ * Function to get the microcode revision of the CPU, from sysfs, or from /proc/cpuinfo where the microcode driver
+ * is not loaded.
+ *
+ * @return The microcode revision of CPU 0, or 0 if unknown, e.g. outside Linux.
+ */
+uint32_t cpuidx_microcode_revision(void) {
+    char text[4096];
+
+    if (cpuidx_read_file("/sys/devices/system/cpu/cpu0/microcode/version", text, sizeof(text)) == 0 && text[0])
+        return (uint32_t) strtoul(text, NULL, 16);
+
+    // The "microcode : 0x..." line of the first CPU
+    if (cpuidx_read_file("/proc/cpuinfo", text, sizeof(text)) == 0) {
+        const char* line = strstr(text, "\nmicrocode");
+        const char* value = line ? strchr(line, ':') : NULL;
+        if (value) return (uint32_t) strtoul(value + 1, NULL, 16);
+    }
+    return 0;
+}
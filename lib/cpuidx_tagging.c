@@ -0,0 +1,148 @@
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "cpuidx_internal.h"
+#include <string.h>
+
+#if defined(__linux__)
+// arch_prctl codes of Linux 6.4 for LAM, not in the headers of older systems
+#define ARCH_GET_UNTAG_MASK 0x4001
+
+// The user half of the address space ends at bit 47 with 4-level paging, at bit 56 with 5-level paging
+#define LA48_USER_END (1ull << 47)
+#endif
+
+/**
+ * Function to check whether the OS has enabled 5-level paging, so that user pointers may use 56 bits.
+ */
+static bool la57_enabled(const cpu_features* features) {
+    if (!features->IA57) return false;
+
+#if defined(__linux__)
+    // Linux maps above 47 bits only with 5-level paging, and only when asked by a hint
+    void* probe = mmap((void*) (LA48_USER_END << 3), 4096, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (probe == MAP_FAILED) return true;
+
+    const bool high = (uintptr_t) probe >= LA48_USER_END;
+    munmap(probe, 4096);
+    return high;
+#else
+    // Without a way to tell, assume the CPU is used to its full width
+    return true;
+#endif
+}
+
+/**
+ * Function to read the hardware masking of pointer tags enabled for the process, as the mask the CPU applies.
+ */
+static uint64_t hardware_untag_mask(const cpu_features* features) {
+    uint64_t mask = UINT64_MAX;
+
+#if defined(__linux__) && defined(__x86_64__)
+    // Linux enables LAM_U57 per process, with ARCH_ENABLE_TAGGED_ADDR; older kernels fail with EINVAL
+    if (features->LAM && syscall(SYS_arch_prctl, ARCH_GET_UNTAG_MASK, &mask) != 0) mask = UINT64_MAX;
+#else
+    (void) features;
+#endif
+    return mask;
+}
+
+/**
+ * Function to get the pointer bits available for tags in the process.
+ *
+ * Software tags live above the significant bits of user pointers, and are cleared before dereferencing:
+ * 17 bits with 4-level paging, but only 8 with 5-level paging, where user pointers have 56 bits.
+ * Intel LAM, when enabled for the process, makes the CPU ignore bits 62:57 (LAM_U57) or 62:48 (LAM_U48),
+ * so that tags there need no masking. AMD UAI ignores bits 63:57 once the OS sets EFER.UAIE, which
+ * cannot be read from user space; it is reported as a feature only.
+ * The 5-level paging check maps a page on Linux, so the result is meant to be read once, at initialization.
+ *
+ * @param tagging A pointer to a \p cpuidx_pointer_tagging structure to store the budget.
+ * @return 0 on success, -1 if CPUID is not supported.
+ */
+int cpuidx_get_pointer_tagging(cpuidx_pointer_tagging* tagging) {
+    const cpu_features* features = cpuidx_cached_features();
+    const cpu_basic_info* basic_info = cpuidx_cached_basic_info();
+    uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+
+    memset(tagging, 0, sizeof(*tagging));
+    if (!basic_info->highest_basic_leaf) return -1;
+
+    // Linear address size: leaf 0x80000008 EAX bits 15:8
+    if (basic_info->highest_extended_leaf >= 0x80000008) {
+        cpuid(0x80000008, registers);
+        tagging->virtual_address_bits = registers[0] >> 8 & 0xff;
+    }
+    if (!tagging->virtual_address_bits) tagging->virtual_address_bits = features->IA57 ? 57 : 48;
+
+    if (sizeof(void*) == 4) {
+        tagging->user_address_bits = 32;
+    } else {
+        tagging->la57 = la57_enabled(features);
+        tagging->user_address_bits = tagging->la57 ? 56 : 47;
+    }
+    tagging->tag_bits = 64 - tagging->user_address_bits;
+
+    const uint64_t untag_mask = hardware_untag_mask(features);
+    const uint64_t ignored = ~untag_mask;
+    for (uint64_t bits = ignored; bits; bits &= bits - 1) ++tagging->ignored_bits;
+
+    if (ignored == 0x3full << 57) tagging->masking = CPUIDX_MASKING_LAM_U57;
+    else if (ignored == 0x7fffull << 48) tagging->masking = CPUIDX_MASKING_LAM_U48;
+    else tagging->masking = ignored ? CPUIDX_MASKING_OTHER : CPUIDX_MASKING_NONE;
+
+    return 0;
+}
+
+/**
+ * Function to pack a pointer and a tag, e.g. an ABA counter, in 64 bits for compare-and-swap.
+ *
+ * The tag takes the bits above the user pointer bits, and is truncated to \p tag_bits: with 16-bit counters
+ * and 5-level paging, only 8 bits remain.
+ *
+ * \code
+ * cpuidx_pointer_tagging tagging;
+ * cpuidx_get_pointer_tagging(&tagging);
+ *
+ * uint64_t head = atomic_load(&stack->head), next;
+ * do {
+ *     struct node* top = cpuidx_tagged_pointer(&tagging, head);
+ *     if (!top) return NULL;
+ *     next = cpuidx_tag_pointer(&tagging, top->next, cpuidx_tagged_tag(&tagging, head) + 1);
+ * } while (!atomic_compare_exchange_weak(&stack->head, &head, next));
+ * \endcode
+ *
+ * @param tagging A pointer to the budget from \p cpuidx_get_pointer_tagging.
+ * @param pointer The pointer, a user space address.
+ * @param tag The tag.
+ * @return The tagged pointer.
+ */
+uint64_t cpuidx_tag_pointer(const cpuidx_pointer_tagging* tagging, const void* pointer, const uint64_t tag) {
+    const uint64_t address_mask = (1ull << tagging->user_address_bits) - 1;
+    return ((uint64_t) (uintptr_t) pointer & address_mask) | tag << tagging->user_address_bits;
+}
+
+/**
+ * Function to get the pointer of a tagged pointer, without the tag.
+ *
+ * @param tagging A pointer to the budget from \p cpuidx_get_pointer_tagging.
+ * @param tagged The tagged pointer.
+ * @return The pointer.
+ */
+void* cpuidx_tagged_pointer(const cpuidx_pointer_tagging* tagging, const uint64_t tagged) {
+    return (void*) (uintptr_t) (tagged & ((1ull << tagging->user_address_bits) - 1));
+}
+
+/**
+ * Function to get the tag of a tagged pointer.
+ *
+ * @param tagging A pointer to the budget from \p cpuidx_get_pointer_tagging.
+ * @param tagged The tagged pointer.
+ * @return The tag.
+ */
+uint64_t cpuidx_tagged_tag(const cpuidx_pointer_tagging* tagging, const uint64_t tagged) {
+    return tagged >> tagging->user_address_bits;
+}
@@ -0,0 +1,155 @@
+#include "cpuidx_internal.h"
+#include <string.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <immintrin.h>
+#define XBEGIN() _xbegin()
+#define XEND() _xend()
+#define XABORT_LOCKED() _xabort(0xff)
+#else
+#define XBEGIN() xbegin()
+#define XEND() __asm__ volatile ("xend" : : : "memory")
+#define XABORT_LOCKED() __asm__ volatile ("xabort $0xff" : : : "memory")
+
+/**
+ * Function to start a transaction. On abort, execution resumes after the instruction with the abort status.
+ *
+ * @return \p XBEGIN_STARTED in the transaction, the abort status otherwise.
+ */
+static inline __attribute__((always_inline)) unsigned xbegin(void) {
+    unsigned status = ~0u;
+    __asm__ volatile ("xbegin 1f\n1:" : "+a" (status) : : "memory");
+    return status;
+}
+#endif
+
+#define XBEGIN_STARTED (~0u)
+
+// Abort status bits
+#define XABORT_EXPLICIT 0x01u
+#define XABORT_RETRY 0x02u
+#define XABORT_CONFLICT 0x04u
+#define XABORT_CAPACITY 0x08u
+#define XABORT_CODE(status) ((status) >> 24 & 0xffu)
+
+// Transactions tried before taking the lock
+#define ELISION_RETRIES 3
+
+// Transactions of the probe, at least one of which must commit
+#define PROBE_TRANSACTIONS 16
+
+// Not yet probed; the states start at 0
+#define TSX_UNKNOWN (-1)
+
+static long tsx_state = TSX_UNKNOWN;
+
+/**
+ * Function to check whether the kernel disabled TSX, with the \p tsx=off parameter or as a mitigation.
+ */
+static bool kernel_disabled_tsx(void) {
+    char text[512];
+
+    if (cpuidx_read_file("/sys/devices/system/cpu/vulnerabilities/tsx_async_abort", text, sizeof(text)) == 0 &&
+        strstr(text, "TSX disabled"))
+        return true;
+
+    return cpuidx_read_file("/proc/cmdline", text, sizeof(text)) == 0 && strstr(text, "tsx=off");
+}
+
+static enum cpuidx_tsx_state probe_tsx(void) {
+    const cpu_features* features = cpuidx_cached_features();
+
+    if (!features->RTM) return CPUIDX_TSX_UNSUPPORTED;
+    if (features->RTMAA) return CPUIDX_TSX_ALWAYS_ABORT;
+    if (kernel_disabled_tsx()) return CPUIDX_TSX_DISABLED;
+
+    // The CPU may still abort everything, e.g. when the OS sets TSX_FORCE_ABORT (RTMFA)
+    for (int i = 0; i < PROBE_TRANSACTIONS; ++i) {
+        if (XBEGIN() == XBEGIN_STARTED) {
+            XEND();
+            return CPUIDX_TSX_USABLE;
+        }
+    }
+    return CPUIDX_TSX_ABORTING;
+}
+
+/**
+ * Function to decide whether TSX transactions are usable, once per process.
+ *
+ * Combines the CPUID bits (\p RTM, and \p RTMAA for CPUs whose microcode aborts every transaction), the state
+ * of TSX in the Linux kernel, and probe transactions, at least one of which must commit.
+ *
+ * @return \p CPUIDX_TSX_USABLE if RTM can be used, the reason why not otherwise.
+ */
+enum cpuidx_tsx_state cpuidx_get_tsx_state(void) {
+    long state = CPUIDX_LOAD_ACQUIRE(&tsx_state);
+
+    if (state == TSX_UNKNOWN) {
+        state = probe_tsx();
+        CPUIDX_STORE_RELEASE(&tsx_state, state);
+    }
+    return (enum cpuidx_tsx_state) state;
+}
+
+/**
+ * Function to acquire a spin lock, eliding it with a RTM transaction when TSX is usable.
+ *
+ * An elided lock is only read, so threads whose critical sections touch different data run concurrently.
+ * After 3 aborted transactions, or an abort the CPU does not advise to retry, the lock is taken for real.
+ * Critical sections must not execute instructions that always abort transactions, such as system calls,
+ * or they will always take the lock.
+ *
+ * @param lock A pointer to the lock, zero-initialized.
+ * @param stats A pointer to the statistics of the calling thread, or a null pointer.
+ */
+void cpuidx_elided_lock_acquire(cpuidx_elided_lock* CPUIDX_RESTRICT lock,
+                                cpuidx_elision_stats* CPUIDX_RESTRICT stats) {
+    if (cpuidx_get_tsx_state() == CPUIDX_TSX_USABLE) {
+        for (int attempt = 0; attempt < ELISION_RETRIES; ++attempt) {
+            if (stats) ++stats->attempts;
+
+            const unsigned status = XBEGIN();
+            if (status == XBEGIN_STARTED) {
+                // Reading the lock adds it to the read set: taking it for real aborts the transaction
+                if (!lock->locked) return;
+                XABORT_LOCKED();
+            }
+
+            if (stats) {
+                ++stats->aborts;
+                if (status & XABORT_CONFLICT) ++stats->conflict_aborts;
+                if (status & XABORT_CAPACITY) ++stats->capacity_aborts;
+            }
+
+            if ((status & XABORT_EXPLICIT) && XABORT_CODE(status) == 0xff) {
+                // The lock was taken: wait for it to be released before retrying
+                while (CPUIDX_LOAD_ACQUIRE(&lock->locked)) CPUIDX_PAUSE();
+            } else if (!(status & XABORT_RETRY)) {
+                break;
+            }
+        }
+    }
+
+    if (stats) ++stats->fallbacks;
+
+    while (CPUIDX_EXCHANGE(&lock->locked, 1)) {
+        while (CPUIDX_LOAD_ACQUIRE(&lock->locked)) CPUIDX_PAUSE();
+    }
+}
+
+/**
+ * Function to release a lock acquired by \p cpuidx_elided_lock_acquire, committing the transaction if it was elided.
+ *
+ * @param lock A pointer to the lock.
+ * @param stats A pointer to the statistics of the calling thread, or a null pointer.
+ */
+void cpuidx_elided_lock_release(cpuidx_elided_lock* CPUIDX_RESTRICT lock,
+                                cpuidx_elision_stats* CPUIDX_RESTRICT stats) {
+    // A lock taken for real reads as taken, an elided one as free
+    if (!lock->locked) {
+        XEND();
+        if (stats) ++stats->commits;
+    } else {
+        CPUIDX_STORE_RELEASE(&lock->locked, 0);
+    }
+}
@@ -0,0 +1,215 @@
+#include "cpuidx_internal.h"
+#include <string.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <immintrin.h>
+#endif
+
+// Spinning on PAUSE checks the clock about this often
+#define PAUSE_CHECK_NS 200
+
+/**
+ * @brief The instructions used to wait, from the most to the least preferred.
+ */
+enum wait_method {
+    WAIT_UNKNOWN, /**< Not selected yet */
+    WAIT_WAITPKG, /**< UMONITOR/UMWAIT and TPAUSE, with a TSC deadline */
+    WAIT_MWAITX, /**< MONITORX/MWAITX, with a timer */
+    WAIT_PAUSE /**< PAUSE, checking the clock every PAUSE_CHECK_NS */
+};
+
+static long wait_method;
+static long pause_batch; // PAUSE instructions per PAUSE_CHECK_NS
+static long pause_ps; // Picoseconds per PAUSE instruction
+
+/**
+ * Function to select the wait instructions, and calibrate PAUSE, once.
+ */
+static enum wait_method select_method(void) {
+    long method = CPUIDX_LOAD_ACQUIRE(&wait_method);
+    if (method != WAIT_UNKNOWN) return (enum wait_method) method;
+
+    // The fastest of a few runs of 1024 PAUSE instructions
+    uint64_t best = UINT64_MAX;
+    for (int run = 0; run < 4; ++run) {
+        const uint64_t start = CPUIDX_RDTSC();
+        for (int i = 0; i < 1024; ++i) CPUIDX_PAUSE();
+        const uint64_t ticks = CPUIDX_RDTSC() - start;
+        if (ticks < best) best = ticks;
+    }
+
+    const uint64_t tsc_hz = cpuidx_tsc_frequency();
+    const uint64_t ps = best * 1000000000u / tsc_hz * 1000u / 1024u;
+    const uint64_t batch = ps ? (uint64_t) PAUSE_CHECK_NS * 1000u / ps : 1;
+
+    const cpu_features* features = cpuidx_cached_features();
+    method = features->WAITPKG ? WAIT_WAITPKG : features->MWAITX ? WAIT_MWAITX : WAIT_PAUSE;
+
+    CPUIDX_STORE_RELEASE(&pause_ps, (long) (ps ? ps : 1));
+    CPUIDX_STORE_RELEASE(&pause_batch, (long) (batch ? batch : 1));
+    CPUIDX_STORE_RELEASE(&wait_method, method);
+    return (enum wait_method) method;
+}
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define UMONITOR(address) _umonitor((void*) (address))
+#define UMWAIT(deadline) _umwait(1, (deadline))
+#define TPAUSE(deadline) _tpause(1, (deadline))
+#define MONITORX(address) _mm_monitorx((const void*) (address), 0, 0)
+#define MWAITX(ticks) _mm_mwaitx(2, 0xf0, (ticks))
+#else
+// Control 1 selects the C0.1 state, which wakes up faster than C0.2
+#define UMONITOR(address) __asm__ volatile ("umonitor %0" : : "r" (address))
+#define UMWAIT(deadline) \
+    __asm__ volatile ("umwait %%ecx" : : "c" (1), "a" ((uint32_t) (deadline)), "d" ((uint32_t) ((deadline) >> 32)) \
+        : "cc", "memory")
+#define TPAUSE(deadline) \
+    __asm__ volatile ("tpause %%ecx" : : "c" (1), "a" ((uint32_t) (deadline)), "d" ((uint32_t) ((deadline) >> 32)) \
+        : "cc", "memory")
+// Hints 0xf0 stay in C0, and extension 2 enables the timer in EBX
+#define MONITORX(address) __asm__ volatile ("monitorx" : : "a" (address), "c" (0), "d" (0))
+#define MWAITX(ticks) __asm__ volatile ("mwaitx" : : "a" (0xf0), "b" (ticks), "c" (2) : "memory")
+#endif
+
+/**
+ * Function to check whether the value at an address differs from another.
+ */
+static bool changed(const volatile void* address, const void* compare, const size_t size) {
+    switch (size) {
+        case 1:
+            return *(const volatile uint8_t*) address != *(const uint8_t*) compare;
+        case 2:
+            return *(const volatile uint16_t*) address != *(const uint16_t*) compare;
+        case 4:
+            return *(const volatile uint32_t*) address != *(const uint32_t*) compare;
+        default:
+            return *(const volatile uint64_t*) address != *(const uint64_t*) compare;
+    }
+}
+
+/**
+ * Function to spin on PAUSE until the TSC reaches a deadline, or the value at an address changes.
+ */
+static void pause_until(const uint64_t deadline, const volatile void* address, const void* compare,
+                        const size_t size) {
+    const long batch = CPUIDX_LOAD_ACQUIRE(&pause_batch);
+
+    while (CPUIDX_RDTSC() < deadline && !(address && changed(address, compare, size))) {
+        for (long i = 0; i < batch; ++i) CPUIDX_PAUSE();
+    }
+}
+
+/**
+ * Function to get the duration of the PAUSE instruction, measured once per process.
+ *
+ * It ranges from about 10 to about 140 cycles between micro-architectures.
+ *
+ * @return The duration in nanoseconds.
+ */
+double cpuidx_pause_ns(void) {
+    select_method();
+    return (double) CPUIDX_LOAD_ACQUIRE(&pause_ps) / 1000;
+}
+
+/**
+ * Function to get the TSC deadline a duration after a start time, saturating rather than wrapping around.
+ *
+ * @param start The start time in TSC ticks.
+ * @param ns The duration in nanoseconds.
+ * @return The deadline in TSC ticks, or UINT64_MAX if it is beyond the range of the TSC.
+ */
+static uint64_t deadline_after(const uint64_t start, const uint64_t ns) {
+    const uint64_t ticks_per_ms = cpuidx_tsc_frequency() / 1000u;
+    if (ticks_per_ms == 0) return start;
+
+    // ns * ticks_per_ms overflows above about 6e12 ns, so scale milliseconds and the rest separately
+    const uint64_t ms = ns / 1000000u;
+    if (ms >= (UINT64_MAX - start) / ticks_per_ms) return UINT64_MAX;
+    return start + ms * ticks_per_ms + ns % 1000000u * ticks_per_ms / 1000000u;
+}
+
+/**
+ * Function to wait for a duration without yielding the CPU, e.g. as the back-off of a spin lock.
+ *
+ * Uses TPAUSE when WAITPKG is available, MWAITX with a timer when MWAITX is, and otherwise PAUSE, calibrated
+ * once per process to check the clock every 200 ns rather than after a fixed number of instructions.
+ *
+ * @param ns The duration in nanoseconds. Durations beyond the range of the TSC, e.g. UINT64_MAX, never end.
+ */
+void cpuidx_spin_wait(const uint64_t ns) {
+    const enum wait_method method = select_method();
+    const uint64_t start = CPUIDX_RDTSC();
+    const uint64_t deadline = deadline_after(start, ns);
+    uint64_t now = start;
+
+    switch (method) {
+        case WAIT_WAITPKG:
+            // TPAUSE may return early, on interrupts or the OS time limit
+            while (now < deadline) {
+                TPAUSE(deadline);
+                now = CPUIDX_RDTSC();
+            }
+            break;
+        case WAIT_MWAITX: {
+            // Nothing else writes the line of a local variable, so only the timer ends the wait
+            const volatile uint64_t line = 0;
+            while (now < deadline) {
+                MONITORX(&line);
+                MWAITX((uint32_t) (deadline - now < UINT32_MAX ? deadline - now : UINT32_MAX));
+                now = CPUIDX_RDTSC();
+            }
+            break;
+        }
+        default:
+            pause_until(deadline, NULL, NULL, 0);
+            break;
+    }
+}
+
+/**
+ * Function to wait until the value at an address changes, or a timeout expires, without yielding the CPU.
+ *
+ * Monitors the cache line of the address with UMONITOR/UMWAIT when WAITPKG is available, or MONITORX/MWAITX
+ * when MWAITX is, so that the core idles in a low-power state until the line is written.
+ * Otherwise, spins on PAUSE as \p cpuidx_spin_wait. The semantics follow \p WaitOnAddress on Windows.
+ *
+ * @param address The address to wait on, aligned to \p size.
+ * @param compare A pointer to the value to wait for the value at \p address to differ from.
+ * @param size The size of the values: 1, 2, 4 or 8 bytes.
+ * @param timeout_ns The timeout in nanoseconds, or UINT64_MAX to wait until the value changes.
+ * @return 1 if the value changed, 0 if the timeout expired, -1 if \p size is invalid.
+ */
+int cpuidx_wait_on_address(const volatile void* address, const void* compare, const size_t size,
+                           const uint64_t timeout_ns) {
+    if (size != 1 && size != 2 && size != 4 && size != 8) return -1;
+
+    const enum wait_method method = select_method();
+    const uint64_t start = CPUIDX_RDTSC();
+    const uint64_t deadline = deadline_after(start, timeout_ns);
+    uint64_t now = start;
+
+    switch (method) {
+        case WAIT_WAITPKG:
+            // Arm the monitor before checking the value, so that no write goes unnoticed
+            while (now < deadline) {
+                UMONITOR(address);
+                if (changed(address, compare, size)) return 1;
+                UMWAIT(deadline);
+                now = CPUIDX_RDTSC();
+            }
+            break;
+        case WAIT_MWAITX:
+            while (now < deadline) {
+                MONITORX(address);
+                if (changed(address, compare, size)) return 1;
+                MWAITX((uint32_t) (deadline - now < UINT32_MAX ? deadline - now : UINT32_MAX));
+                now = CPUIDX_RDTSC();
+            }
+            break;
+        default:
+            pause_until(deadline, address, compare, size);
+            break;
+    }
+
+    return changed(address, compare, size);
+}
@@ -0,0 +1,187 @@
+#include "cpuidx.h"
+#include <string.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <immintrin.h>
+#endif
+
+// Size of the legacy region (x87 and SSE state) and the XSAVE header, which every XSAVE area starts with
+#define LEGACY_AREA_SIZE 576
+
+// XSAVE areas must be aligned to 64 bytes
+#define AREA_ALIGNMENT 64
+
+static const char* const component_names[] = {
+    "x87", "SSE", "AVX", "MPX_BNDREGS", "MPX_BNDCSR", "AVX512_OPMASK", "AVX512_ZMM_HI256", "AVX512_HI16_ZMM",
+    "PT", "PKRU", "PASID", "CET_U", "CET_S", "HDC", "UINTR", "LBR", "HWP", "AMX_TILECFG", "AMX_TILEDATA", "APX",
+};
+
+/**
+ * @brief The instructions used to save the extended state, from the most to the least preferred.
+ */
+enum save_method {
+    SAVE_XSAVEC, /**< Compacted format, skipping components in their initial state */
+    SAVE_XSAVEOPT, /**< Standard format, skipping components unmodified since the last XRSTOR */
+    SAVE_XSAVE /**< Standard format */
+};
+
+static enum save_method save_method(void) {
+    const cpu_features* features = cpuidx_cached_features();
+
+    if (features->XSAVEC) return SAVE_XSAVEC;
+    if (features->XSAVEOPT) return SAVE_XSAVEOPT;
+    return SAVE_XSAVE;
+}
+
+/**
+ * Function to decode the XSAVE state information from CPUID leaf 0xD and XCR0.
+ *
+ * @param info A pointer to a \p cpuidx_xsave_info structure to store the information.
+ * @return 0 on success, -1 if the CPU does not support XSAVE or the OS did not enable it.
+ */
+int cpuidx_get_xsave_info(cpuidx_xsave_info* info) {
+    memset(info, 0, sizeof(*info));
+
+    const cpu_features* features = cpuidx_cached_features();
+    if (!features->XSAVE || !features->OSXSAVE || cpuidx_cached_basic_info()->highest_basic_leaf < 0xd) return -1;
+
+    uint32_t registers[4] = {0}; // Registers: EAX, EBX, ECX, EDX
+
+    // Sub-leaf 0: user components, and the standard format sizes
+    cpuid_extended(0xd, 0, registers);
+    info->supported_xcr0 = (uint64_t) registers[3] << 32 | registers[0];
+    info->enabled_size = registers[1];
+    info->max_size = registers[2];
+    info->enabled_xcr0 = xgetbv(0);
+
+    // Sub-leaf 1: supervisor components, and the compacted format size
+    cpuid_extended(0xd, 1, registers);
+    info->supported_xss = (uint64_t) registers[3] << 32 | registers[2];
+    info->compacted_size = registers[1];
+
+    // The legacy components have a fixed layout
+    info->components[0] = (cpuidx_xsave_component) {.size = 160, .offset = 0};
+    info->components[1] = (cpuidx_xsave_component) {.size = 256, .offset = 160};
+
+    const uint64_t supported = info->supported_xcr0 | info->supported_xss;
+
+    for (uint32_t i = 2; i < CPUIDX_XSAVE_COMPONENTS; ++i) {
+        if (!(supported >> i & 1)) continue;
+
+        cpuid_extended(0xd, i, registers);
+
+        cpuidx_xsave_component* component = &info->components[i];
+        component->size = registers[0];
+        component->offset = registers[1];
+        component->supervisor = registers[2] & 0x1;
+        component->aligned = registers[2] & 0x2;
+        component->xfd = registers[2] & 0x4;
+
+        if (component->xfd) info->xfd_components |= (uint64_t) 1 << i;
+    }
+
+    return 0;
+}
+
+/**
+ * Function to get the name of an XSAVE state component.
+ *
+ * @param component The index of the component, i.e. its bit in XCR0 or IA32_XSS.
+ * @return The name of the component, e.g. "AVX", or a null pointer if the component is unknown.
+ */
+const char* cpuidx_xsave_component_name(const unsigned component) {
+    return component < sizeof(component_names) / sizeof(component_names[0]) ? component_names[component] : NULL;
+}
+
+/**
+ * Function to get the size of the buffer \p cpuidx_xsave needs to save a set of state components.
+ *
+ * The size is exact for the instruction \p cpuidx_xsave uses: the compacted format when XSAVEC is available,
+ * the standard format otherwise. The legacy region and the XSAVE header are always included.
+ *
+ * @param info A pointer to the \p cpuidx_xsave_info structure from \p cpuidx_get_xsave_info.
+ * @param components The state components to save, as a bitmask of XCR0 bits. Disabled components are ignored.
+ * @param alignment A pointer to store the required alignment of the buffer, or a null pointer.
+ * @return The size of the buffer in bytes, or 0 if XSAVE is not enabled.
+ */
+size_t cpuidx_xsave_area_size(const cpuidx_xsave_info* info, uint64_t components, size_t* alignment) {
+    if (alignment) *alignment = AREA_ALIGNMENT;
+    if (!info->enabled_xcr0) return 0;
+
+    components &= info->enabled_xcr0;
+
+    const bool compacted = save_method() == SAVE_XSAVEC;
+    size_t size = LEGACY_AREA_SIZE;
+
+    for (unsigned i = 2; i < CPUIDX_XSAVE_COMPONENTS; ++i) {
+        if (!(components >> i & 1)) continue;
+
+        const cpuidx_xsave_component* component = &info->components[i];
+
+        if (compacted) {
+            if (component->aligned) size = (size + AREA_ALIGNMENT - 1) & ~(size_t) (AREA_ALIGNMENT - 1);
+            size += component->size;
+        } else if (component->offset + component->size > size) {
+            size = component->offset + component->size;
+        }
+    }
+
+    return size;
+}
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#ifdef _M_X64
+#define XSAVE_INSN(name, area, mask) _##name##64((area), (mask))
+#else
+#define XSAVE_INSN(name, area, mask) _##name((area), (mask))
+#endif
+#else
+#ifdef __x86_64__
+#define XSAVE_SUFFIX "64"
+#else
+#define XSAVE_SUFFIX ""
+#endif
+#define XSAVE_INSN(name, area, mask) \
+    __asm__ volatile (#name XSAVE_SUFFIX " (%0)" \
+        : : "r" (area), "a" ((uint32_t) (mask)), "d" ((uint32_t) ((mask) >> 32)) : "memory")
+#endif
+
+/**
+ * Function to save the extended state of the calling thread, e.g. on a fiber or coroutine switch.
+ *
+ * Uses XSAVEC when available, XSAVEOPT otherwise, and XSAVE as a last resort; never XSAVES.
+ * Components disabled in XCR0 are ignored, and components armed for XFD are saved in their initial state.
+ *
+ * @param area A buffer of the size and alignment given by \p cpuidx_xsave_area_size.
+ * @param components The state components to save, as a bitmask of XCR0 bits.
+ */
+void cpuidx_xsave(void* area, const uint64_t components) {
+    switch (save_method()) {
+        case SAVE_XSAVEC:
+            XSAVE_INSN(xsavec, area, components);
+            break;
+        case SAVE_XSAVEOPT:
+            XSAVE_INSN(xsaveopt, area, components);
+            break;
+        case SAVE_XSAVE:
+            XSAVE_INSN(xsave, area, components);
+            break;
+    }
+}
+
+/**
+ * Function to restore the extended state of the calling thread saved by \p cpuidx_xsave.
+ *
+ * XRSTOR reads both the standard and the compacted format. A zero-filled buffer restores the initial state.
+ *
+ * @param area A buffer written by \p cpuidx_xsave, or zero-filled.
+ * @param components The state components to restore, as a bitmask of XCR0 bits.
+ */
+void cpuidx_xrstor(const void* area, const uint64_t components) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    XSAVE_INSN(xrstor, area, components);
+#else
+    __asm__ volatile ("xrstor" XSAVE_SUFFIX " (%0)"
+        : : "r" (area), "a" ((uint32_t) components), "d" ((uint32_t) (components >> 32)) : "memory");
+#endif
+}
@@ -0,0 +1,271 @@
+#if !(__x86_64__ || __86_64 || __amd64__ || __amd64 || __i386__ || __i386 || _M_AMD64 || _M_X64 || _M_IX86 || __X86__ || _X86_)
+#error "The target arch is not x86."
+#endif
+
+#include <cpuidx.h>
+#include <cpuidx_ifunc.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <io.h>
+#include <process.h>
+#define EXECUTABLE(path) (_access((path), 0) == 0)
+#define EXEC(path, args) _execv((path), (const char* const*) (args))
+#else
+#include <unistd.h>
+#define EXECUTABLE(path) (access((path), X_OK) == 0)
+#define EXEC(path, args) execv((path), (args))
+#endif
+
+#define MAX_VARIANTS 32
+#define MAX_PATH_LENGTH 4096
+
+/**
+ * @brief A build of the program, and the features it requires.
+ */
+struct variant {
+    char profile[256]; /**< The profile the build targets, e.g. "x86-64-v3,AVX512VNNI" */
+    char path[MAX_PATH_LENGTH]; /**< The path of the build */
+    cpu_features features; /**< The features of the profile */
+    bool executable; /**< The build exists and can be executed */
+};
+
+static struct variant variants[MAX_VARIANTS];
+static cpu_features candidates[MAX_VARIANTS];
+
+/**
+ * Prints the usage of the program.
+ *
+ * @param program The name of the program.
+ */
+void print_usage(const char* program) {
+    printf("Usage: %s [option]... MANIFEST [ARG]...\n", program);
+    printf("       %s [option]... --hwcaps PROGRAM [ARG]...\n\n", program);
+    puts("Executes the build of a program using the most features the host runs natively, with the arguments.\n");
+    puts("The MANIFEST lists a build per line, as the profile it targets and its path, relative to the manifest:");
+    puts("  x86-64-v4             bin/app-v4");
+    puts("  x86-64-v3,AVX512VNNI  bin/app-v3-vnni");
+    puts("  x86-64-v2             bin/app");
+    puts("With --hwcaps, the builds follow the glibc-hwcaps layout instead: DIR/glibc-hwcaps/x86-64-vN/NAME for");
+    puts("a PROGRAM at DIR/NAME, which is the baseline build.\n");
+    puts("Options:");
+    puts("  --hwcaps          Select among the glibc-hwcaps builds of PROGRAM");
+    puts("  --print           Print the builds and the selected one instead of executing it");
+    puts("  --profile=SPEC    Select for SPEC instead of the host, e.g. x86-64-v3 (with --print)");
+    puts("  --no-self-test    Trust the CPUID bits instead of verifying that the features execute natively");
+    puts("  --help            Print this help and exit");
+}
+
+/**
+ * Function to join a path relative to the directory of a file, e.g. the manifest.
+ *
+ * @return 0 on success, -1 if the result is too long.
+ */
+static int join_path(const char* file, const char* path, char* result, const size_t size) {
+    const char* slash = strrchr(file, '/');
+    const int directory_length = path[0] == '/' || !slash ? 0 : (int) (slash - file + 1);
+
+    const int length = snprintf(result, size, "%.*s%s", directory_length, file, path);
+    return length >= 0 && (size_t) length < size ? 0 : -1;
+}
+
+/**
+ * Function to add a build to the variants.
+ *
+ * @return 0 on success, -1 if the profile is invalid, the path too long, or there are too many variants.
+ */
+static int add_variant(size_t* count, const char* profile, const size_t profile_length, const char* path) {
+    if (*count >= MAX_VARIANTS || profile_length >= sizeof(variants[0].profile)) return -1;
+
+    struct variant* variant = &variants[*count];
+    memcpy(variant->profile, profile, profile_length);
+    variant->profile[profile_length] = '\0';
+
+    const size_t path_length = strlen(path);
+    if (path_length >= sizeof(variant->path)) return -1;
+    memcpy(variant->path, path, path_length + 1);
+
+    if (cpuidx_parse_profile(variant->profile, &variant->features) != 0) return -1;
+    variant->executable = EXECUTABLE(variant->path);
+    ++*count;
+    return 0;
+}
+
+/**
+ * Function to read the builds listed in a manifest.
+ *
+ * Each line holds a profile, without spaces, and a path. Blank lines and text after '#' are ignored.
+ *
+ * @return The number of builds, or -1 on error.
+ */
+static int read_manifest(const char* manifest) {
+    FILE* file = fopen(manifest, "r");
+    char line[MAX_PATH_LENGTH + 256], path[MAX_PATH_LENGTH];
+    size_t count = 0;
+    int number = 0;
+
+    if (!file) {
+        perror(manifest);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), file)) {
+        ++number;
+        line[strcspn(line, "#\r\n")] = '\0';
+
+        char* profile = line;
+        while (isspace((unsigned char) *profile)) ++profile;
+        if (!*profile) continue;
+
+        const size_t profile_length = strcspn(profile, " \t");
+        char* entry = profile + profile_length;
+        while (isspace((unsigned char) *entry)) ++entry;
+
+        char* end = entry + strlen(entry);
+        while (end > entry && isspace((unsigned char) end[-1])) --end;
+        *end = '\0';
+
+        if (!*entry || join_path(manifest, entry, path, sizeof(path)) != 0 ||
+            add_variant(&count, profile, profile_length, path) != 0) {
+            fprintf(stderr, "%s:%d: invalid build\n", manifest, number);
+            fclose(file);
+            return -1;
+        }
+    }
+
+    fclose(file);
+    return (int) count;
+}
+
+/**
+ * Function to list the builds of a program in the glibc-hwcaps layout, from the most specialized level.
+ *
+ * @return The number of builds, or -1 on error.
+ */
+static int read_hwcaps(const char* program) {
+    static const char* const levels[] = {"x86-64-v4", "x86-64-v3", "x86-64-v2"};
+    const char* slash = strrchr(program, '/');
+    const char* name = slash ? slash + 1 : program;
+    char relative[MAX_PATH_LENGTH], path[MAX_PATH_LENGTH];
+    size_t count = 0;
+
+    for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); ++i) {
+        const int length = snprintf(relative, sizeof(relative), "glibc-hwcaps/%s/%s", levels[i], name);
+        if (length < 0 || (size_t) length >= sizeof(relative) || join_path(program, relative, path, sizeof(path)) != 0)
+            return -1;
+        if (add_variant(&count, levels[i], strlen(levels[i]), path) != 0) return -1;
+    }
+
+    // The program itself is the baseline build
+    if (add_variant(&count, "x86-64", 6, program) != 0) return -1;
+    return (int) count;
+}
+
+/**
+ * Function to remove the features whose register state the OS has not enabled in XCR0, as \p cpuidx_ifunc_supports,
+ * e.g. AVX-512 on a kernel saving only the AVX state.
+ */
+static void mask_os_enabled(cpu_features* features) {
+    const uint64_t xcr0 = cpuidx_ifunc_xcr0();
+    bool* values = (bool*) features;
+
+    for (size_t i = 0; i < CPUIDX_FEATURE_COUNT; ++i) {
+        const uint64_t required = cpuidx_ifunc_required_xcr0((enum cpuidx_feature) i);
+        if ((xcr0 & required) != required) values[i] = false;
+    }
+}
+
+/**
+ * Function to select the build using the most features the host supports, among those that can be executed.
+ *
+ * @return The index of the build, or -1 if none runs on the host.
+ */
+static int select_variant(const cpu_features* host, const size_t count) {
+    int indices[MAX_VARIANTS];
+    size_t candidate_count = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        if (!variants[i].executable) continue;
+        candidates[candidate_count] = variants[i].features;
+        indices[candidate_count++] = (int) i;
+    }
+
+    const int selected = cpuidx_select_variant(host, candidates, candidate_count);
+    return selected < 0 ? -1 : indices[selected];
+}
+
+int main(const int argc, char** argv) {
+    const char* profile = NULL;
+    bool hwcaps = false, print = false, self_test = true;
+    int i = 1;
+
+    for (; i < argc && argv[i][0] == '-'; ++i) {
+        if (strcmp(argv[i], "--hwcaps") == 0) hwcaps = true;
+        else if (strcmp(argv[i], "--print") == 0) print = true;
+        else if (strcmp(argv[i], "--no-self-test") == 0) self_test = false;
+        else if (strncmp(argv[i], "--profile=", 10) == 0) profile = argv[i] + 10;
+        else if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else if (strcmp(argv[i], "--") == 0) {
+            ++i;
+            break;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (i >= argc) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    const char* target = argv[i];
+    const int count = hwcaps ? read_hwcaps(target) : read_manifest(target);
+    if (count < 0) {
+        if (hwcaps) fprintf(stderr, "Invalid program path: %s\n", target);
+        return 1;
+    }
+
+    // The usable features: those the self-test saw execute natively, unless told to trust CPUID, and whose
+    // state the OS enabled, which the self-test cannot check for features without a snippet
+    cpu_features host;
+    if (!profile) {
+        host = *(self_test ? cpuidx_verified_features() : cpuidx_cached_features());
+        mask_os_enabled(&host);
+    } else if (cpuidx_parse_profile(profile, &host) != 0) {
+        fprintf(stderr, "Invalid profile: %s\n", profile);
+        return 1;
+    }
+
+    const int selected = select_variant(&host, (size_t) count);
+
+    if (print) {
+        for (int j = 0; j < count; ++j) {
+            const char* status = "unsupported";
+
+            if (j == selected) status = "selected";
+            else if (!variants[j].executable) status = "missing";
+            else if (cpuidx_select_variant(&host, &variants[j].features, 1) == 0) status = "supported";
+            printf("%-11s %-24s %s\n", status, variants[j].profile, variants[j].path);
+        }
+        return selected < 0 ? 1 : 0;
+    }
+
+    if (selected < 0) {
+        fprintf(stderr, "No build listed in %s runs on this host.\n", target);
+        return 127;
+    }
+
+    // The build takes the place of the launcher, with the arguments following the manifest
+    char** args = argv + i;
+    args[0] = variants[selected].path;
+    EXEC(variants[selected].path, args);
+
+    perror(variants[selected].path);
+    return 126;
+}
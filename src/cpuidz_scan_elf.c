@@ -0,0 +1,1196 @@
+#if !(__x86_64__ || __86_64 || __amd64__ || __amd64 || __i386__ || __i386 || _M_AMD64 || _M_X64 || _M_IX86 || __X86__ || _X86_)
+#error "The target arch is not x86."
+#endif
+
+#include <cpuidx.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <threads.h>
+#include <time.h>
+#include <unistd.h>
+
+// x86 properties of .note.gnu.property (binutils 2.36), not in the headers of older systems
+#ifndef GNU_PROPERTY_X86_ISA_1_USED
+#define GNU_PROPERTY_X86_ISA_1_USED 0xc0010002
+#define GNU_PROPERTY_X86_ISA_1_NEEDED 0xc0008002
+#endif
+#ifndef GNU_PROPERTY_X86_FEATURE_2_USED
+#define GNU_PROPERTY_X86_FEATURE_2_USED 0xc0010001
+#define GNU_PROPERTY_X86_FEATURE_2_NEEDED 0xc0008001
+#endif
+
+// GNU_PROPERTY_X86_FEATURE_2 bits of the register states the code uses
+#define FEATURE_2_YMM 0x10
+#define FEATURE_2_ZMM 0x20
+#define FEATURE_2_XSAVE 0x80
+#define FEATURE_2_XSAVEOPT 0x100
+#define FEATURE_2_XSAVEC 0x200
+#define FEATURE_2_TMM 0x400
+#define FEATURE_2_MASK 0x800
+
+// Code below which threads cost more than they save
+#define MIN_CHUNK_SIZE (4u << 20)
+#define MAX_THREADS 64
+
+// The bytes a thread decodes before counting, to realign with the instructions when starting amid one
+#define SYNC_SIZE 256
+
+// The mandatory prefix of an instruction, in the order of the pp field of VEX and EVEX
+enum prefix { PREFIX_NONE, PREFIX_66, PREFIX_F3, PREFIX_F2 };
+
+enum encoding { ENCODING_LEGACY, ENCODING_REX2, ENCODING_VEX, ENCODING_EVEX, ENCODING_XOP };
+
+/**
+ * @brief A decoded instruction, reduced to what tells the features it needs.
+ */
+struct instruction {
+    enum encoding encoding; /**< The encoding */
+    uint8_t map; /**< The opcode map: 0 one-byte, 1 0F, 2 0F38, 3 0F3A, 4 to 7 EVEX and VEX maps, 8 to 10 XOP */
+    uint8_t opcode; /**< The opcode in its map */
+    enum prefix prefix; /**< The mandatory prefix, or the pp field */
+    uint8_t modrm; /**< The ModRM byte, 0 if none */
+    bool has_modrm; /**< The instruction has a ModRM byte */
+    bool w; /**< REX.W, REX2.W, VEX.W or EVEX.W */
+    uint8_t vector_length; /**< VEX.L or EVEX.L'L: 0 for 128 bits, 1 for 256, 2 for 512 */
+    bool evex_b; /**< EVEX.b: broadcast, or rounding control instead of the vector length with a register operand */
+    bool classify; /**< The instruction may need more than the baseline */
+};
+
+/**
+ * @brief The features an ELF file requires, from its notes and from its code.
+ */
+struct scan {
+    cpu_features needed; /**< The features of the ISA_1_NEEDED and FEATURE_2_NEEDED properties */
+    uint32_t needed_level; /**< The x86-64 level of ISA_1_NEEDED, 0 if absent */
+    uint32_t used_level; /**< The x86-64 level of ISA_1_USED, 0 if absent */
+    bool has_notes; /**< The file has x86 properties */
+    bool malformed_sections; /**< The section header table is out of bounds, so the segments were scanned */
+    uint64_t counts[CPUIDX_FEATURE_COUNT]; /**< The instructions found per feature */
+    uint64_t first[CPUIDX_FEATURE_COUNT]; /**< The address of the first instruction per feature */
+    uint64_t instructions; /**< The instructions decoded */
+    uint64_t code_bytes; /**< The bytes of executable code */
+};
+
+/**
+ * Prints the usage of the program.
+ *
+ * @param program The name of the program.
+ */
+void print_usage(const char* program) {
+    printf("Usage: %s [option]... FILE...\n\n", program);
+    puts("Finds the CPU features an ELF file requires, from its .note.gnu.property x86 ISA properties and by");
+    puts("decoding its code, and compares them with the host, or a profile.\n");
+    puts("Exits with 1 if the host lacks features the properties mark as needed, 2 if it lacks features of");
+    puts("instructions found in the code, which may be guarded by run-time dispatch, and 3 on errors, such as");
+    puts("a file that cannot be scanned.\n");
+    puts("Large code is decoded by a thread per CPU, at about 250 MB/s each in a release build, so scanning");
+    puts("500 MB of code a second takes four or more cores.\n");
+    puts("Options:");
+    puts("  --profile=SPEC    Compare with SPEC instead of the host: a list of x86-64 levels and feature names,");
+    puts("                    e.g. x86-64-v2 for the oldest hosts of a fleet");
+    puts("  --help            Print this help and exit");
+}
+
+// Rows of 16 opcodes with a ModRM byte, bit n of row r for opcode 16r + n
+static const uint16_t map0_modrm[16] = {
+    0x0f0f, 0x0f0f, 0x0f0f, 0x0f0f, 0x0000, 0x0000, 0x0a0c, 0x0000,
+    0xffff, 0x0000, 0x0000, 0x0000, 0x00f3, 0xff0f, 0x0000, 0xc0c0,
+};
+
+static const uint16_t map1_modrm[16] = {
+    0xa00f, 0xffff, 0xff0f, 0x0000, 0xffff, 0xffff, 0xffff, 0xff7f,
+    0x0000, 0xffff, 0xf838, 0xffff, 0x00ff, 0xffff, 0xffff, 0xffff,
+};
+
+#define HAS_MODRM(table, opcode) ((table)[(opcode) >> 4] >> ((opcode) & 0xf) & 1)
+
+// The immediates of legacy opcodes
+enum immediate {
+    IMMEDIATE_NONE,
+    IMMEDIATE_8,
+    IMMEDIATE_16,
+    IMMEDIATE_24, // ENTER
+    IMMEDIATE_Z, // 2 or 4 bytes, by operand size
+    IMMEDIATE_RELATIVE, // 4 bytes in 64-bit mode, else z
+    IMMEDIATE_MOV, // 8 bytes with REX.W, else z
+    IMMEDIATE_OFFSET, // The moffs of MOV, by address size
+    IMMEDIATE_GROUP3, // TEST of F6 and F7
+    IMMEDIATE_FAR, // ptr16:z, invalid in 64-bit mode
+    IMMEDIATE_EXTRQ, // 2 bytes for EXTRQ and INSERTQ, with 66 or F2
+};
+
+// Opcode table entries: the immediate in the low bits
+#define OPCODE_IMMEDIATE 0x0f
+#define OPCODE_MODRM 0x80 // The opcode has a ModRM byte
+#define OPCODE_CLASSIFY 0x40 // The opcode may need more than the baseline
+
+// Prefix table entries
+#define LEGACY_66 0x01
+#define LEGACY_67 0x02
+#define LEGACY_F2 0x04
+#define LEGACY_F3 0x08
+#define LEGACY_OTHER 0x10 // LOCK and segment overrides
+#define ESCAPE 0x20 // 0F, or the first byte of REX2, VEX, EVEX and XOP
+
+static uint8_t map0_opcodes[256], map1_opcodes[256], prefixes[256];
+
+// Fast table entries, for instructions without legacy prefixes and needing nothing beyond the baseline:
+// the size of the immediate in the low bits
+#define FAST_IMMEDIATE 0x07
+#define FAST_WIDE 0x20 // 4 more bytes of immediate with REX.W
+#define FAST 0x40 // The fast path decodes the opcode
+#define FAST_MODRM 0x80 // The opcode has a ModRM byte
+
+// The fast table entries of the one-byte opcodes, then of the 0F opcodes
+static uint8_t fast_opcodes[2][256];
+
+// The length of a ModRM byte with its SIB byte and displacement, with 32-bit and 64-bit addressing
+static uint8_t modrm_lengths[256];
+
+/**
+ * Function to get the immediate of a one-byte opcode.
+ */
+static enum immediate map0_immediate(const uint8_t opcode) {
+    if (opcode < 0x40 && (opcode & 7) == 4) return IMMEDIATE_8;
+    if (opcode < 0x40 && (opcode & 7) == 5) return IMMEDIATE_Z;
+    if ((opcode >= 0x70 && opcode <= 0x7f) || (opcode >= 0xb0 && opcode <= 0xb7) ||
+        (opcode >= 0xe0 && opcode <= 0xe7))
+        return IMMEDIATE_8;
+    if (opcode >= 0xb8 && opcode <= 0xbf) return IMMEDIATE_MOV;
+    if (opcode >= 0xa0 && opcode <= 0xa3) return IMMEDIATE_OFFSET;
+
+    switch (opcode) {
+        case 0x6a: case 0x6b: case 0x80: case 0x82: case 0x83: case 0xa8: case 0xc0: case 0xc1: case 0xc6:
+        case 0xcd: case 0xd4: case 0xd5: case 0xeb:
+            return IMMEDIATE_8;
+        case 0x68: case 0x69: case 0x81: case 0xa9: case 0xc7:
+            return IMMEDIATE_Z;
+        case 0xe8: case 0xe9:
+            return IMMEDIATE_RELATIVE;
+        case 0xc2: case 0xca:
+            return IMMEDIATE_16;
+        case 0xc8:
+            return IMMEDIATE_24;
+        case 0x9a: case 0xea:
+            return IMMEDIATE_FAR;
+        case 0xf6: case 0xf7:
+            return IMMEDIATE_GROUP3;
+        default:
+            return IMMEDIATE_NONE;
+    }
+}
+
+/**
+ * Function to get the immediate of a 0F opcode.
+ */
+static enum immediate map1_immediate(const uint8_t opcode) {
+    if (opcode >= 0x80 && opcode <= 0x8f) return IMMEDIATE_RELATIVE;
+
+    switch (opcode) {
+        case 0x0f: case 0x70: case 0x71: case 0x72: case 0x73: case 0xa4: case 0xac: case 0xba: case 0xc2:
+        case 0xc4: case 0xc5: case 0xc6:
+            return IMMEDIATE_8;
+        case 0x78:
+            return IMMEDIATE_EXTRQ;
+        default:
+            return IMMEDIATE_NONE;
+    }
+}
+
+/**
+ * Function to fill the decoding tables, so that decoding the common instructions takes few branches.
+ */
+static void init_tables(void) {
+    // The 0F opcodes classify_legacy() looks at
+    static const uint8_t map1_classified[] = {0x01, 0x12, 0x16, 0x2b, 0x78, 0x79, 0x7c, 0x7d,
+                                              0xae, 0xb8, 0xbc, 0xbd, 0xc7, 0xd0, 0xf0};
+    static const uint8_t legacy[] = {0xf0, 0x2e, 0x36, 0x3e, 0x26, 0x64, 0x65};
+    static const uint8_t escapes[] = {0x0f, 0x62, 0x8f, 0xc4, 0xc5, 0xd5};
+
+    for (unsigned opcode = 0; opcode < 256; ++opcode) {
+        map0_opcodes[opcode] = (uint8_t) (map0_immediate((uint8_t) opcode) |
+                                          (HAS_MODRM(map0_modrm, opcode) ? OPCODE_MODRM : 0));
+        map1_opcodes[opcode] = (uint8_t) (map1_immediate((uint8_t) opcode) |
+                                          (HAS_MODRM(map1_modrm, opcode) ? OPCODE_MODRM : 0));
+
+        const unsigned mod = opcode >> 6, rm = opcode & 7;
+        modrm_lengths[opcode] = (uint8_t) (1 + (mod != 3 && rm == 4) + (mod == 1 ? 1 : mod == 2 ? 4 : 0) +
+                                           (mod == 0 && rm == 5 ? 4 : 0));
+    }
+
+    // LAHF and SAHF, which 64-bit mode lacks on early CPUs, and XABORT and XBEGIN
+    map0_opcodes[0x9e] |= OPCODE_CLASSIFY;
+    map0_opcodes[0x9f] |= OPCODE_CLASSIFY;
+    map0_opcodes[0xc6] |= OPCODE_CLASSIFY;
+    map0_opcodes[0xc7] |= OPCODE_CLASSIFY;
+    for (size_t i = 0; i < sizeof(map1_classified); ++i) map1_opcodes[map1_classified[i]] |= OPCODE_CLASSIFY;
+
+    prefixes[0x66] = LEGACY_66;
+    prefixes[0x67] = LEGACY_67;
+    prefixes[0xf2] = LEGACY_F2;
+    prefixes[0xf3] = LEGACY_F3;
+    for (size_t i = 0; i < sizeof(legacy); ++i) prefixes[legacy[i]] = LEGACY_OTHER;
+    for (size_t i = 0; i < sizeof(escapes); ++i) prefixes[escapes[i]] = ESCAPE;
+
+    // Without a 66 prefix, z is 4 bytes, and so are relative displacements in both modes
+    static const uint8_t fast_immediates[] = {
+        [IMMEDIATE_NONE] = FAST, [IMMEDIATE_8] = FAST | 1, [IMMEDIATE_16] = FAST | 2, [IMMEDIATE_24] = FAST | 3,
+        [IMMEDIATE_Z] = FAST | 4, [IMMEDIATE_RELATIVE] = FAST | 4, [IMMEDIATE_MOV] = FAST | FAST_WIDE | 4,
+    };
+    for (unsigned opcode = 0; opcode < 256; ++opcode) {
+        const uint8_t entries[2] = {map0_opcodes[opcode], map1_opcodes[opcode]};
+        for (size_t map = 0; map < 2; ++map) {
+            const unsigned immediate = entries[map] & OPCODE_IMMEDIATE;
+            if ((map == 0 && prefixes[opcode]) || (map == 1 && (opcode == 0x38 || opcode == 0x3a)) ||
+                entries[map] & OPCODE_CLASSIFY || immediate >= sizeof(fast_immediates))
+                continue;
+            fast_opcodes[map][opcode] = (uint8_t) (fast_immediates[immediate] |
+                                                   (entries[map] & OPCODE_MODRM ? FAST_MODRM : 0));
+        }
+    }
+}
+
+/**
+ * Function to get the size of a legacy immediate.
+ */
+static size_t immediate_size(const enum immediate immediate, const uint8_t opcode, const enum prefix prefix,
+                             const bool operand16, const bool address16, const bool rex_w, const bool long_mode,
+                             const uint8_t modrm) {
+    const size_t z = operand16 ? 2 : 4;
+
+    switch (immediate) {
+        case IMMEDIATE_8:
+            return 1;
+        case IMMEDIATE_16:
+            return 2;
+        case IMMEDIATE_24:
+            return 3;
+        case IMMEDIATE_Z:
+            return z;
+        case IMMEDIATE_RELATIVE:
+            return long_mode ? 4 : z;
+        case IMMEDIATE_MOV:
+            return rex_w ? 8 : z;
+        case IMMEDIATE_OFFSET:
+            return long_mode ? (address16 ? 4 : 8) : (address16 ? 2 : 4);
+        case IMMEDIATE_GROUP3:
+            return (modrm >> 3 & 7) >= 2 ? 0 : opcode == 0xf6 ? 1 : z;
+        case IMMEDIATE_FAR:
+            return long_mode ? 0 : z + 2;
+        case IMMEDIATE_EXTRQ:
+            // EXTRQ and INSERTQ take two; VMREAD none
+            return prefix == PREFIX_66 || prefix == PREFIX_F2 ? 2 : 0;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Function to get the size of a ModRM byte with its SIB byte and displacement.
+ *
+ * @return The size, or 0 if the code ends first.
+ */
+static size_t modrm_size(const uint8_t* code, const size_t size, const bool address16) {
+    const unsigned modrm = code[0], mod = modrm >> 6, rm = modrm & 7;
+
+    if (address16) return mod == 3 ? 1 : mod == 0 && rm == 6 ? 3 : 1 + mod;
+    // A SIB byte without a base register is followed by a 32-bit displacement
+    if ((modrm & 0xc7) != 0x04) return modrm_lengths[modrm];
+    return size < 2 ? 0 : (code[1] & 7) == 5 ? 6 : 2;
+}
+
+/**
+ * Function to decode the length of an instruction without legacy prefixes, and needing nothing beyond the baseline.
+ *
+ * Most instructions are such, and their length takes few branches, which mispredict less than the full decoder.
+ *
+ * @param code The code, with at least 16 bytes left.
+ * @param long_mode Whether the code is 64-bit, or 32-bit.
+ * @return The length of the instruction, or 0 if the full decoder must decode it.
+ */
+static size_t decode_fast(const uint8_t* code, const bool long_mode) {
+    const size_t rex = long_mode & ((code[0] & 0xf0) == 0x40);
+    const size_t escape = code[rex] == 0x0f;
+    const size_t i = rex + escape;
+    const uint8_t entry = fast_opcodes[escape][code[i]];
+
+    if (!(entry & FAST)) return 0;
+
+    const uint8_t modrm = code[i + 1];
+    // A SIB byte without a base register is followed by a 32-bit displacement
+    const size_t modrm_length = modrm_lengths[modrm] + (((modrm & 0xc7) == 0x04) & ((code[i + 2] & 7) == 5)) * 4;
+    const size_t wide = rex & code[0] >> 3 & (entry & FAST_WIDE) >> 5;
+
+    return i + 1 + (entry & FAST_MODRM ? modrm_length : 0) + (entry & FAST_IMMEDIATE) + wide * 4;
+}
+
+/**
+ * Function to decode the length of an instruction, and what tells the features it needs.
+ *
+ * @param code The code.
+ * @param size The bytes left in the code.
+ * @param long_mode Whether the code is 64-bit, or 32-bit.
+ * @param insn A pointer to an \p instruction structure to store the instruction.
+ * @return The length of the instruction, or 0 if it does not fit in the code.
+ */
+static size_t decode(const uint8_t* code, const size_t size, const bool long_mode, struct instruction* insn) {
+    bool operand16 = false, address16 = false, rex_w = false;
+    enum prefix prefix = PREFIX_NONE;
+    uint8_t legacy;
+    size_t i = 0;
+
+    for (; i < size && i < 14 && (legacy = prefixes[code[i]]) & ~ESCAPE; ++i) {
+        if (legacy & LEGACY_66) {
+            operand16 = true;
+            if (prefix == PREFIX_NONE) prefix = PREFIX_66;
+        } else if (legacy & (LEGACY_F2 | LEGACY_F3)) {
+            prefix = legacy & LEGACY_F3 ? PREFIX_F3 : PREFIX_F2;
+        } else if (legacy & LEGACY_67) {
+            address16 = !long_mode;
+        }
+    }
+    if (long_mode && i < size && (code[i] & 0xf0) == 0x40) rex_w = code[i++] & 8;
+    if (i >= size) return 0;
+
+    // The byte after a one-byte instruction ending the code is never read as part of it
+    const uint8_t byte = code[i], next = i + 1 < size ? code[i + 1] : 0;
+    insn->encoding = ENCODING_LEGACY;
+    insn->map = 0;
+    insn->vector_length = 0;
+    insn->evex_b = false;
+
+    if (prefixes[byte] == ESCAPE && i + 1 < size) {
+        // Outside 64-bit mode, C4, C5 and 62 are LES, LDS and BOUND unless followed by a register ModRM
+        const bool vex_evex = long_mode || (next & 0xc0) == 0xc0;
+
+        if (byte == 0x0f) {
+            insn->map = next == 0x38 ? 2 : next == 0x3a ? 3 : 1;
+            i += insn->map == 1 ? 1 : 2;
+        } else if (byte == 0xd5 && long_mode) {
+            insn->encoding = ENCODING_REX2;
+            insn->map = next >> 7;
+            rex_w = next & 8;
+            i += 2;
+        } else if ((byte == 0xc4 && vex_evex) || (byte == 0x8f && (next & 0x1f) >= 8)) {
+            if (i + 2 >= size) return 0;
+            insn->encoding = byte == 0xc4 ? ENCODING_VEX : ENCODING_XOP;
+            insn->map = next & 0x1f;
+            rex_w = code[i + 2] >> 7;
+            insn->vector_length = code[i + 2] >> 2 & 1;
+            prefix = (enum prefix) (code[i + 2] & 3);
+            i += 3;
+        } else if (byte == 0xc5 && vex_evex) {
+            insn->encoding = ENCODING_VEX;
+            insn->map = 1;
+            insn->vector_length = next >> 2 & 1;
+            prefix = (enum prefix) (next & 3);
+            i += 2;
+        } else if (byte == 0x62 && vex_evex) {
+            if (i + 3 >= size) return 0;
+            insn->encoding = ENCODING_EVEX;
+            insn->map = next & 7;
+            rex_w = code[i + 2] >> 7;
+            prefix = (enum prefix) (code[i + 2] & 3);
+            insn->vector_length = code[i + 3] >> 5 & 3;
+            insn->evex_b = code[i + 3] >> 4 & 1;
+            i += 4;
+        }
+        if (i >= size) return 0;
+    }
+
+    const uint8_t opcode = code[i++];
+    insn->opcode = opcode;
+    insn->prefix = prefix;
+    insn->w = rex_w;
+
+    // Legacy maps 0 and 1, and map 4 of EVEX which holds the legacy instructions promoted by APX
+    const bool legacy_map = insn->encoding <= ENCODING_REX2 ? insn->map < 2
+                                                            : insn->encoding == ENCODING_EVEX && insn->map == 4;
+    uint8_t entry = 0;
+    if (legacy_map) entry = insn->map == 1 ? map1_opcodes[opcode] : map0_opcodes[opcode];
+    else if (insn->encoding <= ENCODING_REX2) entry = OPCODE_MODRM | OPCODE_CLASSIFY;
+    // VZEROUPPER and VZEROALL have no ModRM byte
+    else if (insn->encoding != ENCODING_VEX || insn->map != 1 || opcode != 0x77) entry = OPCODE_MODRM;
+    if (insn->encoding == ENCODING_EVEX) entry |= OPCODE_MODRM;
+
+    insn->has_modrm = entry & OPCODE_MODRM;
+    insn->classify = insn->encoding != ENCODING_LEGACY || entry & OPCODE_CLASSIFY;
+    insn->modrm = 0;
+
+    size_t length = i;
+    if (insn->has_modrm) {
+        if (i >= size) return 0;
+        insn->modrm = code[i];
+        const size_t modrm = modrm_size(code + i, size - i, address16);
+        if (!modrm) return 0;
+        length += modrm;
+    }
+
+    if (legacy_map) {
+        const enum immediate immediate = (enum immediate) (entry & OPCODE_IMMEDIATE);
+        if (immediate != IMMEDIATE_NONE)
+            length += immediate_size(immediate, opcode, prefix, operand16, address16, rex_w,
+                                     long_mode || insn->encoding == ENCODING_EVEX, insn->modrm);
+    } else if (insn->encoding <= ENCODING_REX2) {
+        length += insn->map == 3;
+    } else if (insn->encoding == ENCODING_XOP) {
+        length += insn->map == 8 ? 1 : insn->map == 10 ? 4 : 0;
+    } else if (insn->map == 1) {
+        length += (opcode >= 0x70 && opcode <= 0x73) || opcode == 0xc2 || (opcode >= 0xc4 && opcode <= 0xc6);
+    } else {
+        // URDMSR and UWRMSR of VEX map 7 take a 32-bit MSR index
+        length += insn->map == 3 ? 1 : insn->map == 7 && insn->encoding == ENCODING_VEX ? 4 : 0;
+    }
+
+    return length <= size ? length : 0;
+}
+
+/**
+ * Function to count an instruction requiring a feature.
+ */
+static void require(struct scan* scan, const enum cpuidx_feature feature, const uint64_t address) {
+    if (!scan->counts[feature]++) scan->first[feature] = address;
+}
+
+#define IN(value, low, high) ((value) >= (low) && (value) <= (high))
+
+/**
+ * Function to find the features a legacy-encoded instruction needs, beyond SSE2.
+ */
+static void classify_legacy(struct scan* scan, const struct instruction* insn, const uint64_t address,
+                            const bool long_mode) {
+    const uint8_t op = insn->opcode, reg = insn->modrm >> 3 & 7;
+    const bool memory = insn->has_modrm && insn->modrm >> 6 != 3;
+    const enum prefix prefix = insn->prefix;
+
+    if (insn->encoding == ENCODING_REX2) require(scan, CPUIDX_FEATURE_APXF, address);
+
+    switch (insn->map) {
+        case 0:
+            if (long_mode && (op == 0x9e || op == 0x9f)) require(scan, CPUIDX_FEATURE_LAHF_LM, address);
+            // XBEGIN and XABORT
+            if ((op == 0xc7 || op == 0xc6) && insn->modrm == 0xf8) require(scan, CPUIDX_FEATURE_RTM, address);
+            break;
+        case 1:
+            switch (op) {
+                case 0x01:
+                    if (insn->modrm == 0xc8 || insn->modrm == 0xc9) require(scan, CPUIDX_FEATURE_MONITOR, address);
+                    else if (insn->modrm == 0xd5 || insn->modrm == 0xd6) require(scan, CPUIDX_FEATURE_RTM, address);
+                    else if (insn->modrm == 0xe8 && prefix == PREFIX_NONE)
+                        require(scan, CPUIDX_FEATURE_SERIALIZE, address);
+                    else if ((insn->modrm == 0xe8 || insn->modrm == 0xe9) && prefix == PREFIX_F2)
+                        require(scan, CPUIDX_FEATURE_TSXLDTRK, address);
+                    else if (insn->modrm == 0xee || insn->modrm == 0xef) require(scan, CPUIDX_FEATURE_OSPKE, address);
+                    else if (insn->modrm == 0xf9) require(scan, CPUIDX_FEATURE_RDTSCP, address);
+                    else if (insn->modrm == 0xfa || insn->modrm == 0xfb) require(scan, CPUIDX_FEATURE_MWAITX, address);
+                    else if (insn->modrm == 0xfc) require(scan, CPUIDX_FEATURE_CLZERO, address);
+                    else if (insn->modrm == 0xfd) require(scan, CPUIDX_FEATURE_RDPRU, address);
+                    break;
+                case 0x12:
+                case 0x16:
+                    if (prefix == PREFIX_F3 || (op == 0x12 && prefix == PREFIX_F2))
+                        require(scan, CPUIDX_FEATURE_SSE3, address);
+                    break;
+                case 0x2b:
+                    if (prefix == PREFIX_F3 || prefix == PREFIX_F2) require(scan, CPUIDX_FEATURE_SSE4a, address);
+                    break;
+                case 0x78:
+                case 0x79:
+                    if (prefix == PREFIX_66 || prefix == PREFIX_F2) require(scan, CPUIDX_FEATURE_SSE4a, address);
+                    break;
+                case 0x7c:
+                case 0x7d:
+                case 0xd0:
+                    if (prefix == PREFIX_66 || prefix == PREFIX_F2) require(scan, CPUIDX_FEATURE_SSE3, address);
+                    break;
+                case 0xf0:
+                    if (prefix == PREFIX_F2) require(scan, CPUIDX_FEATURE_SSE3, address);
+                    break;
+                case 0xae:
+                    if (prefix == PREFIX_F3 && reg == 4) {
+                        require(scan, CPUIDX_FEATURE_PTWRITE, address);
+                    } else if (memory) {
+                        if (reg == 4 || reg == 5) require(scan, CPUIDX_FEATURE_XSAVE, address);
+                        else if (reg == 6 && prefix == PREFIX_NONE) require(scan, CPUIDX_FEATURE_XSAVEOPT, address);
+                        else if (reg == 6 && prefix == PREFIX_66) require(scan, CPUIDX_FEATURE_CLWB, address);
+                        else if (reg == 7 && prefix == PREFIX_66) require(scan, CPUIDX_FEATURE_CLFLUSHOPT, address);
+                    } else if (prefix == PREFIX_F3 && reg < 4) {
+                        require(scan, CPUIDX_FEATURE_FSGSBASE, address);
+                    } else if (reg == 6 && prefix != PREFIX_NONE) {
+                        require(scan, CPUIDX_FEATURE_WAITPKG, address);
+                    }
+                    break;
+                case 0xb8:
+                    if (prefix == PREFIX_F3) require(scan, CPUIDX_FEATURE_POPCNT, address);
+                    break;
+                case 0xbc:
+                    if (prefix == PREFIX_F3) require(scan, CPUIDX_FEATURE_BMI, address);
+                    break;
+                case 0xbd:
+                    if (prefix == PREFIX_F3) require(scan, CPUIDX_FEATURE_ABM, address);
+                    break;
+                case 0xc7:
+                    if (memory && reg == 1 && insn->w) require(scan, CPUIDX_FEATURE_CMPXCHG16B, address);
+                    else if (memory && reg == 4) require(scan, CPUIDX_FEATURE_XSAVEC, address);
+                    else if (!memory && reg == 6) require(scan, CPUIDX_FEATURE_RDRND, address);
+                    else if (!memory && reg == 7)
+                        require(scan, prefix == PREFIX_F3 ? CPUIDX_FEATURE_RDPID : CPUIDX_FEATURE_RDSEED, address);
+                    break;
+                default:
+                    break;
+            }
+            break;
+        case 2:
+            if ((op <= 0x0b || IN(op, 0x1c, 0x1e)) && prefix != PREFIX_F2 && prefix != PREFIX_F3)
+                require(scan, CPUIDX_FEATURE_SSSE3, address);
+            else if (prefix == PREFIX_66 && (op == 0x10 || op == 0x14 || op == 0x15 || op == 0x17 ||
+                                             IN(op, 0x20, 0x25) || IN(op, 0x28, 0x2b) || IN(op, 0x30, 0x35) ||
+                                             IN(op, 0x38, 0x41)))
+                require(scan, CPUIDX_FEATURE_SSE41, address);
+            else if (prefix == PREFIX_66 && op == 0x37) require(scan, CPUIDX_FEATURE_SSE42, address);
+            else if (prefix == PREFIX_NONE && IN(op, 0xc8, 0xcd)) require(scan, CPUIDX_FEATURE_SHA, address);
+            else if (prefix == PREFIX_66 && op == 0xcf) require(scan, CPUIDX_FEATURE_GFNI, address);
+            else if (prefix == PREFIX_66 && IN(op, 0xdb, 0xdf)) require(scan, CPUIDX_FEATURE_AESNI, address);
+            else if (op == 0xf0 || op == 0xf1)
+                require(scan, prefix == PREFIX_F2 ? CPUIDX_FEATURE_SSE42 : CPUIDX_FEATURE_MOVBE, address);
+            else if (op == 0xf6 && (prefix == PREFIX_66 || prefix == PREFIX_F3))
+                require(scan, CPUIDX_FEATURE_ADX, address);
+            else if (op == 0xf8 && prefix == PREFIX_66) require(scan, CPUIDX_FEATURE_MOVDIR64B, address);
+            else if (op == 0xf8 && prefix == PREFIX_F2) require(scan, CPUIDX_FEATURE_ENQCMD, address);
+            else if (op == 0xf9 && prefix == PREFIX_NONE) require(scan, CPUIDX_FEATURE_MOVDIRI, address);
+            else if (op == 0xfc && memory) require(scan, CPUIDX_FEATURE_RAOINT, address);
+            break;
+        case 3:
+            if (op == 0x0f && prefix != PREFIX_F2 && prefix != PREFIX_F3) require(scan, CPUIDX_FEATURE_SSSE3, address);
+            else if (prefix == PREFIX_66 && (IN(op, 0x08, 0x0e) || IN(op, 0x14, 0x17) || IN(op, 0x20, 0x22) ||
+                                             IN(op, 0x40, 0x42)))
+                require(scan, CPUIDX_FEATURE_SSE41, address);
+            else if (prefix == PREFIX_66 && IN(op, 0x60, 0x63)) require(scan, CPUIDX_FEATURE_SSE42, address);
+            else if (prefix == PREFIX_66 && op == 0x44) require(scan, CPUIDX_FEATURE_PCLMULQDQ, address);
+            else if (prefix == PREFIX_66 && op == 0xdf) require(scan, CPUIDX_FEATURE_AESNI, address);
+            else if (prefix == PREFIX_66 && (op == 0xce || op == 0xcf)) require(scan, CPUIDX_FEATURE_GFNI, address);
+            else if (prefix == PREFIX_NONE && op == 0xcc) require(scan, CPUIDX_FEATURE_SHA, address);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * Function to find the features a VEX-encoded instruction needs.
+ */
+static void classify_vex(struct scan* scan, const struct instruction* insn, const uint64_t address) {
+    const uint8_t op = insn->opcode;
+    const enum prefix prefix = insn->prefix;
+    const bool wide = insn->vector_length;
+
+    switch (insn->map) {
+        case 1:
+            // Mask register instructions of AVX-512
+            if (IN(op, 0x41, 0x4b) || IN(op, 0x90, 0x93) || op == 0x98 || op == 0x99) {
+                require(scan, CPUIDX_FEATURE_AVX512F, address);
+                return;
+            }
+            // 256-bit integer instructions
+            if (wide && prefix == PREFIX_66 &&
+                (IN(op, 0x60, 0x6d) || IN(op, 0x70, 0x76) || IN(op, 0xd1, 0xd5) || IN(op, 0xd7, 0xdf) ||
+                 IN(op, 0xe0, 0xe5) || IN(op, 0xe8, 0xef) || IN(op, 0xf1, 0xfe)))
+                require(scan, CPUIDX_FEATURE_AVX2, address);
+            else if (wide && op == 0x70) require(scan, CPUIDX_FEATURE_AVX2, address);
+            break;
+        case 2:
+            // The general-purpose instructions of BMI1 and BMI2, and AMX, need no vector state
+            if (IN(op, 0xf2, 0xf3) || (op == 0xf7 && prefix == PREFIX_NONE)) {
+                require(scan, CPUIDX_FEATURE_BMI, address);
+                return;
+            }
+            if (IN(op, 0xf5, 0xf7)) {
+                require(scan, CPUIDX_FEATURE_BMI2, address);
+                return;
+            }
+            if (op == 0x49 || op == 0x4b) {
+                require(scan, CPUIDX_FEATURE_AMXTILE, address);
+                return;
+            }
+            if (op == 0x5e || op == 0x5c || op == 0x6c) {
+                require(scan, op == 0x5e                          ? CPUIDX_FEATURE_AMXINT8
+                              : op == 0x6c                        ? CPUIDX_FEATURE_AMXCOMPLEX
+                              : prefix == PREFIX_F3              ? CPUIDX_FEATURE_AMXBF16
+                                                                 : CPUIDX_FEATURE_AMXFP16, address);
+                return;
+            }
+            if (IN(op, 0xe0, 0xef) && prefix == PREFIX_66) {
+                require(scan, CPUIDX_FEATURE_CMPCCXADD, address);
+                return;
+            }
+
+            if (IN(op, 0x96, 0x9f) || IN(op, 0xa6, 0xaf) || IN(op, 0xb6, 0xbf))
+                require(scan, CPUIDX_FEATURE_FMA, address);
+            else if (op == 0x13) require(scan, CPUIDX_FEATURE_F16C, address);
+            else if (IN(op, 0x50, 0x53) && prefix == PREFIX_66) require(scan, CPUIDX_FEATURE_AVXVNNI, address);
+            else if (IN(op, 0x50, 0x51)) require(scan, CPUIDX_FEATURE_AVXVNNIINT8, address);
+            else if (IN(op, 0xd2, 0xd3)) require(scan, CPUIDX_FEATURE_AVXVNNIINT16, address);
+            else if (IN(op, 0xb4, 0xb5)) require(scan, CPUIDX_FEATURE_AVXIFMA, address);
+            else if (IN(op, 0xb0, 0xb1) || op == 0x72) require(scan, CPUIDX_FEATURE_AVXNECONVERT, address);
+            else if (IN(op, 0xcb, 0xcd) && prefix == PREFIX_F2) require(scan, CPUIDX_FEATURE_SHA512, address);
+            else if (op == 0xda) require(scan, prefix >= PREFIX_F3 ? CPUIDX_FEATURE_SM4 : CPUIDX_FEATURE_SM3, address);
+            else if (op == 0xcf) require(scan, CPUIDX_FEATURE_GFNI, address);
+            else if (IN(op, 0xdb, 0xdf))
+                require(scan, wide ? CPUIDX_FEATURE_VAES : CPUIDX_FEATURE_AESNI, address);
+            else if (IN(op, 0x90, 0x93) || IN(op, 0x45, 0x47) || IN(op, 0x58, 0x5a) || IN(op, 0x78, 0x79) ||
+                     op == 0x8c || op == 0x8e || op == 0x16 || op == 0x36)
+                require(scan, CPUIDX_FEATURE_AVX2, address);
+            else if (wide && (op <= 0x0b || IN(op, 0x1c, 0x1e) || IN(op, 0x20, 0x25) || IN(op, 0x28, 0x2b) ||
+                              IN(op, 0x30, 0x35) || IN(op, 0x37, 0x40)))
+                require(scan, CPUIDX_FEATURE_AVX2, address);
+            break;
+        case 3:
+            if (op == 0xf0 && prefix == PREFIX_F2) {
+                require(scan, CPUIDX_FEATURE_BMI2, address);
+                return;
+            }
+            if (op <= 0x02 || op == 0x38 || op == 0x39 || op == 0x46 || (wide && (IN(op, 0x0e, 0x0f) || op == 0x42 ||
+                                                                                  op == 0x4c)))
+                require(scan, CPUIDX_FEATURE_AVX2, address);
+            else if (IN(op, 0x30, 0x33)) require(scan, CPUIDX_FEATURE_AVX512F, address);
+            else if (op == 0x1d) require(scan, CPUIDX_FEATURE_F16C, address);
+            else if (op == 0x44) require(scan, wide ? CPUIDX_FEATURE_VPCLMULQDQ : CPUIDX_FEATURE_PCLMULQDQ, address);
+            else if (op == 0xce || op == 0xcf) require(scan, CPUIDX_FEATURE_GFNI, address);
+            else if (op == 0xde) require(scan, CPUIDX_FEATURE_SM3, address);
+            else if (op == 0xdf) require(scan, CPUIDX_FEATURE_AESNI, address);
+            break;
+        case 7:
+            require(scan, CPUIDX_FEATURE_USERMSR, address);
+            return;
+        default:
+            break;
+    }
+
+    require(scan, CPUIDX_FEATURE_AVX, address);
+}
+
+/**
+ * Function to find the features an EVEX-encoded instruction needs.
+ */
+static void classify_evex(struct scan* scan, const struct instruction* insn, const uint64_t address) {
+    const uint8_t op = insn->opcode;
+    const enum prefix prefix = insn->prefix;
+    const bool register_rounding = insn->evex_b && insn->has_modrm && insn->modrm >> 6 == 3;
+
+    // Map 4 holds the legacy instructions promoted by APX
+    if (insn->map == 4) {
+        require(scan, CPUIDX_FEATURE_APXF, address);
+        return;
+    }
+
+    require(scan, CPUIDX_FEATURE_AVX512F, address);
+    // 256-bit vectors; 128-bit ones cannot be told from scalar instructions without a full opcode table
+    if (insn->vector_length == 1 && !register_rounding) require(scan, CPUIDX_FEATURE_AVX512VL, address);
+
+    switch (insn->map) {
+        case 1:
+            if (prefix == PREFIX_66 &&
+                (op == 0x60 || op == 0x61 || IN(op, 0x63, 0x65) || IN(op, 0x67, 0x69) || op == 0x6b ||
+                 op == 0x71 || op == 0x74 || op == 0x75 || op == 0xd1 || op == 0xd5 || op == 0xd8 || op == 0xd9 ||
+                 op == 0xdc || op == 0xdd || IN(op, 0xe0, 0xe1) || IN(op, 0xe3, 0xe5) || op == 0xe8 ||
+                 op == 0xe9 || op == 0xec || op == 0xed || op == 0xf1 || op == 0xf5 || op == 0xf6 || op == 0xf8 ||
+                 op == 0xf9 || op == 0xfc || op == 0xfd))
+                require(scan, CPUIDX_FEATURE_AVX512BW, address);
+            else if ((op == 0x6f || op == 0x7f) && prefix == PREFIX_F2) require(scan, CPUIDX_FEATURE_AVX512BW, address);
+            else if ((IN(op, 0x54, 0x57) && prefix <= PREFIX_66) || (IN(op, 0x7a, 0x7b) && prefix == PREFIX_66))
+                require(scan, CPUIDX_FEATURE_AVX512DQ, address);
+            break;
+        case 2:
+            if (prefix == PREFIX_66) {
+                if (op == 0x00 || op == 0x04 || IN(op, 0x10, 0x12) || IN(op, 0x1c, 0x1d) || op == 0x20 ||
+                    op == 0x30 || op == 0x66 || IN(op, 0x78, 0x79) || op == 0x7a || op == 0x7b ||
+                    (insn->w && (op == 0x75 || op == 0x7d || op == 0x8d)))
+                    require(scan, CPUIDX_FEATURE_AVX512BW, address);
+                else if (op == 0x40 && insn->w) require(scan, CPUIDX_FEATURE_AVX512DQ, address);
+                else if (op == 0x44 || op == 0xc4) require(scan, CPUIDX_FEATURE_AVX512CD, address);
+                else if (IN(op, 0xb4, 0xb5)) require(scan, CPUIDX_FEATURE_AVX512IFMA, address);
+                else if ((!insn->w && (op == 0x75 || op == 0x7d || op == 0x8d)) || (insn->w && op == 0x83))
+                    require(scan, CPUIDX_FEATURE_AVX512VBMI, address);
+                else if (IN(op, 0x62, 0x63) || IN(op, 0x70, 0x73)) require(scan, CPUIDX_FEATURE_AVX512VBMI2, address);
+                else if (IN(op, 0x50, 0x53)) require(scan, CPUIDX_FEATURE_AVX512VNNI, address);
+                else if (op == 0x54 || op == 0x8f) require(scan, CPUIDX_FEATURE_AVX512BITALG, address);
+                else if (op == 0x55) require(scan, CPUIDX_FEATURE_AVX512VPOPCNTDQ, address);
+                else if (op == 0xcf) require(scan, CPUIDX_FEATURE_GFNI, address);
+                else if (IN(op, 0xdc, 0xdf)) require(scan, CPUIDX_FEATURE_VAES, address);
+                else if (op == 0xc8 || IN(op, 0xca, 0xcd)) require(scan, CPUIDX_FEATURE_AVX512ER, address);
+                else if (op == 0xc6 || op == 0xc7) require(scan, CPUIDX_FEATURE_AVX512PF, address);
+            } else if (prefix == PREFIX_F3 && (op == 0x52 || op == 0x72)) {
+                require(scan, CPUIDX_FEATURE_AVX512BF16, address);
+            } else if (prefix == PREFIX_F2) {
+                if (op == 0x72) require(scan, CPUIDX_FEATURE_AVX512BF16, address);
+                else if (op == 0x68) require(scan, CPUIDX_FEATURE_AVX512VP2INTERSECT, address);
+                else if (IN(op, 0x52, 0x53)) require(scan, CPUIDX_FEATURE_AVX5124VNNIW, address);
+                else if (IN(op, 0x9a, 0x9b) || IN(op, 0xaa, 0xab)) require(scan, CPUIDX_FEATURE_AVX5124FMAPS, address);
+            } else if (prefix == PREFIX_F3 && (op == 0x2a || op == 0x3a)) {
+                require(scan, CPUIDX_FEATURE_AVX512CD, address);
+            }
+            break;
+        case 3:
+            // Map 3 has no AVX-512 instruction without a prefix before AVX512-FP16
+            if (prefix == PREFIX_NONE) require(scan, CPUIDX_FEATURE_AVX512FP16, address);
+            else if (op == 0x44) require(scan, CPUIDX_FEATURE_VPCLMULQDQ, address);
+            else if (op == 0xce || op == 0xcf) require(scan, CPUIDX_FEATURE_GFNI, address);
+            else if (IN(op, 0x70, 0x73)) require(scan, CPUIDX_FEATURE_AVX512VBMI2, address);
+            else if (op == 0x3e || op == 0x3f || op == 0x42) require(scan, CPUIDX_FEATURE_AVX512BW, address);
+            else if (IN(op, 0x50, 0x51) || IN(op, 0x56, 0x57) || IN(op, 0x66, 0x67))
+                require(scan, CPUIDX_FEATURE_AVX512DQ, address);
+            break;
+        case 5:
+        case 6:
+            require(scan, CPUIDX_FEATURE_AVX512FP16, address);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * Function to decode code linearly from an offset, and count the instructions needing each feature.
+ *
+ * Bytes that do not decode, e.g. data in the code, are skipped one at a time.
+ *
+ * @return The offset of the first instruction at or after \p stop, or the size of the code.
+ */
+static size_t scan_range(struct scan* scan, const uint8_t* code, const size_t size, size_t offset, const size_t stop,
+                         const uint64_t address, const bool long_mode) {
+    struct instruction insn;
+
+    while (offset < stop) {
+        if (size - offset >= 16) {
+            const size_t length = decode_fast(code + offset, long_mode);
+            if (length) {
+                ++scan->instructions;
+                offset += length;
+                continue;
+            }
+        }
+
+        const size_t length = decode(code + offset, size - offset, long_mode, &insn);
+        if (!length) {
+            ++offset;
+            continue;
+        }
+
+        switch (insn.encoding) {
+            case ENCODING_VEX:
+                classify_vex(scan, &insn, address + offset);
+                break;
+            case ENCODING_EVEX:
+                classify_evex(scan, &insn, address + offset);
+                break;
+            case ENCODING_XOP:
+                require(scan, CPUIDX_FEATURE_XOP, address + offset);
+                break;
+            default:
+                if (insn.classify) classify_legacy(scan, &insn, address + offset, long_mode);
+                break;
+        }
+
+        ++scan->instructions;
+        offset += length;
+    }
+    return offset;
+}
+
+/**
+ * @brief A chunk of code, scanned by a thread of its own.
+ */
+struct chunk {
+    struct scan scan; /**< The instructions from \p counted_from to \p exit */
+    const uint8_t* code; /**< The code the chunk is part of */
+    size_t size; /**< The size of the code */
+    uint64_t address; /**< The address of the code */
+    bool long_mode; /**< Whether the code is 64-bit */
+    size_t begin; /**< The offset of the chunk in the code */
+    size_t end; /**< The offset of the end of the chunk */
+    size_t counted_from; /**< The offset of the first instruction counted */
+    size_t exit; /**< The offset of the first instruction at or after \p end */
+};
+
+/**
+ * Function to scan a chunk of code, from a thread.
+ *
+ * The chunk likely begins amid an instruction; a linear sweep realigns with the instructions within a few of them,
+ * so the first \p SYNC_SIZE bytes are decoded without counting.
+ *
+ * @param argument A pointer to the \p chunk structure.
+ * @return 0.
+ */
+static int scan_chunk(void* argument) {
+    struct chunk* chunk = argument;
+    struct scan discarded = {0};
+    const size_t sync_end = chunk->end - chunk->begin > SYNC_SIZE ? chunk->begin + SYNC_SIZE : chunk->end;
+
+    chunk->counted_from = scan_range(&discarded, chunk->code, chunk->size, chunk->begin, sync_end, chunk->address,
+                                     chunk->long_mode);
+    chunk->exit = scan_range(&chunk->scan, chunk->code, chunk->size, chunk->counted_from, chunk->end,
+                             chunk->address, chunk->long_mode);
+    return 0;
+}
+
+/**
+ * Function to add the counts of a scan to another.
+ */
+static void merge_scan(struct scan* scan, const struct scan* other) {
+    for (size_t i = 0; i < CPUIDX_FEATURE_COUNT; ++i) {
+        if (!other->counts[i]) continue;
+        if (!scan->counts[i] || other->first[i] < scan->first[i]) scan->first[i] = other->first[i];
+        scan->counts[i] += other->counts[i];
+    }
+    scan->instructions += other->instructions;
+}
+
+/**
+ * Function to decode code linearly, and count the instructions needing each feature.
+ *
+ * Large code is split in a chunk per online CPU, as each instruction's length depends on the previous one,
+ * which bounds a single thread to a few hundred megabytes per second. The chunks are then joined exactly:
+ * from where the previous chunk ended, instructions are decoded up to the first one its thread counted.
+ * Landing on it means the thread decoded the same instructions from there; otherwise the chunk is rescanned.
+ */
+static void scan_code(struct scan* scan, const uint8_t* code, const size_t size, const uint64_t address,
+                      const bool long_mode) {
+    static struct chunk chunks[MAX_THREADS];
+    thrd_t threads[MAX_THREADS];
+    bool started[MAX_THREADS];
+    const long online = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t count = size / MIN_CHUNK_SIZE;
+
+    if (online > 0 && count > (size_t) online) count = (size_t) online;
+    if (count > MAX_THREADS) count = MAX_THREADS;
+    scan->code_bytes += size;
+
+    if (count < 2) {
+        scan_range(scan, code, size, 0, size, address, long_mode);
+        return;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        chunks[i] = (struct chunk) {.code = code, .size = size, .address = address, .long_mode = long_mode,
+                                    .begin = size * i / count, .end = size * (i + 1) / count};
+        started[i] = thrd_create(&threads[i], scan_chunk, &chunks[i]) == thrd_success;
+        if (!started[i]) scan_chunk(&chunks[i]);
+    }
+    for (size_t i = 0; i < count; ++i)
+        if (started[i]) thrd_join(threads[i], NULL);
+
+    size_t offset = 0;
+    for (size_t i = 0; i < count; ++i) {
+        offset = scan_range(scan, code, size, offset, chunks[i].counted_from, address, long_mode);
+        if (offset == chunks[i].counted_from) {
+            merge_scan(scan, &chunks[i].scan);
+            offset = chunks[i].exit;
+        } else {
+            offset = scan_range(scan, code, size, offset, chunks[i].end, address, long_mode);
+        }
+    }
+}
+
+/**
+ * Function to get the x86-64 level of an ISA_1 property, whose bits 0 to 3 are BASELINE, V2, V3 and V4.
+ */
+static uint32_t isa_level(const uint32_t value) {
+    uint32_t level = 0;
+    for (uint32_t bits = value & 0xf; bits; bits >>= 1) ++level;
+    return level;
+}
+
+/**
+ * Function to add the features of an ISA_1_NEEDED level, or of the FEATURE_2_NEEDED register states.
+ */
+static void add_needed(struct scan* scan, const uint32_t type, const uint32_t value) {
+    if (type == GNU_PROPERTY_X86_ISA_1_NEEDED) {
+        const uint32_t level = isa_level(value);
+        cpu_features level_features;
+        bool* values = (bool*) &scan->needed;
+        const bool* level_values = (const bool*) &level_features;
+
+        if (level > scan->needed_level) scan->needed_level = level;
+        if (!level || cpuidx_profile_features((enum cpuidx_profile) level, &level_features) != 0) return;
+        for (size_t i = 0; i < CPUIDX_FEATURE_COUNT; ++i) values[i] |= level_values[i];
+        return;
+    }
+
+    if (value & FEATURE_2_YMM) scan->needed.AVX = true;
+    if (value & (FEATURE_2_ZMM | FEATURE_2_MASK)) scan->needed.AVX512F = true;
+    if (value & FEATURE_2_XSAVE) scan->needed.XSAVE = true;
+    if (value & FEATURE_2_XSAVEOPT) scan->needed.XSAVEOPT = true;
+    if (value & FEATURE_2_XSAVEC) scan->needed.XSAVEC = true;
+    if (value & FEATURE_2_TMM) scan->needed.AMXTILE = true;
+}
+
+/**
+ * Function to read the x86 properties of the notes in a section or segment.
+ *
+ * @param notes The notes.
+ * @param size The size of the notes.
+ * @param alignment The alignment of the properties: 8 in ELF64, 4 in ELF32.
+ */
+static void read_properties(struct scan* scan, const uint8_t* notes, const size_t size, const size_t alignment) {
+    for (size_t offset = 0; offset + 12 <= size;) {
+        uint32_t header[3]; // namesz, descsz, type
+        memcpy(header, notes + offset, sizeof(header));
+
+        const size_t name = offset + 12, descriptor = name + ((header[0] + 3) & ~3u);
+        if (descriptor + header[1] > size) return;
+
+        if (header[2] == NT_GNU_PROPERTY_TYPE_0 && header[0] == 4 && memcmp(notes + name, "GNU", 4) == 0) {
+            for (size_t property = descriptor; property + 8 <= descriptor + header[1];) {
+                uint32_t type_size[2], value = 0;
+                memcpy(type_size, notes + property, sizeof(type_size));
+                if (property + 8 + type_size[1] > descriptor + header[1]) break;
+                if (type_size[1] >= 4) memcpy(&value, notes + property + 8, sizeof(value));
+
+                if (type_size[0] == GNU_PROPERTY_X86_ISA_1_NEEDED ||
+                    type_size[0] == GNU_PROPERTY_X86_FEATURE_2_NEEDED) {
+                    add_needed(scan, type_size[0], value);
+                    scan->has_notes = true;
+                } else if (type_size[0] == GNU_PROPERTY_X86_ISA_1_USED) {
+                    if (isa_level(value) > scan->used_level) scan->used_level = isa_level(value);
+                    scan->has_notes = true;
+                } else if (type_size[0] == GNU_PROPERTY_X86_FEATURE_2_USED) {
+                    scan->has_notes = true;
+                }
+                property += 8 + ((type_size[1] + alignment - 1) & ~(alignment - 1));
+            }
+        }
+        offset = descriptor + ((header[1] + 3) & ~3u);
+    }
+}
+
+/**
+ * @brief A section or segment of an ELF file, of either class.
+ */
+struct region {
+    uint64_t offset; /**< The offset in the file */
+    uint64_t size; /**< The size in the file */
+    uint64_t address; /**< The virtual address */
+    bool executable; /**< The region holds code */
+    bool notes; /**< The region holds notes */
+};
+
+/**
+ * Function to check that a table of the ELF header lies within the file.
+ *
+ * @return true if the table is within the file, and its entries are large enough.
+ */
+static bool valid_table(const uint64_t offset, const size_t count, const size_t entry_size,
+                        const size_t minimum_entry_size, const size_t size) {
+    return entry_size >= minimum_entry_size && offset <= size && count * entry_size <= size - offset;
+}
+
+/**
+ * Function to scan an ELF file mapped in memory.
+ *
+ * The code is read from the executable sections, or from the executable segments without section headers or
+ * when the section header table is out of bounds, and the properties from .note.gnu.property, or from
+ * PT_GNU_PROPERTY.
+ *
+ * @return 0 on success, -1 if the file is not an x86 ELF file, -2 if it is truncated or malformed.
+ */
+static int scan_elf(struct scan* scan, const uint8_t* file, const size_t size) {
+    if (size < sizeof(Elf32_Ehdr) || memcmp(file, ELFMAG, SELFMAG) != 0 || file[EI_DATA] != ELFDATA2LSB) return -1;
+
+    const bool elf64 = file[EI_CLASS] == ELFCLASS64;
+    Elf64_Ehdr header;
+    if (elf64) {
+        if (size < sizeof(Elf64_Ehdr)) return -2;
+        memcpy(&header, file, sizeof(header));
+    } else {
+        Elf32_Ehdr header32;
+        memcpy(&header32, file, sizeof(header32));
+        header.e_machine = header32.e_machine;
+        header.e_shoff = header32.e_shoff;
+        header.e_shnum = header32.e_shnum;
+        header.e_shentsize = header32.e_shentsize;
+        header.e_phoff = header32.e_phoff;
+        header.e_phnum = header32.e_phnum;
+        header.e_phentsize = header32.e_phentsize;
+    }
+    if (header.e_machine != EM_X86_64 && header.e_machine != EM_386) return -1;
+
+    // x32 is ELF32 in 64-bit mode
+    const bool long_mode = header.e_machine == EM_X86_64;
+    bool sections = header.e_shnum && header.e_shoff;
+
+    // Stripped or truncated files may keep the program headers only, which cover the code as well
+    if (sections && !valid_table(header.e_shoff, header.e_shnum, header.e_shentsize,
+                                 elf64 ? sizeof(Elf64_Shdr) : sizeof(Elf32_Shdr), size)) {
+        scan->malformed_sections = true;
+        sections = false;
+    }
+    if (!sections && !valid_table(header.e_phoff, header.e_phnum, header.e_phentsize,
+                                  elf64 ? sizeof(Elf64_Phdr) : sizeof(Elf32_Phdr), size))
+        return -2;
+
+    const size_t count = sections ? header.e_shnum : header.e_phnum;
+    const uint64_t table = sections ? header.e_shoff : header.e_phoff;
+    const size_t entry_size = sections ? header.e_shentsize : header.e_phentsize;
+
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t* entry = file + table + i * entry_size;
+        struct region region = {0};
+
+        if (sections && elf64) {
+            Elf64_Shdr section;
+            memcpy(&section, entry, sizeof(section));
+            region = (struct region) {section.sh_offset, section.sh_type == SHT_NOBITS ? 0 : section.sh_size,
+                                      section.sh_addr, section.sh_flags & SHF_EXECINSTR, section.sh_type == SHT_NOTE};
+        } else if (sections) {
+            Elf32_Shdr section;
+            memcpy(&section, entry, sizeof(section));
+            region = (struct region) {section.sh_offset, section.sh_type == SHT_NOBITS ? 0 : section.sh_size,
+                                      section.sh_addr, section.sh_flags & SHF_EXECINSTR, section.sh_type == SHT_NOTE};
+        } else if (elf64) {
+            Elf64_Phdr segment;
+            memcpy(&segment, entry, sizeof(segment));
+            region = (struct region) {segment.p_offset, segment.p_filesz, segment.p_vaddr,
+                                      segment.p_type == PT_LOAD && segment.p_flags & PF_X,
+                                      segment.p_type == PT_GNU_PROPERTY};
+        } else {
+            Elf32_Phdr segment;
+            memcpy(&segment, entry, sizeof(segment));
+            region = (struct region) {segment.p_offset, segment.p_filesz, segment.p_vaddr,
+                                      segment.p_type == PT_LOAD && segment.p_flags & PF_X,
+                                      segment.p_type == PT_GNU_PROPERTY};
+        }
+
+        if (region.offset > size || region.size > size - region.offset) continue;
+        if (region.executable) scan_code(scan, file + region.offset, region.size, region.address, long_mode);
+        if (region.notes) read_properties(scan, file + region.offset, region.size, elf64 ? 8 : 4);
+    }
+
+    return 0;
+}
+
+/**
+ * Function to scan an ELF file, and print the features it requires with whether the target has them.
+ *
+ * @param path The path of the file.
+ * @param target The features of the target.
+ * @return 0 if the target has all the features, 1 if it lacks needed ones, 2 if it lacks ones found in the code,
+ *         or 3 if the file cannot be scanned.
+ */
+static int scan_file(const char* path, const cpu_features* target) {
+    static struct scan scan;
+    struct stat status;
+    const int file = open(path, O_RDONLY);
+
+    if (file < 0 || fstat(file, &status) != 0 || status.st_size == 0) {
+        perror(path);
+        if (file >= 0) close(file);
+        return 3;
+    }
+
+    void* mapping = mmap(NULL, (size_t) status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (mapping == MAP_FAILED) {
+        perror(path);
+        return 3;
+    }
+    madvise(mapping, (size_t) status.st_size, MADV_SEQUENTIAL);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    memset(&scan, 0, sizeof(scan));
+    const int result = scan_elf(&scan, mapping, (size_t) status.st_size);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    munmap(mapping, (size_t) status.st_size);
+
+    if (result != 0) {
+        fprintf(stderr, "%s: %s\n", path, result == -1 ? "not an x86 ELF file" : "truncated or malformed ELF file");
+        return 3;
+    }
+    if (scan.malformed_sections)
+        fprintf(stderr, "%s: truncated or malformed section header table, scanning the segments instead\n", path);
+
+    const double ms = (double) (end.tv_sec - start.tv_sec) * 1e3 + (double) (end.tv_nsec - start.tv_nsec) / 1e6;
+    const bool* target_values = (const bool*) target;
+    const bool* needed = (const bool*) &scan.needed;
+    int status_code = 0;
+
+    printf("%s: %llu instructions in %llu bytes of code, scanned in %.1f ms\n", path,
+           (unsigned long long) scan.instructions, (unsigned long long) scan.code_bytes, ms);
+    if (scan.has_notes) {
+        if (scan.needed_level) printf("ISA needed: x86-64-v%u", scan.needed_level);
+        else printf("ISA needed: no level");
+        if (scan.used_level) printf(", used: x86-64-v%u", scan.used_level);
+        putchar('\n');
+    } else {
+        puts("No x86 ISA properties");
+    }
+
+    printf("\n%-20s %10s %18s  %s\n", "Feature", "Count", "First", "Target");
+    for (size_t i = 0; i < CPUIDX_FEATURE_COUNT; ++i) {
+        // The needed features are listed only when missing, as the baseline is always needed
+        if (!scan.counts[i] && (!needed[i] || target_values[i])) continue;
+
+        const char* verdict = target_values[i] ? "yes" : needed[i] ? "MISSING (needed)" : "MISSING";
+        if (scan.counts[i])
+            printf("%-20s %10llu %#18llx  %s\n", cpuidx_feature_name(i), (unsigned long long) scan.counts[i],
+                   (unsigned long long) scan.first[i], verdict);
+        else
+            printf("%-20s %10s %18s  %s\n", cpuidx_feature_name(i), "-", "-", verdict);
+
+        if (!target_values[i]) {
+            if (needed[i]) status_code = 1;
+            else if (!status_code) status_code = 2;
+        }
+    }
+
+    if (status_code == 1) puts("\nThe target lacks features the file needs: it fails to run there.");
+    else if (status_code == 2)
+        puts("\nThe target lacks features of instructions in the code: they fault there unless guarded by dispatch.");
+    return status_code;
+}
+
+int main(const int argc, char** argv) {
+    const char* profile = NULL;
+    int result = 0, files = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--profile=", 10) == 0) profile = argv[i] + 10;
+        else if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 3;
+        }
+    }
+
+    init_tables();
+
+    cpu_features profile_features;
+    if (profile && cpuidx_parse_profile(profile, &profile_features) != 0) {
+        fprintf(stderr, "Invalid profile: %s\n", profile);
+        return 3;
+    }
+    // Without a profile, the host features are those verified to execute natively
+    const cpu_features* target = profile ? &profile_features : cpuidx_verified_features();
+
+    for (int i = 1; i < argc; ++i) {
+        if (argv[i][0] == '-') continue;
+        if (files++) putchar('\n');
+
+        const int file_result = scan_file(argv[i], target);
+        // Report the worst outcome: a file not scanned, then missing needed features, then missing others
+        if (result != 3 && (file_result == 3 || file_result == 1 || !result)) result = file_result;
+    }
+
+    if (!files) {
+        print_usage(argv[0]);
+        return 3;
+    }
+    return result;
+}
@@ -0,0 +1,65 @@
+#if !(__x86_64__ || __86_64 || __amd64__ || __amd64 || __i386__ || __i386 || _M_AMD64 || _M_X64 || _M_IX86 || __X86__ || _X86_)
+#error "The target arch is not x86."
+#endif
+
+#include <cpuidx.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <sys/stat.h>
+#endif
+
+/**
+ * Prints the usage of the program.
+ *
+ * @param program The name of the program.
+ */
+void print_usage(const char* program) {
+    printf("Usage: %s [option]...\n\n", program);
+    puts("Captures the CPU features, caches and topology of the host once, and publishes them as a snapshot");
+    puts("that the cpuidx library maps instead of running CPUID, with the features the self-test saw execute");
+    puts("natively. Run it at boot, and after CPU hotplug.\n");
+    puts("Options:");
+    printf("  --output=FILE     Write the snapshot to FILE instead of %s\n", CPUIDX_SNAPSHOT_PATH);
+    puts("  --help            Print this help and exit");
+}
+
+int main(const int argc, char** argv) {
+    const char* output = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--output=", 9) == 0) output = argv[i] + 9;
+        else if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+#if defined(__linux__)
+    // The directory of the default path is on a tmpfs, which is empty at boot
+    if (!output && mkdir("/run/cpuidx", 0755) != 0 && errno != EEXIST) {
+        perror("/run/cpuidx");
+        return 1;
+    }
+#endif
+
+    const int cpus = cpuidx_publish_snapshot(output);
+
+    if (cpus == -2) {
+        fputs("Snapshots are not supported on this system.\n", stderr);
+        return 1;
+    }
+    if (cpus < 0) {
+        fprintf(stderr, "Cannot publish the snapshot to %s.\n", output ? output : CPUIDX_SNAPSHOT_PATH);
+        return 1;
+    }
+
+    printf("Published a snapshot of %d CPUs to %s\n", cpus, output ? output : CPUIDX_SNAPSHOT_PATH);
+    return 0;
+}
@@ -4,6 +4,9 @@
 
 #include <cpuidx.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #ifndef CPUIDX_BOOL_AVAILABLE
 #include <stdbool.h>
@@ -28,6 +31,9 @@ void print_basic_info(const cpu_basic_info* const info) {
     if (info->highest_extended_leaf)
         printf("\tHighest extended function number implemented: 0x%x (%u)\n", info->highest_extended_leaf,
                info->highest_extended_leaf);
+
+    printf("\tCache line size: %zu bytes\n", cpuidx_cache_line_size());
+    printf("\tDestructive interference size: %zu bytes\n", cpuidx_destructive_interference_size());
 }
 
 /**
@@ -151,7 +157,8 @@ void print_available_features(const cpu_features* feats) {
         "FMA4: 4-operand fused multiply-add instructions", "TBM: Trailing Bit Manipulation",
         "MWAITX: MONITORX and MWAITX instructions", "MMXEXT: Extended MMX", "LM: Long mode",
         "3DNOWP: Extended 3DNow!", "3DNOW: 3DNow!", "CLZERO: CLZERO instruction", "RDPRU: RDPRU instruction",
-        "WBNOINVD: WBNOINVD instruction",
+        "WBNOINVD: WBNOINVD instruction", "RDTSCP: RDTSCP instruction and IA32_TSC_AUX MSR",
+        "UAI: Upper Address Ignore", "LAM: Linear Address Masking",
     };
 
     const bool* feature_values = (const bool*)feats;
@@ -164,7 +171,665 @@ void print_available_features(const cpu_features* feats) {
     }
 }
 
-int main() {
+/**
+ * Prints the usage of the program.
+ *
+ * @param program The name of the program.
+ */
+void print_usage(const char* program) {
+    printf("Usage: %s [option]...\n\n", program);
+    puts("Without options, prints the basic CPU information and the available CPU features.\n");
+    puts("Options:");
+    puts("  --profile=SPEC    Target SPEC instead of the host: a list of x86-64 levels and feature names,");
+    puts("                    e.g. x86-64-v3,AVX512VNNI");
+    puts("  --march           Print the -march value for the target");
+    puts("  --mtune           Print the -mtune value for the host");
+    puts("  --cflags          Print the GCC/Clang flags for the target");
+    puts("  --target-clones   Print a GCC/Clang target_clones list for the target");
+    puts("  --compiler-info   Print all the above as KEY=VALUE lines");
+    puts("  --header          Print a C/C++ header of compile-time feature constants for the target");
+    puts("  --xsave           Print the XSAVE state components of the host and their sizes");
+    puts("  --amx             Enable AMX for the process, and print the tile palette and TMUL information");
+    puts("  --power           Print the power management capabilities and the cpufreq policy, and exit with 1 if");
+    puts("                    the policy hurts latency (powersave governor or EPP, turbo disabled), or with 2 if");
+    puts("                    it cannot be read");
+    puts("  --mitigations     Print the speculative-execution mitigations of the kernel, and benchmark what they");
+    puts("                    cost: system calls, context switches and VERW");
+    puts("  --self-test       Run an instruction of each detected feature, and exit with 1 if one faults or is");
+    puts("                    trapped and emulated");
+    puts("  --probe-ports     Measure the vector throughput of the core, and print the execution units it implies");
+    puts("  --frequency-license");
+    puts("                    Measure the frequency drop of the core running FMA code of each vector width");
+    puts("  --measure-isa     Measure instructions whose speed varies across CPUs, as a cache file for");
+    puts("                    cpuidx_load_isa_timings");
+    puts("  --gemm            Print the caches and the GEMM blocking recommended for the target, and benchmark");
+    puts("                    the reference SGEMM with it");
+    puts("  --topology        Print the package, CCX, core and thread of each logical CPU, and the current one");
+    puts("  --dump            Print the raw registers of every implemented leaf and sub-leaf, for offline capture");
+    puts("  --tagging         Print the pointer bits available for tags in this process");
+    puts("  --tsx             Print whether TSX transactions are usable, and the commit rate of an elided lock");
+    puts("  --cpu=N           Measure logical CPU N instead of the current one");
+    puts("  --output=FILE     Write to FILE instead of the standard output");
+    puts("  --help            Print this help and exit");
+}
+
+/**
+ * Prints compiler flags targeting a feature set.
+ *
+ * @param option The option selecting what to print, e.g. "--cflags".
+ * @param features A pointer to a \p cpu_features structure of the target.
+ * @param basic_info A pointer to a \p cpu_basic_info structure of the host, or a null pointer if not targeting it.
+ */
+void print_compiler_info(const char* option, const cpu_features* features, const cpu_basic_info* basic_info) {
+    static const char* const level_names[] = {"", "x86-64", "x86-64-v2", "x86-64-v3", "x86-64-v4"};
+    const int level = get_x86_64_level(features);
+    const char* tune = basic_info ? cpuidx_tune_name(basic_info, features) : "generic";
+    const bool all = strcmp(option, "--compiler-info") == 0;
+    char buffer[2048];
+
+    if (all) printf("X86_64_LEVEL=%d\n", level);
+
+    if (all || strcmp(option, "--march") == 0) printf("%s%s\n", all ? "MARCH=" : "", level_names[level]);
+
+    if (all || strcmp(option, "--mtune") == 0) printf("%s%s\n", all ? "MTUNE=" : "", tune);
+
+    if (all || strcmp(option, "--cflags") == 0) {
+        cpuidx_compiler_flags(features, basic_info, buffer, sizeof(buffer));
+        printf("%s%s\n", all ? "FLAGS=" : "", buffer);
+    }
+
+    if (all || strcmp(option, "--target-clones") == 0) {
+        cpuidx_target_clones(features, buffer, sizeof(buffer));
+        printf("%s%s\n", all ? "TARGET_CLONES=" : "", buffer);
+    }
+}
+
+/**
+ * Prints a header of compile-time feature constants.
+ *
+ * Each feature of the target is a \p CPUIDX_COMPILED_<feature> macro, also available as a C23 \p constexpr
+ * \p cpuidx_compiled_<feature> and a C++ \p cpuidx::compiled::<feature> constant. A feature missing from the target
+ * is still enabled when the compiler predefines its macro, e.g. \p __AVX2__ under \p -mavx2.
+ *
+ * @param features A pointer to a \p cpu_features structure of the target.
+ * @param profile The profile specification of the target, or a null pointer for the host.
+ */
+void print_compiled_header(const cpu_features* features, const char* profile) {
+    const bool* values = (const bool*) features;
+
+    printf("// Generated by cpuidz --header for %s. Do not edit.\n", profile ? profile : "the build host");
+    puts("#pragma once\n#ifndef CPUIDX_COMPILED_H\n#define CPUIDX_COMPILED_H\n");
+
+    for (size_t i = 0; i < CPUIDX_FEATURE_COUNT; ++i) {
+        const char* name = cpuidx_feature_name(i);
+        const char* macro = cpuidx_feature_macro(i);
+
+        if (values[i] || !macro) printf("#define CPUIDX_COMPILED_%s %d\n", name, values[i]);
+        else
+            printf("#ifdef %s\n#define CPUIDX_COMPILED_%s 1\n#else\n#define CPUIDX_COMPILED_%s 0\n#endif\n",
+                   macro, name, name);
+    }
+
+#define CPUIDX_X_CPP(field, name, leaf, sub_leaf, reg, mask) \
+    "static constexpr bool " #field " = CPUIDX_COMPILED_" name ";\n"
+#define CPUIDX_X_C(field, name, leaf, sub_leaf, reg, mask) \
+    "static constexpr bool cpuidx_compiled_" #field " = CPUIDX_COMPILED_" name ";\n"
+
+    puts("\n#ifdef __cplusplus\nnamespace cpuidx::compiled {");
+    fputs(CPUIDX_FEATURES(CPUIDX_X_CPP), stdout);
+    // The same test as cpuidx.h, which the generated header does not include
+    puts("} // namespace cpuidx::compiled\n"
+         "// C23 support for constexpr.\n"
+         "// The full C23 standard should be 202311L, but GCC has constexpr at 202000L\n"
+         "#elif __STDC_VERSION__ >= 202311L || \\\n"
+         "    (__STDC_VERSION__ >= 202000L && (__clang_major__ >= 19 || (!defined(__clang__) && __GNUC__ >= 13)))");
+    fputs(CPUIDX_FEATURES(CPUIDX_X_C), stdout);
+    puts("#endif\n\n#endif // CPUIDX_COMPILED_H");
+
+#undef CPUIDX_X_C
+#undef CPUIDX_X_CPP
+}
+
+/**
+ * Prints the XSAVE state components of the host, and the buffer sizes needed to save them.
+ *
+ * @return 0 on success, 1 if XSAVE is not enabled.
+ */
+int print_xsave_info(void) {
+    cpuidx_xsave_info info;
+
+    if (cpuidx_get_xsave_info(&info) != 0) {
+        fputs("XSAVE is not supported or not enabled by the OS.\n", stderr);
+        return 1;
+    }
+
+    printf("XCR0: 0x%llx (supported: 0x%llx)\n", (unsigned long long) info.enabled_xcr0,
+           (unsigned long long) info.supported_xcr0);
+    printf("IA32_XSS supported: 0x%llx\n", (unsigned long long) info.supported_xss);
+    printf("XFD components: 0x%llx\n\n", (unsigned long long) info.xfd_components);
+
+    puts("Component              Bit  Size  Offset  Flags");
+    for (unsigned i = 0; i < CPUIDX_XSAVE_COMPONENTS; ++i) {
+        if (!((info.supported_xcr0 | info.supported_xss) >> i & 1)) continue;
+
+        const char* name = cpuidx_xsave_component_name(i);
+        const cpuidx_xsave_component* component = &info.components[i];
+
+        printf("%-22s %3u %5u %7u  %s%s%s%s\n", name ? name : "unknown", i, component->size, component->offset,
+               info.enabled_xcr0 >> i & 1 ? "enabled " : "", component->supervisor ? "supervisor " : "",
+               component->aligned ? "aligned " : "", component->xfd ? "xfd" : "");
+    }
+
+    size_t alignment;
+    const size_t size = cpuidx_xsave_area_size(&info, info.enabled_xcr0, &alignment);
+
+    printf("\nStandard size (XCR0): %u\n", info.enabled_size);
+    printf("Standard size (all supported): %u\n", info.max_size);
+    printf("Compacted size (XCR0 | IA32_XSS): %u\n", info.compacted_size);
+    printf("cpuidx_xsave area (XCR0): %zu bytes, %zu-byte aligned\n", size, alignment);
+    printf("cpuidx_xsave area (XCR0 without XFD components): %zu bytes\n",
+           cpuidx_xsave_area_size(&info, info.enabled_xcr0 & ~info.xfd_components, NULL));
+    return 0;
+}
+
+/**
+ * Enables AMX, and prints the tile palette and TMUL information of the host.
+ *
+ * @return 0 if AMX is usable, 1 otherwise.
+ */
+int print_amx_info(void) {
+    cpuidx_amx_info info;
+
+    if (cpuidx_get_amx_info(&info) == 0) {
+        printf("Highest palette: %u\n", info.max_palette);
+        printf("Palette 1: %u tiles of %u rows x %u bytes (%u bytes per tile, %u bytes in total)\n", info.max_names,
+               info.max_rows, info.bytes_per_row, info.bytes_per_tile, info.total_tile_bytes);
+        printf("TMUL: K up to %u, N up to %u bytes\n", info.tmul_max_k, info.tmul_max_n);
+    }
+
+    switch (cpuidx_amx_enable()) {
+        case 0:
+            break;
+        case -1:
+            fputs("AMX is not supported by your cpu.\n", stderr);
+            return 1;
+        case -2:
+            fputs("AMX state is not enabled by the OS.\n", stderr);
+            return 1;
+        default:
+            fputs("AMX tile data permission was denied by the OS.\n", stderr);
+            return 1;
+    }
+
+    puts("AMX is enabled.");
+    return 0;
+}
+
+/**
+ * Measures and prints the vector throughput and execution units of the core.
+ *
+ * @return 0 on success, 1 if the probe is not available.
+ */
+int print_port_probe(void) {
+    static const char* const widths[] = {"128", "256", "512"};
+    cpuidx_port_probe probe;
+
+    if (cpuidx_probe_ports(&probe) != 0) {
+        fputs("The port probe needs AVX, and a GCC or Clang x86-64 build.\n", stderr);
+        return 1;
+    }
+
+    puts("Width  FMA/cycle  Shuffle/cycle  Load/cycle");
+    for (int i = 0; i < CPUIDX_WIDTH_COUNT; ++i) {
+        if (probe.shuffle[i] == 0) continue;
+        printf("%5s %10.2f %14.2f %11.2f\n", widths[i], probe.fma[i], probe.shuffle[i], probe.load[i]);
+    }
+
+    printf("\nFMA units (256-bit): %u\n", probe.fma_units);
+    printf("FMA units (512-bit): %u\n", probe.fma512_units);
+    printf("512-bit operations double-pumped: %s\n", probe.double_pumped_512 ? "yes" : "no");
+    return 0;
+}
+
+/**
+ * Measures and prints the frequency drop running FMA code of each vector width, and its recovery.
+ *
+ * @param cpu The logical CPU to measure, or -1 for the current one, to which the thread is pinned so that its
+ *            APERF and MPERF registers can be read.
+ * @return 0 on success, 1 if the measurement is not available.
+ */
+int print_frequency_license(int cpu) {
+    static const char* const widths[] = {"128", "256", "512"};
+    cpuidx_frequency_license license;
+
+    if (cpu < 0) cpu = cpuidx_current_cpu();
+
+    switch (cpuidx_measure_frequency_license(cpu, &license)) {
+        case 0:
+            break;
+        case -2:
+            fprintf(stderr, "Cannot run on CPU %d.\n", cpu);
+            return 1;
+        default:
+            fputs("The measurement needs FMA, and a GCC or Clang x86-64 build.\n", stderr);
+            return 1;
+    }
+
+    printf("Source: %s\n\n", license.aperf_mperf ? "APERF/MPERF" : "TSC-normalized throughput");
+    printf("Scalar: %7.0f MHz\n", license.scalar_hz / 1e6);
+    for (int i = 0; i < CPUIDX_WIDTH_COUNT; ++i) {
+        if (license.vector_hz[i] == 0) continue;
+        printf("%s FMA: %7.0f MHz  drop %5.1f%%  recovery %8.1f us\n", widths[i], license.vector_hz[i] / 1e6,
+               license.drop[i] * 100, license.recovery_us[i]);
+    }
+    if (license.unreliable) puts("\nUnreliable: a vector frequency exceeds the scalar one, a run was disturbed.");
+    return 0;
+}
+
+/**
+ * Measures and prints the speed of instructions that varies across CPUs with the same features.
+ *
+ * @return 0 on success, 1 if the measurement is not available.
+ */
+int print_isa_timings(void) {
+    cpuidx_isa_timings timings;
+    char buffer[2048];
+
+    if (cpuidx_measure_isa(&timings) != 0) {
+        fputs("The measurement needs a GCC or Clang x86-64 build.\n", stderr);
+        return 1;
+    }
+
+    cpuidx_format_isa_timings(&timings, buffer, sizeof(buffer));
+    fputs(buffer, stdout);
+
+    if (timings.slow_pdep_pext) puts("# Slow: PDEP/PEXT are microcoded");
+    if (timings.slow_gather) puts("# Slow: VPGATHERDD");
+    if (timings.slow_compress_store) puts("# Slow: VPCOMPRESSD to memory is microcoded");
+    if (timings.slow_short_rep_movsb) puts("# Slow: REP MOVSB for short copies");
+    return 0;
+}
+
+/**
+ * Prints the caches of the host and the GEMM blocking recommended for a feature set, and benchmarks
+ * the reference SGEMM with it.
+ *
+ * @param features A pointer to the target features.
+ * @return 0 on success, 1 if the benchmark cannot allocate its matrices.
+ */
+int print_gemm(const cpu_features* const features) {
+    static const char* const levels[] = {"L1d", "L2", "L3"};
+    static const char* const types[] = {"F32", "F64", "BF16"};
+    static const char* const widths[] = {"128-bit", "256-bit", "512-bit"};
+    enum { SIZE = 512, RUNS = 3 };
+    cpuidx_cache_info caches;
+    cpuidx_gemm_blocking blocking;
+
+    cpuidx_get_cache_info(&caches);
+    puts("Cache  Size (KiB)  Ways  Sets  Line  Shared by");
+    for (int i = 0; i < CPUIDX_CACHE_LEVELS; ++i) {
+        const cpuidx_cache_level* cache = &caches.levels[i];
+        if (!cache->size) continue;
+        printf("%-5s %11u %5u %5u %5u %10u\n", levels[i], cache->size / 1024, cache->ways, cache->sets,
+               cache->line_size, cache->shared_by);
+    }
+
+    puts("\nType    MR   NR    KC    MC     NC  Kernel");
+    for (int type = CPUIDX_GEMM_F32; type <= CPUIDX_GEMM_BF16; ++type) {
+        cpuidx_recommend_gemm_blocking((enum cpuidx_gemm_type) type, features, &caches, &blocking);
+        printf("%-5s %4u %4u %5u %5u %6u  %s%s\n", types[type], blocking.mr, blocking.nr, blocking.kc, blocking.mc,
+               blocking.nc, blocking.amx ? "AMX" : widths[blocking.width], blocking.bf16_dot ? " VDPBF16PS" : "");
+    }
+
+    float* matrices = malloc(3 * SIZE * SIZE * sizeof(float));
+    if (!matrices) {
+        fputs("Cannot allocate the benchmark matrices.\n", stderr);
+        return 1;
+    }
+    for (size_t i = 0; i < 3 * SIZE * SIZE; ++i) matrices[i] = (float) (i % 17) / 16;
+
+    cpuidx_recommend_gemm_blocking(CPUIDX_GEMM_F32, features, &caches, &blocking);
+    double best = 0;
+    for (int run = 0; run < RUNS; ++run) {
+        struct timespec start, end;
+        timespec_get(&start, TIME_UTC);
+        cpuidx_sgemm(&blocking, SIZE, SIZE, SIZE, 1, matrices, SIZE, matrices + SIZE * SIZE, SIZE, 0,
+                     matrices + 2 * SIZE * SIZE, SIZE);
+        timespec_get(&end, TIME_UTC);
+
+        const double seconds = (double) (end.tv_sec - start.tv_sec) + (double) (end.tv_nsec - start.tv_nsec) / 1e9;
+        const double gflops = 2.0 * SIZE * SIZE * SIZE / seconds / 1e9;
+        if (gflops > best) best = gflops;
+    }
+    printf("\nReference SGEMM %dx%dx%d: %.2f GFLOP/s\n", SIZE, SIZE, SIZE, best);
+
+    free(matrices);
+    return 0;
+}
+
+/**
+ * Prints the topology of each logical CPU, from the snapshot of cpuidzd if published.
+ *
+ * @return 0 on success, 1 if the topology cannot be read.
+ */
+int print_topology(void) {
+    const size_t count = cpuidx_get_topology(NULL, 0);
+    cpuidx_cpu_topology* cpus = malloc(count * sizeof(*cpus));
+
+    if (!count || !cpus) {
+        free(cpus);
+        fputs("Cannot read the topology.\n", stderr);
+        return 1;
+    }
+
+    const size_t found = cpuidx_get_topology(cpus, count);
+    puts("CPU  x2APIC  Package  Node  CCD  CCX  Core  Thread  Type");
+    for (size_t i = 0; i < found && i < count; ++i) {
+        const cpuidx_cpu_topology* cpu = &cpus[i];
+        printf("%3u %7u %8u %5u %4u %4u %5u %7u  %s\n", cpu->cpu, cpu->x2apic_id, cpu->package, cpu->node, cpu->ccd,
+               cpu->ccx, cpu->core, cpu->thread,
+               cpu->core_type == CPUIDX_CORE_TYPE_ATOM   ? "Atom"
+               : cpu->core_type == CPUIDX_CORE_TYPE_CORE ? "Core"
+                                                         : "-");
+    }
+
+    cpuidx_amd_topology amd;
+    if (cpuidx_get_amd_topology(&amd) == 0) {
+        printf("\nThreads per package: %u (APIC ID size %u)\n", amd.threads_per_package, amd.apic_id_size);
+        printf("Threads per core: %u\nNodes per package: %u\n", amd.threads_per_core, amd.nodes_per_package);
+        printf("Threads per CCX: %u\nThreads per CCD: %u\n", amd.threads_per_ccx, amd.threads_per_ccd);
+    }
+
+    const enum cpuidx_core_type core_type = cpuidx_current_core_type();
+    printf("\nCurrent CPU: %d%s\n", cpuidx_current_cpu(),
+           core_type == CPUIDX_CORE_TYPE_ATOM ? " (Atom)" : core_type == CPUIDX_CORE_TYPE_CORE ? " (Core)" : "");
+
+    free(cpus);
+    return 0;
+}
+
+/**
+ * Prints whether TSX transactions are usable, or why not, and the outcome of eliding an uncontended lock.
+ *
+ * @return 0 if TSX is usable, 1 otherwise.
+ */
+int print_tsx_state(void) {
+    static const char* const states[] = {
+        "usable",
+        "unsupported: the CPU does not enumerate RTM",
+        "unusable: the microcode aborts every transaction (RTM_ALWAYS_ABORT)",
+        "disabled by the kernel (tsx=off, or the TAA mitigation)",
+        "unusable: no probe transaction committed",
+    };
+    const enum cpuidx_tsx_state state = cpuidx_get_tsx_state();
+
+    printf("TSX: %s\n", states[state]);
+    if (state != CPUIDX_TSX_USABLE) return 1;
+
+    cpuidx_elided_lock lock = {0};
+    cpuidx_elision_stats stats = {0};
+    for (int i = 0; i < 100000; ++i) {
+        cpuidx_elided_lock_acquire(&lock, &stats);
+        cpuidx_elided_lock_release(&lock, &stats);
+    }
+
+    printf("Elided lock: %llu commits, %llu aborts (%llu conflict, %llu capacity), %llu fallbacks\n",
+           (unsigned long long) stats.commits, (unsigned long long) stats.aborts,
+           (unsigned long long) stats.conflict_aborts, (unsigned long long) stats.capacity_aborts,
+           (unsigned long long) stats.fallbacks);
+    return 0;
+}
+
+/**
+ * Prints the raw registers of every implemented leaf and sub-leaf, in one batch of CPUID queries.
+ *
+ * @param basic_info A pointer to the basic information of the host, for the highest leaves.
+ * @return 0 on success, 1 if the buffers cannot be allocated.
+ */
+int print_cpuid_dump(const cpu_basic_info* basic_info) {
+    const uint32_t extended = basic_info->highest_extended_leaf >= 0x80000000
+                                  ? basic_info->highest_extended_leaf - 0x80000000 + 1
+                                  : 0;
+    const size_t request_count = basic_info->highest_basic_leaf + 1 + extended;
+    cpuidx_cpuid_request* requests = malloc(request_count * sizeof(*requests));
+
+    if (!requests) {
+        fputs("Cannot allocate the queries.\n", stderr);
+        return 1;
+    }
+
+    for (uint32_t leaf = 0; leaf <= basic_info->highest_basic_leaf; ++leaf) {
+        requests[leaf] = (cpuidx_cpuid_request) {leaf, CPUIDX_ALL_SUB_LEAVES};
+    }
+    for (uint32_t i = 0; i < extended; ++i) {
+        cpuidx_cpuid_request* request = &requests[basic_info->highest_basic_leaf + 1 + i];
+        *request = (cpuidx_cpuid_request) {0x80000000 + i, CPUIDX_ALL_SUB_LEAVES};
+    }
+
+    // The first call counts the results
+    const size_t count = cpuidx_cpuid_batch(requests, request_count, NULL, 0);
+    cpuidx_cpuid_result* results = malloc(count * sizeof(*results));
+
+    if (!results) {
+        free(requests);
+        fputs("Cannot allocate the results.\n", stderr);
+        return 1;
+    }
+
+    const size_t found = cpuidx_cpuid_batch(requests, request_count, results, count);
+    for (size_t i = 0; i < found && i < count; ++i) {
+        const cpuidx_cpuid_result* result = &results[i];
+
+        if (!result->valid) continue;
+        printf("0x%08x 0x%02x: eax=0x%08x ebx=0x%08x ecx=0x%08x edx=0x%08x\n", result->leaf, result->sub_leaf,
+               result->registers[0], result->registers[1], result->registers[2], result->registers[3]);
+    }
+
+    free(results);
+    free(requests);
+    return 0;
+}
+
+/**
+ * Prints the pointer bits available for tags, and the paging and masking they depend on.
+ *
+ * @return 0 on success, 1 if they cannot be read.
+ */
+int print_pointer_tagging(void) {
+    static const char* const maskings[] = {"none", "LAM_U57", "LAM_U48", "other"};
+    cpuidx_pointer_tagging tagging;
+
+    if (cpuidx_get_pointer_tagging(&tagging) != 0) {
+        fputs("Cannot read the pointer tagging.\n", stderr);
+        return 1;
+    }
+
+    printf("Virtual address bits: %u\n", tagging.virtual_address_bits);
+    printf("5-level paging: %s\n", tagging.la57 ? "enabled" : "disabled");
+    printf("User pointer bits: %u\n", tagging.user_address_bits);
+    printf("Tag bits: %u\n", tagging.tag_bits);
+    printf("Hardware masking: %s (%u bits ignored)\n", maskings[tagging.masking], tagging.ignored_bits);
+    printf("UAI: %s\n", cpuidx_cached_features()->UAI ? "supported, if enabled by the OS" : "not supported");
+    return 0;
+}
+
+/**
+ * Prints the power management capabilities of the CPU and the frequency policy of the OS.
+ *
+ * @return 0 if the policy does not hurt latency, 1 if it does, 2 if the report or the cpufreq policy cannot be read.
+ */
+int print_power_info(void) {
+    cpuidx_power_info info;
+
+    if (cpuidx_get_power_info(&info) != 0) {
+        fputs("Cannot read the power management information.\n", stderr);
+        return 2;
+    }
+
+    const struct {
+        bool value;
+        const char* name;
+    } capabilities[] = {
+        {info.turbo, "Turbo Boost"},
+        {info.turbo_max_3, "Turbo Boost Max 3.0"},
+        {info.cpb, "Core performance boost"},
+        {info.hwp, "HWP"},
+        {info.hwp_notification, "HWP notification"},
+        {info.hwp_activity_window, "HWP activity window"},
+        {info.hwp_epp, "HWP energy-performance preference"},
+        {info.hwp_package, "HWP package-level requests"},
+        {info.hwp_fast_request, "HWP fast requests"},
+        {info.hdc, "Hardware duty cycling"},
+        {info.hfi, "Hardware feedback interface"},
+        {info.thread_director, "Thread Director"},
+        {info.aperfmperf, "APERF/MPERF"},
+        {info.effective_frequency, "Effective frequency interface"},
+        {info.epb, "Energy performance bias"},
+        {info.hw_pstate, "Hardware P-states"},
+        {info.arat, "Always running APIC timer"},
+        {info.invariant_tsc, "Invariant TSC"},
+    };
+
+    for (size_t i = 0; i < sizeof(capabilities) / sizeof(capabilities[0]); ++i)
+        printf("%-34s %s\n", capabilities[i].name, capabilities[i].value ? "yes" : "no");
+
+    printf("\nDriver: %s\n", info.driver[0] ? info.driver : "unavailable");
+    printf("Governor: %s\n", info.governor[0] ? info.governor : "unavailable");
+    printf("Energy-performance preference: %s\n", info.epp[0] ? info.epp : "unavailable");
+    printf("Turbo: %s\n", info.boost < 0 ? "unknown" : info.boost ? "enabled" : "disabled");
+
+    if (info.warnings & CPUIDX_POWER_SLOW_GOVERNOR) puts("Warning: the governor keeps the frequency low");
+    if (info.warnings & CPUIDX_POWER_SAVING_EPP) puts("Warning: the energy-performance preference favors power");
+    if (info.warnings & CPUIDX_POWER_TURBO_DISABLED) puts("Warning: turbo is disabled");
+    if (info.flagged_cpus) printf("%u CPUs have a policy hurting latency\n", info.flagged_cpus);
+
+    // Without a cpufreq policy, e.g. in most VMs, the settings are unknown rather than fine
+    if (!info.driver[0] && !info.governor[0]) {
+        fputs("Cannot read the cpufreq policy.\n", stderr);
+        return 2;
+    }
+    return info.warnings ? 1 : 0;
+}
+
+/**
+ * Prints the speculative-execution mitigations of the kernel, the cost of the paths they tax, and the cost of
+ * each mitigation where it can be isolated.
+ *
+ * @return 0 on success, 1 if the OS does not report the vulnerabilities.
+ */
+int print_mitigation_report(void) {
+    static const char* const paths[] = {"-", "syscall", "context switch", "kernel exit", "store-load", "VM entry"};
+    // IA32_ARCH_CAPABILITIES bits telling the CPU is not affected, or has a hardware mitigation
+    static const struct {
+        uint32_t bit;
+        const char* name;
+    } capabilities[] = {
+        {0, "RDCL_NO"}, {1, "IBRS_ALL"}, {2, "RSBA"}, {3, "SKIP_L1DFL_VMENTRY"}, {4, "SSB_NO"}, {5, "MDS_NO"},
+        {6, "IF_PSCHANGE_MC_NO"}, {7, "TSX_CTRL"}, {8, "TAA_NO"}, {13, "SBDR_SSDP_NO"}, {14, "FBSDP_NO"},
+        {15, "PSDP_NO"}, {17, "FB_CLEAR"}, {19, "RRSBA"}, {20, "BHI_NO"}, {24, "PBRSB_NO"}, {26, "GDS_NO"},
+        {27, "RFDS_NO"},
+    };
+    cpuidx_mitigation_report report;
+
+    if (cpuidx_get_mitigation_report(&report) != 0) {
+        fputs("The vulnerabilities are not reported by the OS.\n", stderr);
+        return 1;
+    }
+
+    printf("%-26s %-15s %9s  %s\n", "Vulnerability", "Taxed path", "Tax (ns)", "Status");
+    for (size_t i = 0; i < report.vulnerability_count; ++i) {
+        const cpuidx_vulnerability* vulnerability = &report.vulnerabilities[i];
+        char tax[16] = "-";
+
+        if (vulnerability->tax_ns >= 0) snprintf(tax, sizeof(tax), "%.1f", vulnerability->tax_ns);
+        printf("%-26s %-15s %9s  %s\n", vulnerability->name, paths[vulnerability->path], tax, vulnerability->status);
+    }
+
+    if (report.arch_capabilities_read) {
+        printf("\nIA32_ARCH_CAPABILITIES: 0x%016llx\n ", (unsigned long long) report.arch_capabilities);
+        for (size_t i = 0; i < sizeof(capabilities) / sizeof(capabilities[0]); ++i) {
+            if (report.arch_capabilities >> capabilities[i].bit & 1) printf(" %s", capabilities[i].name);
+        }
+        putchar('\n');
+    } else if (cpuidx_cached_features()->IA32_ARCH_CAPABILITIES) {
+        puts("\nIA32_ARCH_CAPABILITIES: not readable (needs the msr module and CAP_SYS_RAWIO)");
+    }
+
+    puts("\nPath costs:");
+    if (report.syscall_ns >= 0) printf("  System call round trip: %.1f ns\n", report.syscall_ns);
+    if (report.context_switch_ns >= 0) printf("  Context switch: %.1f ns\n", report.context_switch_ns);
+    if (report.verw_ns >= 0) printf("  VERW: %.1f ns\n", report.verw_ns);
+    if (report.ibpb_ns >= 0) printf("  IBPB per context switch: %.1f ns\n", report.ibpb_ns);
+    if (report.ssbd_ns >= 0) printf("  SSBD per store and load: %.2f ns\n", report.ssbd_ns);
+    return 0;
+}
+
+/**
+ * Prints the verdict of the self-test on each detected feature with an instruction to run.
+ *
+ * @return 0 if every tested feature executes natively, 1 if some fault or are slow, or the self-test is unavailable.
+ */
+int print_self_test(void) {
+    static const char* const verdicts[] = {"untested", "usable", "faulted", "slow"};
+    cpuidx_self_test_report report;
+
+    if (cpuidx_run_self_test(&report) != 0) {
+        fputs("The self-test is not available on this platform.\n", stderr);
+        return 1;
+    }
+
+    printf("%-20s %-9s %12s %12s\n", "Feature", "Verdict", "ns/insn", "Limit (ns)");
+    for (size_t i = 0; i < report.check_count; ++i) {
+        const cpuidx_feature_check* check = &report.checks[i];
+        char ns[16] = "-";
+
+        if (check->ns >= 0) snprintf(ns, sizeof(ns), "%.2f", check->ns);
+        printf("%-20s %-9s %12s %12.0f", cpuidx_feature_name(check->feature), verdicts[check->verdict], ns,
+               check->slow_ns);
+        if (check->signal) printf("  (signal %d)", check->signal);
+        putchar('\n');
+    }
+
+    printf("\n%zu features tested, %zu faulted, %zu slow\n", report.check_count, report.faulted, report.slow);
+    return report.faulted || report.slow ? 1 : 0;
+}
+
+int main(const int argc, char** argv) {
+    const char* profile = NULL;
+    const char* option = NULL;
+    const char* output = NULL;
+    int cpu = -1;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--profile=", 10) == 0) profile = argv[i] + 10;
+        else if (strncmp(argv[i], "--output=", 9) == 0) output = argv[i] + 9;
+        else if (strncmp(argv[i], "--cpu=", 6) == 0) cpu = atoi(argv[i] + 6);
+        else if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else if (strcmp(argv[i], "--march") == 0 || strcmp(argv[i], "--mtune") == 0 ||
+                   strcmp(argv[i], "--cflags") == 0 || strcmp(argv[i], "--target-clones") == 0 ||
+                   strcmp(argv[i], "--compiler-info") == 0 || strcmp(argv[i], "--header") == 0 ||
+                   strcmp(argv[i], "--xsave") == 0 || strcmp(argv[i], "--amx") == 0 ||
+                   strcmp(argv[i], "--probe-ports") == 0 || strcmp(argv[i], "--frequency-license") == 0 ||
+                   strcmp(argv[i], "--measure-isa") == 0 || strcmp(argv[i], "--tsx") == 0 ||
+                   strcmp(argv[i], "--gemm") == 0 || strcmp(argv[i], "--topology") == 0 ||
+                   strcmp(argv[i], "--dump") == 0 || strcmp(argv[i], "--tagging") == 0 ||
+                   strcmp(argv[i], "--power") == 0 || strcmp(argv[i], "--mitigations") == 0 ||
+                   strcmp(argv[i], "--self-test") == 0)
+            option = argv[i];
+        else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (output && !freopen(output, "w", stdout)) {
+        perror(output);
+        return 1;
+    }
+
     cpu_features features = {};
     cpu_basic_info basic_info = {};
 
@@ -173,6 +838,28 @@ int main() {
             fputs("CPUID instruction is not supported by your cpu.\n", stderr);
             return 1;
         case 0:
+            if (option) {
+                if (profile && cpuidx_parse_profile(profile, &features) != 0) {
+                    fprintf(stderr, "Invalid profile: %s\n", profile);
+                    return 1;
+                }
+                if (strcmp(option, "--xsave") == 0) return print_xsave_info();
+                if (strcmp(option, "--amx") == 0) return print_amx_info();
+                if (strcmp(option, "--probe-ports") == 0) return print_port_probe();
+                if (strcmp(option, "--frequency-license") == 0) return print_frequency_license(cpu);
+                if (strcmp(option, "--measure-isa") == 0) return print_isa_timings();
+                if (strcmp(option, "--tsx") == 0) return print_tsx_state();
+                if (strcmp(option, "--gemm") == 0) return print_gemm(&features);
+                if (strcmp(option, "--topology") == 0) return print_topology();
+                if (strcmp(option, "--dump") == 0) return print_cpuid_dump(&basic_info);
+                if (strcmp(option, "--tagging") == 0) return print_pointer_tagging();
+                if (strcmp(option, "--power") == 0) return print_power_info();
+                if (strcmp(option, "--mitigations") == 0) return print_mitigation_report();
+                if (strcmp(option, "--self-test") == 0) return print_self_test();
+                if (strcmp(option, "--header") == 0) print_compiled_header(&features, profile);
+                else print_compiler_info(option, &features, profile ? NULL : &basic_info);
+                return 0;
+            }
             print_basic_info(&basic_info);
             putchar('\n');
             print_available_features(&features);
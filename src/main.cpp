@@ -2,81 +2,11 @@
 #error "The target arch is not x86."
 #endif
 
-#include <cpuidx.h>
-#include <unordered_map>
-#include <string>
+#include <cpuidx.hpp>
+#include <array>
 #include <print>
-#include <tuple>
-#include <limits>
-#include <cassert>
-
-/// Concept to check if std::hash<T> is defined.
-/// 
-/// This concept ensures that a type T can be hashed using std::hash.
-/// 
-/// \tparam T The type to check for hashability.
-template <class T>
-concept Hashable = requires(T t) {
-    { std::hash<T>{}(t) } -> std::convertible_to<std::size_t>;
-};
-
-/// Hash combination utility function.
-/// 
-/// Combines the hash values of multiple arguments into a single hash value.
-/// 
-/// \tparam T The type of the first argument.
-/// \tparam Other The types of the other arguments.
-/// \param first The first argument to hash.
-/// \param other The other arguments to hash.
-/// \return The combined hash value of all arguments.
-template <class T, class... Other>
-    requires Hashable<T> && (Hashable<Other> && ...)
-constexpr std::size_t hash_combine(const T& first, const Other&... other) {
-    static constexpr std::size_t golden_ratio = std::numeric_limits<std::size_t>::digits == 64
-                                                    ? 0x9e3779b97f4a7c13 // 64-bit golden ratio
-                                                    : 0x9e3779b9; // 32-bit golden ratio
-    // Start with the hash value of the first argument
-    std::size_t seed = std::hash<T>{}(first);
-
-    // Combine the hash values of all arguments
-    ((seed ^= (std::hash<Other>{}(other) + golden_ratio + (seed << 6) + (seed >> 2))), ...);
-    return seed;
-}
-
-/// Custom hasher for std::tuple.
-/// 
-/// Provides a way to hash a std::tuple by combining the hash values of its elements.
-struct tuple_hash {
-    /// Hashes a std::tuple by combining the hash values of its elements.
-    ///
-    /// \tparam Types The types of the elements in the tuple.
-    /// \param t The tuple to hash.
-    /// \return The combined hash value of the tuple elements.
-    template <class... Types>
-    std::size_t operator()(const std::tuple<Types...>& t) const {
-        return std::apply([]<class... T>(T&&... args) {
-            return hash_combine(std::forward<T>(args)...);
-        }, t);
-    }
-};
-
-/// Custom hasher for std::pair.
-/// 
-/// Provides a way to hash a std::pair by combining the hash values of its elements.
-struct pair_hash {
-    /// Hashes a std::pair by combining the hash values of its elements.
-    /// 
-    /// \tparam T1 The type of the first element in the pair.
-    /// \tparam T2 The type of the second element in the pair.
-    /// \param p The pair to hash.
-    /// \return The combined hash value of the pair elements.
-    template <class T1, class T2>
-    std::size_t operator()(const std::pair<T1, T2>& p) const {
-        if constexpr (Hashable<T1> && Hashable<T2>)
-            return hash_combine(p.first, p.second);
-        else return tuple_hash{}(std::make_tuple(p.first, p.second));
-    }
-};
+#include <string_view>
+#include <utility>
 
 /// Prints basic CPU information.
 /// \param info A reference to a \p cpu_basic_info structure containing the basic CPU information.
@@ -106,248 +36,231 @@ void print_basic_info(const cpu_basic_info& info) {
 /// Prints available CPU features.
 /// \param feats A reference to a \p cpu_features structure containing the CPU features.
 void print_available_features(const cpu_features& feats) {
-    static const std::unordered_map<std::pair<std::string, std::string>, bool, pair_hash> featureMap = {
-        {{"SSE3", "Prescott New Instructions - PNI"}, feats.SSE3},
-        {{"PCLMULQDQ", "(carry-less multiply) instruction"}, feats.PCLMULQDQ},
-        {{"DTES64", "64-bit debug store"}, feats.DTES64},
-        {{"MONITOR", "MONITOR and MWAIT instructions (PNI)"}, feats.MONITOR},
-        {{"DSCPL", "CPL qualified debug store"}, feats.DSCPL},
-        {{"VMX", "Virtual Machine eXtensions"}, feats.VMX},
-        {{"SMX", "Safer Mode Extensions (LaGrande) (GETSEC instruction)"}, feats.SMX},
-        {{"EIST", "Enhanced SpeedStep"}, feats.EIST},
-        {{"TM2", "Thermal Monitor 2"}, feats.TM2},
-        {{"SSSE3", "Supplemental SSE3 instructions"}, feats.SSSE3},
-        {{"CNXTID", "L1 Context ID"}, feats.CNXTID},
-        {{"SDBG", "Silicon Debug Interface"}, feats.SDBG},
-        {{"FMA", "Fused multiply-add (FMA3)"}, feats.FMA},
-        {{"CMPXCHG16B", "CMPXCHG16B instruction"}, feats.CMPXCHG16B},
-        {{"xTPR", "Can disable sending task priority messages"}, feats.xTPR},
-        {{"PDCM", "Perfmon & debug capability"}, feats.PDCM},
-        {{"PCID", "Process context identifiers"}, feats.PCID},
-        {{"DCA", "Direct cache access for DMA writes"}, feats.DCA},
-        {{"SSE41", "SSE4.1 instructions"}, feats.SSE41},
-        {{"SSE42", "SSE4.2 instructions"}, feats.SSE42},
-        {{"x2APIC", "enhanced APIC"}, feats.x2APIC},
-        {{"MOVBE", "MOVBE instruction (big-endian)"}, feats.MOVBE},
-        {{"POPCNT", "POPCNT instruction"}, feats.POPCNT},
-        {{"TSCDeadline", "APIC implements one-shot operation using a TSC deadline value"}, feats.TSCDeadline},
-        {{"AESNI", "AES instruction set"}, feats.AESNI},
-        {{"XSAVE", "Extensible processor state save/restore:XSAVE, XRSTOR, XSETBV, XGETBV instructions"}, feats.XSAVE},
-        {{"OSXSAVE", "XSAVE enabled by OS"}, feats.OSXSAVE},
-        {{"AVX", "Advanced Vector Extensions (256-bit SIMD)"}, feats.AVX},
-        {{"F16C", "Floating-point conversion instructions to/from FP16 format"}, feats.F16C},
-        {{"RDRND", "on-chip random number generator"}, feats.RDRND},
-        {{"HYPRVSR", "Hypervisor present"}, feats.HYPRVSR},
-        {{"FPU", "Onboard x87 FPU"}, feats.FPU},
-        {{"VME", "Virtual 8086 mode extensions (such as VIF, VIP, PVI)"}, feats.VME},
-        {{"DE", "Debugging extensions (CR4 bit 3)"}, feats.DE},
-        {{"PSE", "Page Size Extension (4 MB pages)"}, feats.PSE},
-        {{"TSC", "Time Stamp Counter and RDTSC instruction"}, feats.TSC},
-        {{"MSR", "Model-specific registers and RDMSR/WRMSR instructions"}, feats.MSR},
-        {{"PAE", "Physical Address Extension"}, feats.PAE},
-        {{"MCE", "Machine Check Exception"}, feats.MCE},
-        {{"CX8", "CMPXCHG8B (compare-and-swap) instruction"}, feats.CX8},
-        {{"APIC", "Onboard Advanced Programmable Interrupt Controller"}, feats.APIC},
-        {{"SEP", "SYSENTER and SYSEXIT fast system call instructions"}, feats.SEP},
-        {{"MTRR", "Memory Type Range Registers"}, feats.MTRR},
-        {{"PGE", "Page Global Enable bit in CR4"}, feats.PGE},
-        {{"MCA", "Machine check architecture"}, feats.MCA},
-        {{"CMOV", "Conditional move: CMOV, FCMOV and FCOMI instructions"}, feats.CMOV},
-        {{"PAT", "Page Attribute Table"}, feats.PAT},
-        {{"PSE36", "36-bit page size extension"}, feats.PSE36},
-        {{"PSN", "Processor Serial Number supported and enabled"}, feats.PSN},
-        {{"CLFSH", "CLFLUSH cache line flush instruction (SSE2)"}, feats.CLFSH},
-        {{"DS", "Debug store: save trace of executed jumps"}, feats.DS},
-        {{"ACPI", "Onboard thermal control MSRs for ACPI"}, feats.ACPI},
-        {{"MMX", "MMX instructions (64-bit SIMD)"}, feats.MMX},
-        {{"FXSR", "FXSAVE, FXRSTOR instructions, CR4 bit 9"}, feats.FXSR},
-        {{"SSE", "Streaming SIMD Extensions instructions (128-bit SIMD)"}, feats.SSE},
-        {{"SSE2", "SSE2 instructions"}, feats.SSE2},
-        {{"SS", "CPU cache implements self-snoop"}, feats.SS},
-        {{"HTT", "Max APIC IDs reserved field is Valid"}, feats.HTT},
-        {{"TM", "Thermal monitor automatically limits temperature"}, feats.TM},
-        {{"IA64", "IA64 processor emulating x86"}, feats.IA64},
-        {{"PBE", "Pending Break Enable (PBE# pin) wakeup capability"}, feats.PBE},
-        {{"FSGSBASE", "Access to base of %fs and %gs"}, feats.FSGSBASE},
-        {{"SGX", "Software Guard Extensions"}, feats.SGX},
-        {{"BMI", "Bit Manipulation Instruction Set 1"}, feats.BMI},
-        {{"HLE", "TSX Hardware Lock Elision"}, feats.HLE},
-        {{"AVX2", "Advanced Vector Extensions 2"}, feats.AVX2},
-        {{"FDPXO", "x87 FPU data pointer register updated on exceptions only"}, feats.FDPXO},
-        {{"SMEP", "Supervisor Mode Execution Prevention"}, feats.SMEP},
-        {{"BMI2", "Bit Manipulation Instruction Set 2"}, feats.BMI2},
-        {{"ENH_MOVSB", "Enhanced REP MOVSB/STOSB"}, feats.ENH_MOVSB},
-        {{"INVPCID", "INVPCID instruction"}, feats.INVPCID},
-        {{"RTM", "TSX Restricted Transactional Memory"}, feats.RTM},
-        {{"MPX", "Intel MPX (Memory Protection Extensions)"}, feats.MPX},
-        {{"AVX512F", "AVX-512 Foundation"}, feats.AVX512F},
-        {{"AVX512DQ", "AVX-512 Doubleword and Quadword Instructions"}, feats.AVX512DQ},
-        {{"RDSEED", "RDSEED instruction"}, feats.RDSEED},
-        {{"ADX", "Intel ADX (Multi-Precision Add-Carry Instruction Extensions)"}, feats.ADX},
-        {{"SMAP", "Supervisor Mode Access Prevention"}, feats.SMAP},
-        {{"AVX512IFMA", "AVX-512 Integer Fused Multiply-Add Instructions"}, feats.AVX512IFMA},
-        {{"CLFLUSHOPT", "CLFLUSHOPT instruction"}, feats.CLFLUSHOPT},
-        {{"CLWB", "Cache line writeback instruction"}, feats.CLWB},
-        {{"PT", "Intel Processor Trace"}, feats.PT},
-        {{"AVX512PF", "AVX-512 Prefetch Instructions"}, feats.AVX512PF},
-        {{"AVX512ER", "AVX-512 Exponential and Reciprocal Instructions"}, feats.AVX512ER},
-        {{"AVX512CD", "AVX-512 Conflict Detection Instructions"}, feats.AVX512CD},
-        {{"SHA", "SHA-1 and SHA-256 extensions"}, feats.SHA},
-        {{"AVX512BW", "AVX-512 Byte and Word Instructions"}, feats.AVX512BW},
-        {{"AVX512VL", "AVX-512 Vector Length Extensions"}, feats.AVX512VL},
-        {{"PREFTCHWT1", "PREFETCHWT1 instruction"}, feats.PREFTCHWT1},
-        {{"AVX512VBMI", "AVX-512 Vector Bit Manipulation Instructions"}, feats.AVX512VBMI},
-        {{"UMIP", "User-Mode Instruction Prevention"}, feats.UMIP},
-        {{"PKU", "Memory Protection Keys for User-mode pages"}, feats.PKU},
-        {{"OSPKE", "PKU enabled by OS"}, feats.OSPKE},
-        {{"WAITPKG", "Timed pause and user-level monitor/wait instructions (TPAUSE, UMONITOR, UMWAIT)"}, feats.WAITPKG},
-        {{"AVX512VBMI2", "AVX-512 Vector Bit Manipulation Instructions 2"}, feats.AVX512VBMI2},
-        {{"SHSTK", "Control flow enforcement (CET):shadow stack"}, feats.SHSTK},
-        {{"GFNI", "Galois Field instructions"}, feats.GFNI},
-        {{"VAES", "Vector AES instruction set (VEX-256/EVEX)"}, feats.VAES},
-        {{"VPCLMULQDQ", "CLMUL instruction set (VEX-256/EVEX)"}, feats.VPCLMULQDQ},
-        {{"AVX512VNNI", "AVX-512 Vector Neural Network Instructions"}, feats.AVX512VNNI},
-        {{"AVX512BITALG", "AVX-512 BITALG instructions"}, feats.AVX512BITALG},
-        {{"TMEM", "Total Memory Encryption MSRs available"}, feats.TMEM},
-        {{"AVX512VPOPCNTDQ", "AVX-512 Vector Population Count Double and Quad-word"}, feats.AVX512VPOPCNTDQ},
-        {{"IA57", "5-level paging (57 address bits)"}, feats.IA57},
-        {{"RDPID", "Read Processor ID instruction and IA32_TSC_AUX MSR"}, feats.RDPID},
-        {{"KL", "AES Key Locker"}, feats.KL},
-        {{"BLD", "Bus lock debug exceptions"}, feats.BLD},
-        {{"CLDEMOTE", "Cache line demote instruction"}, feats.CLDEMOTE},
-        {{"MOVDIRI", "MOVDIRI instruction"}, feats.MOVDIRI},
-        {{"MOVDIR64B", "MOVDIR64B (64-byte direct store) instruction"}, feats.MOVDIR64B},
-        {{"ENQCMD", "Enqueue Stores and EMQCMD/EMQCMDS instructions"}, feats.ENQCMD},
-        {{"SGXLC", "SGX Launch Configuration"}, feats.SGXLC},
-        {{"PKS", "Protection Keys for supervisor-mode pages"}, feats.PKS},
-        {{"SGXKEYS", "Attestation Services for Intel SGX"}, feats.SGXKEYS},
-        {{"AVX5124VNNIW", "AVX-512 4-register Neural Network Instructions"}, feats.AVX5124VNNIW},
-        {{"AVX5124FMAPS", "AVX-512 4-register Multiply Accumulation Single precision"}, feats.AVX5124FMAPS},
-        {{"FSRM", "Fast Short REP MOV"}, feats.FSRM},
-        {{"UINTR", "User Inter-processor Interrupts"}, feats.UINTR},
+    static constexpr std::array<std::pair<cpuidx::feature, std::string_view>, cpuidx::feature_count> descriptions{{
+        {cpuidx::feature::SSE3, "Prescott New Instructions - PNI"},
+        {cpuidx::feature::PCLMULQDQ, "(carry-less multiply) instruction"},
+        {cpuidx::feature::DTES64, "64-bit debug store"},
+        {cpuidx::feature::MONITOR, "MONITOR and MWAIT instructions (PNI)"},
+        {cpuidx::feature::DSCPL, "CPL qualified debug store"},
+        {cpuidx::feature::VMX, "Virtual Machine eXtensions"},
+        {cpuidx::feature::SMX, "Safer Mode Extensions (LaGrande) (GETSEC instruction)"},
+        {cpuidx::feature::EIST, "Enhanced SpeedStep"},
+        {cpuidx::feature::TM2, "Thermal Monitor 2"},
+        {cpuidx::feature::SSSE3, "Supplemental SSE3 instructions"},
+        {cpuidx::feature::CNXTID, "L1 Context ID"},
+        {cpuidx::feature::SDBG, "Silicon Debug Interface"},
+        {cpuidx::feature::FMA, "Fused multiply-add (FMA3)"},
+        {cpuidx::feature::CMPXCHG16B, "CMPXCHG16B instruction"},
+        {cpuidx::feature::xTPR, "Can disable sending task priority messages"},
+        {cpuidx::feature::PDCM, "Perfmon & debug capability"},
+        {cpuidx::feature::PCID, "Process context identifiers"},
+        {cpuidx::feature::DCA, "Direct cache access for DMA writes"},
+        {cpuidx::feature::SSE41, "SSE4.1 instructions"},
+        {cpuidx::feature::SSE42, "SSE4.2 instructions"},
+        {cpuidx::feature::x2APIC, "enhanced APIC"},
+        {cpuidx::feature::MOVBE, "MOVBE instruction (big-endian)"},
+        {cpuidx::feature::POPCNT, "POPCNT instruction"},
+        {cpuidx::feature::TSCDeadline, "APIC implements one-shot operation using a TSC deadline value"},
+        {cpuidx::feature::AESNI, "AES instruction set"},
+        {cpuidx::feature::XSAVE, "Extensible processor state save/restore:XSAVE, XRSTOR, XSETBV, XGETBV instructions"},
+        {cpuidx::feature::OSXSAVE, "XSAVE enabled by OS"},
+        {cpuidx::feature::AVX, "Advanced Vector Extensions (256-bit SIMD)"},
+        {cpuidx::feature::F16C, "Floating-point conversion instructions to/from FP16 format"},
+        {cpuidx::feature::RDRND, "on-chip random number generator"},
+        {cpuidx::feature::HYPRVSR, "Hypervisor present"},
+        {cpuidx::feature::FPU, "Onboard x87 FPU"},
+        {cpuidx::feature::VME, "Virtual 8086 mode extensions (such as VIF, VIP, PVI)"},
+        {cpuidx::feature::DE, "Debugging extensions (CR4 bit 3)"},
+        {cpuidx::feature::PSE, "Page Size Extension (4 MB pages)"},
+        {cpuidx::feature::TSC, "Time Stamp Counter and RDTSC instruction"},
+        {cpuidx::feature::MSR, "Model-specific registers and RDMSR/WRMSR instructions"},
+        {cpuidx::feature::PAE, "Physical Address Extension"},
+        {cpuidx::feature::MCE, "Machine Check Exception"},
+        {cpuidx::feature::CX8, "CMPXCHG8B (compare-and-swap) instruction"},
+        {cpuidx::feature::APIC, "Onboard Advanced Programmable Interrupt Controller"},
+        {cpuidx::feature::SEP, "SYSENTER and SYSEXIT fast system call instructions"},
+        {cpuidx::feature::MTRR, "Memory Type Range Registers"},
+        {cpuidx::feature::PGE, "Page Global Enable bit in CR4"},
+        {cpuidx::feature::MCA, "Machine check architecture"},
+        {cpuidx::feature::CMOV, "Conditional move: CMOV, FCMOV and FCOMI instructions"},
+        {cpuidx::feature::PAT, "Page Attribute Table"},
+        {cpuidx::feature::PSE36, "36-bit page size extension"},
+        {cpuidx::feature::PSN, "Processor Serial Number supported and enabled"},
+        {cpuidx::feature::CLFSH, "CLFLUSH cache line flush instruction (SSE2)"},
+        {cpuidx::feature::DS, "Debug store: save trace of executed jumps"},
+        {cpuidx::feature::ACPI, "Onboard thermal control MSRs for ACPI"},
+        {cpuidx::feature::MMX, "MMX instructions (64-bit SIMD)"},
+        {cpuidx::feature::FXSR, "FXSAVE, FXRSTOR instructions, CR4 bit 9"},
+        {cpuidx::feature::SSE, "Streaming SIMD Extensions instructions (128-bit SIMD)"},
+        {cpuidx::feature::SSE2, "SSE2 instructions"},
+        {cpuidx::feature::SS, "CPU cache implements self-snoop"},
+        {cpuidx::feature::HTT, "Max APIC IDs reserved field is Valid"},
+        {cpuidx::feature::TM, "Thermal monitor automatically limits temperature"},
+        {cpuidx::feature::IA64, "IA64 processor emulating x86"},
+        {cpuidx::feature::PBE, "Pending Break Enable (PBE# pin) wakeup capability"},
+        {cpuidx::feature::FSGSBASE, "Access to base of %fs and %gs"},
+        {cpuidx::feature::SGX, "Software Guard Extensions"},
+        {cpuidx::feature::BMI, "Bit Manipulation Instruction Set 1"},
+        {cpuidx::feature::HLE, "TSX Hardware Lock Elision"},
+        {cpuidx::feature::AVX2, "Advanced Vector Extensions 2"},
+        {cpuidx::feature::FDPXO, "x87 FPU data pointer register updated on exceptions only"},
+        {cpuidx::feature::SMEP, "Supervisor Mode Execution Prevention"},
+        {cpuidx::feature::BMI2, "Bit Manipulation Instruction Set 2"},
+        {cpuidx::feature::ENH_MOVSB, "Enhanced REP MOVSB/STOSB"},
+        {cpuidx::feature::INVPCID, "INVPCID instruction"},
+        {cpuidx::feature::RTM, "TSX Restricted Transactional Memory"},
+        {cpuidx::feature::MPX, "Intel MPX (Memory Protection Extensions)"},
+        {cpuidx::feature::AVX512F, "AVX-512 Foundation"},
+        {cpuidx::feature::AVX512DQ, "AVX-512 Doubleword and Quadword Instructions"},
+        {cpuidx::feature::RDSEED, "RDSEED instruction"},
+        {cpuidx::feature::ADX, "Intel ADX (Multi-Precision Add-Carry Instruction Extensions)"},
+        {cpuidx::feature::SMAP, "Supervisor Mode Access Prevention"},
+        {cpuidx::feature::AVX512IFMA, "AVX-512 Integer Fused Multiply-Add Instructions"},
+        {cpuidx::feature::CLFLUSHOPT, "CLFLUSHOPT instruction"},
+        {cpuidx::feature::CLWB, "Cache line writeback instruction"},
+        {cpuidx::feature::PT, "Intel Processor Trace"},
+        {cpuidx::feature::AVX512PF, "AVX-512 Prefetch Instructions"},
+        {cpuidx::feature::AVX512ER, "AVX-512 Exponential and Reciprocal Instructions"},
+        {cpuidx::feature::AVX512CD, "AVX-512 Conflict Detection Instructions"},
+        {cpuidx::feature::SHA, "SHA-1 and SHA-256 extensions"},
+        {cpuidx::feature::AVX512BW, "AVX-512 Byte and Word Instructions"},
+        {cpuidx::feature::AVX512VL, "AVX-512 Vector Length Extensions"},
+        {cpuidx::feature::PREFTCHWT1, "PREFETCHWT1 instruction"},
+        {cpuidx::feature::AVX512VBMI, "AVX-512 Vector Bit Manipulation Instructions"},
+        {cpuidx::feature::UMIP, "User-Mode Instruction Prevention"},
+        {cpuidx::feature::PKU, "Memory Protection Keys for User-mode pages"},
+        {cpuidx::feature::OSPKE, "PKU enabled by OS"},
+        {cpuidx::feature::WAITPKG, "Timed pause and user-level monitor/wait instructions (TPAUSE, UMONITOR, UMWAIT)"},
+        {cpuidx::feature::AVX512VBMI2, "AVX-512 Vector Bit Manipulation Instructions 2"},
+        {cpuidx::feature::SHSTK, "Control flow enforcement (CET):shadow stack"},
+        {cpuidx::feature::GFNI, "Galois Field instructions"},
+        {cpuidx::feature::VAES, "Vector AES instruction set (VEX-256/EVEX)"},
+        {cpuidx::feature::VPCLMULQDQ, "CLMUL instruction set (VEX-256/EVEX)"},
+        {cpuidx::feature::AVX512VNNI, "AVX-512 Vector Neural Network Instructions"},
+        {cpuidx::feature::AVX512BITALG, "AVX-512 BITALG instructions"},
+        {cpuidx::feature::TMEM, "Total Memory Encryption MSRs available"},
+        {cpuidx::feature::AVX512VPOPCNTDQ, "AVX-512 Vector Population Count Double and Quad-word"},
+        {cpuidx::feature::IA57, "5-level paging (57 address bits)"},
+        {cpuidx::feature::RDPID, "Read Processor ID instruction and IA32_TSC_AUX MSR"},
+        {cpuidx::feature::KL, "AES Key Locker"},
+        {cpuidx::feature::BLD, "Bus lock debug exceptions"},
+        {cpuidx::feature::CLDEMOTE, "Cache line demote instruction"},
+        {cpuidx::feature::MOVDIRI, "MOVDIRI instruction"},
+        {cpuidx::feature::MOVDIR64B, "MOVDIR64B (64-byte direct store) instruction"},
+        {cpuidx::feature::ENQCMD, "Enqueue Stores and EMQCMD/EMQCMDS instructions"},
+        {cpuidx::feature::SGXLC, "SGX Launch Configuration"},
+        {cpuidx::feature::PKS, "Protection Keys for supervisor-mode pages"},
+        {cpuidx::feature::SGXKEYS, "Attestation Services for Intel SGX"},
+        {cpuidx::feature::AVX5124VNNIW, "AVX-512 4-register Neural Network Instructions"},
+        {cpuidx::feature::AVX5124FMAPS, "AVX-512 4-register Multiply Accumulation Single precision"},
+        {cpuidx::feature::FSRM, "Fast Short REP MOV"},
+        {cpuidx::feature::UINTR, "User Inter-processor Interrupts"},
+        {cpuidx::feature::AVX512VP2INTERSECT, "AVX-512 vector intersection instructions on 32/64-bit integers"},
+        {cpuidx::feature::SRBDSCTRL, "Special Register Buffer Data Sampling Mitigations"},
+        {cpuidx::feature::MDCLEAR, "VERW instruction clears CPU buffers"},
+        {cpuidx::feature::RTMAA, "(rtm-always-abort): All TSX transactions are aborted"},
+        {cpuidx::feature::RTMFA, "(rtm-force-abort): TSX_FORCE_ABORT (MSR 0x10f) is available"},
+        {cpuidx::feature::SERIALIZE, "SERIALIZE instruction"},
+        {cpuidx::feature::HYBRID, "Hybrid processor (Mixture of CPU types in processor topology)"},
+        {cpuidx::feature::TSXLDTRK, "TSX load address tracking suspend/resume instructions (TSUSLDTRK and TRESLDTRK)"},
+        {cpuidx::feature::PCONFIG, "Platform configuration (Memory Encryption Technologies Instructions)"},
+        {cpuidx::feature::LBR, "Architectural Last Branch Records"},
+        {cpuidx::feature::IBT, "Control flow enforcement (CET): indirect branch tracking"},
+        {cpuidx::feature::AMXBF16, "AMX tile computation on bfloat16 numbers"},
+        {cpuidx::feature::AVX512FP16, "AVX-512 half-precision floating-point arithmetic instructions"},
+        {cpuidx::feature::AMXTILE, "AMX tile load/store instructions"},
+        {cpuidx::feature::AMXINT8, "AMX tile computation on 8-bit integers"},
         {
-            {
-                "AVX512VP2INTERSECT", "AVX-512 vector intersection instructions on 32/64-bit integers"
-            },
-            feats.AVX512VP2INTERSECT
+            cpuidx::feature::IBRRS,
+            "Indirect Branch Restricted Speculation (IBRS) and Indirect Branch Prediction Barrier (IBPB)"
         },
-        {{"SRBDSCTRL", "Special Register Buffer Data Sampling Mitigations"}, feats.SRBDSCTRL},
-        {{"MDCLEAR", "VERW instruction clears CPU buffers"}, feats.MDCLEAR},
-        {{"RTMAA", "(rtm-always-abort): All TSX transactions are aborted"}, feats.RTMAA},
-        {{"RTMFA", "(rtm-force-abort): TSX_FORCE_ABORT (MSR 0x10f) is available"}, feats.RTMFA},
-        {{"SERIALIZE", "SERIALIZE instruction"}, feats.SERIALIZE},
-        {{"HYBRID", "Hybrid processor (Mixture of CPU types in processor topology)"}, feats.HYBRID},
+        {cpuidx::feature::STIBP, "Single Thread Indirect Branch Predictor"},
+        {cpuidx::feature::L1D_FLUSH, "IA32_FLUSH_CMD MSR"},
         {
-            {"TSXLDTRK", "TSX load address tracking suspend/resume instructions (TSUSLDTRK and TRESLDTRK)"},
-            feats.TSXLDTRK
+            cpuidx::feature::IA32_ARCH_CAPABILITIES,
+            "IA32_ARCH_CAPABILITIES MSR (lists speculative side channel mitigations)"
         },
-        {{"PCONFIG", "Platform configuration (Memory Encryption Technologies Instructions)"}, feats.PCONFIG},
-        {{"LBR", "Architectural Last Branch Records"}, feats.LBR},
-        {{"IBT", "Control flow enforcement (CET): indirect branch tracking"}, feats.IBT},
-        {{"AMXBF16", "AMX tile computation on bfloat16 numbers"}, feats.AMXBF16},
-        {{"AVX512FP16", "AVX-512 half-precision floating-point arithmetic instructions"}, feats.AVX512FP16},
-        {{"AMXTILE", "AMX tile load/store instructions"}, feats.AMXTILE},
-        {{"AMXINT8", "AMX tile computation on 8-bit integers"}, feats.AMXINT8},
         {
-            {
-                "IBRRS", "Indirect Branch Restricted Speculation (IBRS) and Indirect Branch Prediction Barrier (IBPB)"
-            },
-            feats.IBRRS
+            cpuidx::feature::IA32_CORE_CAPABILITIES,
+            "IA32_CORE_CAPABILITIES MSR (lists model-specific core capabilities)"
         },
-        {{"STIBP", "Single Thread Indirect Branch Predictor"}, feats.STIBP},
-        {{"L1D_FLUSH", "IA32_FLUSH_CMD MSR"}, feats.L1D_FLUSH},
+        {cpuidx::feature::SSBD, "Speculative Store Bypass Disable"},
+        {cpuidx::feature::SHA512, "SHA-512 extensions"},
+        {cpuidx::feature::SM3, "SM3 hash extensions"},
+        {cpuidx::feature::SM4, "SM4 cipher extensions"},
+        {cpuidx::feature::RAOINT, "Remote Atomic Operations on integers: AADD, AAND, AOR, AXOR instructions"},
+        {cpuidx::feature::AVXVNNI, "AVX Vector Neural Network Instructions (VNNI) (VEX encoded)"},
+        {cpuidx::feature::AVX512BF16, "AVX-512 instructions for bfloat16 numbers"},
+        {cpuidx::feature::CMPCCXADD, "CMPccXADD instructions"},
+        {cpuidx::feature::FRED, "Flexible Return and Event Delivery"},
+        {cpuidx::feature::LKGS, "LKGS Instruction"},
+        {cpuidx::feature::WRMSRNS, "WRMSRNS instruction (non-serializing write to MSRs)"},
+        {cpuidx::feature::NMISRC, "NMI source reporting"},
+        {cpuidx::feature::AMXFP16, "AMX instructions for FP16 numbers"},
         {
-            {
-                "IA32_ARCH_CAPABILITIES", "IA32_ARCH_CAPABILITIES MSR (lists speculative side channel mitigations)"
-            },
-            feats.IA32_ARCH_CAPABILITIES
+            cpuidx::feature::HRESET,
+            "HRESET instruction, IA32_HRESET_ENABLE (17DAh) MSR, and Processor History Reset Leaf (EAX=20h)"
         },
+        {cpuidx::feature::AVXIFMA, "AVX Integer Fused Multiply-Add instructions"},
+        {cpuidx::feature::LAM, "Linear Address Masking"},
+        {cpuidx::feature::MSRLIST, "RDMSRLIST and WRMSRLIST instructions, and the IA32_BARRIER (02Fh) MSR"},
         {
-            {
-                "IA32_CORE_CAPABILITIES", "IA32_CORE_CAPABILITIES MSR (lists model-specific core capabilities)"
-            },
-            feats.IA32_CORE_CAPABILITIES
+            cpuidx::feature::MOVRS,
+            "MOVRS and PREFETCHRST2 instructions supported (memory read/prefetch with read-shared hint)"
         },
-        {{"SSBD", "Speculative Store Bypass Disable"}, feats.SSBD},
-        {{"SHA512", "SHA-512 extensions"}, feats.SHA512},
-        {{"SM3", "SM3 hash extensions"}, feats.SM3},
-        {{"SM4", "SM4 cipher extensions"}, feats.SM4},
-        {{"RAOINT", "Remote Atomic Operations on integers: AADD, AAND, AOR, AXOR instructions"}, feats.RAOINT},
-        {{"AVXVNNI", "AVX Vector Neural Network Instructions (VNNI) (VEX encoded)"}, feats.AVXVNNI},
-        {{"AVX512BF16", "AVX-512 instructions for bfloat16 numbers"}, feats.AVX512BF16},
-        {{"CMPCCXADD", "CMPccXADD instructions"}, feats.CMPCCXADD},
-        {{"FRED", "Flexible Return and Event Delivery"}, feats.FRED},
-        {{"LKGS", "LKGS Instruction"}, feats.LKGS},
-        {{"WRMSRNS", "WRMSRNS instruction (non-serializing write to MSRs)"}, feats.WRMSRNS},
-        {{"NMISRC", "NMI source reporting"}, feats.NMISRC},
-        {{"AMXFP16", "AMX instructions for FP16 numbers"}, feats.AMXFP16},
+        {cpuidx::feature::PBNDKB, "Total Storage Encryption: PBNDKB instruction and TSE_CAPABILITY (9F1h) MSR."},
+        {cpuidx::feature::AVXVNNIINT8, "AVX Vector Neural Network Instructions with INT8 data"},
+        {cpuidx::feature::AVXNECONVERT, "AVX no-exception FP conversion instructions (bfloat16↔FP32 and FP16→FP32)"},
+        {cpuidx::feature::AMXCOMPLEX, "AMX support for \"complex\" tiles (TCMMIMFP16PS and TCMMRLFP16PS)"},
+        {cpuidx::feature::AVXVNNIINT16, "AVX VNNI INT16 instructions"},
+        {cpuidx::feature::PREFETCHI, "Instruction-cache prefetch instructions (PREFETCHIT0 and PREFETCHIT1)"},
+        {cpuidx::feature::USERMSR, "User-mode MSR access instructions (URDMSR and UWRMSR)"},
+        {cpuidx::feature::AVX10, "AVX10 Converged Vector ISA"},
+        {cpuidx::feature::APXF, "Advanced Performance Extensions, Foundation"},
         {
-            {
-                "HRESET",
-                "HRESET instruction, IA32_HRESET_ENABLE (17DAh) MSR, and Processor History Reset Leaf (EAX=20h)"
-            },
-            feats.HRESET
+            cpuidx::feature::XSAVEOPT,
+            "XSAVEOPT instruction: save state-components that have been modified since last XRSTOR"
         },
-        {{"AVXIFMA", "AVX Integer Fused Multiply-Add instructions"}, feats.AVXIFMA},
-        {{"MSRLIST", "RDMSRLIST and WRMSRLIST instructions, and the IA32_BARRIER (02Fh) MSR"}, feats.MSRLIST},
-        {
-            {
-                "MOVRS", "MOVRS and PREFETCHRST2 instructions supported (memory read/prefetch with read-shared hint)"
-            },
-            feats.MOVRS
-        },
-        {{"PBNDKB", "Total Storage Encryption: PBNDKB instruction and TSE_CAPABILITY (9F1h) MSR."}, feats.PBNDKB},
-        {{"AVXVNNIINT8", "AVX Vector Neural Network Instructions with INT8 data"}, feats.AVXVNNIINT8},
-        {
-            {"AVXNECONVERT", "AVX no-exception FP conversion instructions (bfloat16↔FP32 and FP16→FP32)"},
-            feats.AVXNECONVERT
-        },
-        {{"AMXCOMPLEX", "AMX support for \"complex\" tiles (TCMMIMFP16PS and TCMMRLFP16PS)"}, feats.AMXCOMPLEX},
-        {{"AVXVNNIINT16", "AVX VNNI INT16 instructions"}, feats.AVXVNNIINT16},
-        {{"PREFETCHI", "Instruction-cache prefetch instructions (PREFETCHIT0 and PREFETCHIT1)"}, feats.PREFETCHI},
-        {{"USERMSR", "User-mode MSR access instructions (URDMSR and UWRMSR)"}, feats.USERMSR},
-        {{"AVX10", "AVX10 Converged Vector ISA"}, feats.AVX10},
-        {{"APXF", "Advanced Performance Extensions, Foundation"}, feats.APXF},
-        {
-            {"XSAVEOPT", "XSAVEOPT instruction: save state-components that have been modified since last XRSTOR"},
-            feats.XSAVEOPT
-        },
-        {{"XSAVEC", "XSAVEC instruction: save/restore state with compaction"}, feats.XSAVEC},
-        {{"XSAVES", "XSAVES and XRSTORS instructions and IA32_XSS MSR"}, feats.XSAVES},
-        {{"XSAVEXFD", "XFD (Extended Feature Disable) supported"}, feats.XSAVEXFD},
-        {{"PTWRITE", "PTWRITE instruction supported"}, feats.PTWRITE},
-        {{"AESKLE", "AES \"Key Locker\" Instructions enabled"}, feats.AESKLE},
-        {{"WIDEKL", "AES \"Wide Key Locker\" Instructions"}, feats.WIDEKL},
-        {{"AMXFP8", "AMX float8 support"}, feats.AMXFP8},
-        {{"AMX_TRANSPOSE", "AMX Transposition instruction support"}, feats.AMX_TRANSPOSE},
-        {{"AMX_TF32", "AMX tf32/fp19 support"}, feats.AMX_TF32},
-        {{"AMX_AVX512", "AMX-AVX512 support"}, feats.AMX_AVX512},
-        {{"AMX_MOVRS", "AMX-MOVRS support"}, feats.AMX_MOVRS},
-        {{"AVX10_256", "256-bit vector support is present"}, feats.AVX10_256},
-        {{"AVX10_512", "512-bit vector support is present"}, feats.AVX10_512},
-        {{"LAHF_LM", "LAHF/SAHF in long mode"}, feats.LAHF_LM},
-        {{"ABM", "Advanced bit manipulation (LZCNT and POPCNT)"}, feats.ABM},
-        {{"SSE4a", "SSE4a instructions"}, feats.SSE4a},
-        {{"PRFCHW", "PREFETCH and PREFETCHW instructions"}, feats.PRFCHW},
-        {{"XOP", "XOP instruction set"}, feats.XOP},
-        {{"LWP", "Light Weight Profiling"}, feats.LWP},
-        {{"FMA4", "4-operand fused multiply-add instructions"}, feats.FMA4},
-        {{"TBM", "Trailing Bit Manipulation"}, feats.TBM},
-        {{"MWAITX", "MONITORX and MWAITX instructions"}, feats.MWAITX},
-        {{"MMXEXT", "Extended MMX"}, feats.MMXEXT},
-        {{"LM", "Long mode"}, feats.LM},
-        {{"3DNOWP", "Extended 3DNow!"}, feats.x3DNOWP},
-        {{"3DNOW", "3DNow!"}, feats.x3DNOW},
-        {{"CLZERO", "CLZERO instruction"}, feats.CLZERO},
-        {{"RDPRU", "RDPRU instruction"}, feats.RDPRU},
-        {{"WBNOINVD", "WBNOINVD instruction"}, feats.WBNOINVD},
-    };
+        {cpuidx::feature::XSAVEC, "XSAVEC instruction: save/restore state with compaction"},
+        {cpuidx::feature::XSAVES, "XSAVES and XRSTORS instructions and IA32_XSS MSR"},
+        {cpuidx::feature::XSAVEXFD, "XFD (Extended Feature Disable) supported"},
+        {cpuidx::feature::PTWRITE, "PTWRITE instruction supported"},
+        {cpuidx::feature::AESKLE, "AES \"Key Locker\" Instructions enabled"},
+        {cpuidx::feature::WIDEKL, "AES \"Wide Key Locker\" Instructions"},
+        {cpuidx::feature::AMXFP8, "AMX float8 support"},
+        {cpuidx::feature::AMX_TRANSPOSE, "AMX Transposition instruction support"},
+        {cpuidx::feature::AMX_TF32, "AMX tf32/fp19 support"},
+        {cpuidx::feature::AMX_AVX512, "AMX-AVX512 support"},
+        {cpuidx::feature::AMX_MOVRS, "AMX-MOVRS support"},
+        {cpuidx::feature::AVX10_256, "256-bit vector support is present"},
+        {cpuidx::feature::AVX10_512, "512-bit vector support is present"},
+        {cpuidx::feature::LAHF_LM, "LAHF/SAHF in long mode"},
+        {cpuidx::feature::ABM, "Advanced bit manipulation (LZCNT and POPCNT)"},
+        {cpuidx::feature::SSE4a, "SSE4a instructions"},
+        {cpuidx::feature::PRFCHW, "PREFETCH and PREFETCHW instructions"},
+        {cpuidx::feature::XOP, "XOP instruction set"},
+        {cpuidx::feature::LWP, "Light Weight Profiling"},
+        {cpuidx::feature::FMA4, "4-operand fused multiply-add instructions"},
+        {cpuidx::feature::TBM, "Trailing Bit Manipulation"},
+        {cpuidx::feature::MWAITX, "MONITORX and MWAITX instructions"},
+        {cpuidx::feature::MMXEXT, "Extended MMX"},
+        {cpuidx::feature::RDTSCP, "RDTSCP instruction and IA32_TSC_AUX MSR"},
+        {cpuidx::feature::LM, "Long mode"},
+        {cpuidx::feature::x3DNOWP, "Extended 3DNow!"},
+        {cpuidx::feature::x3DNOW, "3DNow!"},
+        {cpuidx::feature::CLZERO, "CLZERO instruction"},
+        {cpuidx::feature::RDPRU, "RDPRU instruction"},
+        {cpuidx::feature::WBNOINVD, "WBNOINVD instruction"},
+        {cpuidx::feature::UAI, "Upper Address Ignore"},
+    }};
+
+    const cpuidx::feature_set available{feats};
 
     // Print available features
     std::println("Available CPU Features:");
-    for (const auto& [name, enabled] : featureMap) {
-        if (enabled)
-            std::println("- {:<13}: {}", name.first, name.second);
+    for (const auto& [feature, description] : descriptions) {
+        if (available.has(feature))
+            std::println("- {:<13}: {}", feature, description);
     }
 }
 